@@ -24,6 +24,29 @@
 #define CCM_SRAM_START_ADDR    0x10000000
 #define CCM_SRAM_SIZE          0x8000     /* 32KB */
 
+/**********************************************
+ * Reserved Flash Layout (top of bank 2)
+ **********************************************/
+#define FLASH_BANK2_START_ADDR (FLASH_START_ADDR + FLASH_SIZE / 2)
+#define FLASH_LOG_PAGES        8          /* Pages used round-robin by the persistent log */
+#define FLASH_QUARANTINE_PAGES 1          /* Page holding the bad-address quarantine table */
+#define FLASH_SCRIPT_PAGES     1          /* Page holding the uploaded test script */
+#define FLASH_RESERVED_SIZE    ((FLASH_LOG_PAGES + FLASH_QUARANTINE_PAGES + FLASH_SCRIPT_PAGES) * FLASH_PAGE_SIZE)
+#define FLASH_RESERVED_START   (FLASH_START_ADDR + FLASH_SIZE - FLASH_RESERVED_SIZE)
+#define FLASH_LOG_START_ADDR   FLASH_RESERVED_START
+#define FLASH_QUARANTINE_ADDR  (FLASH_LOG_START_ADDR + FLASH_LOG_PAGES * FLASH_PAGE_SIZE)
+#define FLASH_SCRIPT_ADDR      (FLASH_QUARANTINE_ADDR + FLASH_QUARANTINE_PAGES * FLASH_PAGE_SIZE)
+
+/**********************************************
+ * Memory Region Identifiers
+ **********************************************/
+#define REGION_FLASH           0
+#define REGION_SRAM1           1
+#define REGION_SRAM2           2
+#define REGION_CCM_SRAM        3
+#define NUM_TEST_REGIONS       4
+#define REGION_NONE            0xFF
+
 /**********************************************
  * Test Pattern Definitions
  **********************************************/
@@ -55,6 +78,214 @@
 #define FLASH_ONLY_CYCLE      3       /* Test only Flash */
 #define CACHE_ONLY_CYCLE      4       /* Test only Cache operations */
 
+/**********************************************
+ * Environment Monitor Definitions
+ **********************************************/
+#define TEMP_BIN_COUNT        12      /* Error-rate-versus-temperature bins per region */
+#define TEMP_BIN_MIN_C        (-40)   /* Lower edge of the first bin */
+#define TEMP_BIN_WIDTH_C      15      /* Width of each bin in degrees C */
+
+/**********************************************
+ * Quarantine Table Definitions
+ **********************************************/
+#define QUARANTINE_CAPACITY      128     /* Max quarantined words and blocks */
+#define QUARANTINE_BLOCK_SIZE    256     /* Bytes per block in the quarantine bitmap */
+#define QUARANTINE_PROMOTE_WORDS 4       /* Failing words that quarantine a whole block */
+
+/**********************************************
+ * March Test Definitions
+ **********************************************/
+#define MARCH_UP              0       /* Ascending address order (also used for "either") */
+#define MARCH_DOWN            1       /* Descending address order */
+
+#define MARCH_W0              0x00    /* Write background */
+#define MARCH_W1              0x01    /* Write inverse background */
+#define MARCH_R0              0x02    /* Read and verify background */
+#define MARCH_R1              0x03    /* Read and verify inverse background */
+#define MARCH_OP_READ         0x02
+#define MARCH_OP_INVERSE      0x01
+
+#define MARCH_MAX_OPS         6
+#define MARCH_NUM_BACKGROUNDS 6       /* log2(32) + 1 data backgrounds for 32-bit words */
+
+/**********************************************
+ * Adaptive Escalation Definitions
+ **********************************************/
+#define ESCALATION_BLOCK_SIZE   1024  /* Bytes per escalated block */
+#define ESCALATION_MAX_BLOCKS   12    /* Blocks under intensive test at once */
+#define ESCALATION_MAX_DECAY    3     /* Clean regions drop to 1/8 sampling at most */
+#define ESCALATION_RETENTION_MS 500   /* Hold time for the retention stage */
+#define ESCALATION_HAMMER_READS 20000 /* Aggressor reads per hammer stage */
+
+/**********************************************
+ * Kernel Throughput Accounting
+ **********************************************/
+#define KERNEL_CHECKERBOARD       0
+#define KERNEL_WIDTH_8            1
+#define KERNEL_WIDTH_16           2
+#define KERNEL_WIDTH_32           3
+#define KERNEL_WIDTH_64           4
+#define KERNEL_WIDTH_16_UNALIGNED 5
+#define KERNEL_WIDTH_32_UNALIGNED 6
+#define KERNEL_RANDOM             7
+#define KERNEL_MARCH_UP           8       /* March engine, one entry per address order */
+#define KERNEL_MARCH_DOWN         9
+#define KERNEL_MARCH_GRAY         10
+#define KERNEL_MARCH_LFSR         11
+#define KERNEL_DUAL_INTERLEAVED   12      /* CCM and SRAM in the same loop body */
+#define KERNEL_DUAL_SEQUENTIAL    13      /* Same work, one region after the other */
+#define KERNEL_MARCH_RELOCATED    14      /* Whole-region March with the stack moved out */
+#define KERNEL_SCRIPT             15      /* Uploaded test script */
+#define NUM_KERNELS               16
+
+/**********************************************
+ * Address Orders
+ **********************************************/
+#define ADDRESS_ORDER_UP      0       /* Ascending word index */
+#define ADDRESS_ORDER_DOWN    1       /* Descending word index */
+#define ADDRESS_ORDER_GRAY    2       /* Gray-code sequence of word indices */
+#define ADDRESS_ORDER_LFSR    3       /* Maximal-length LFSR permutation */
+#define NUM_ADDRESS_ORDERS    4
+
+/**********************************************
+ * Pseudo-Random Data
+ **********************************************/
+/* xorshift32 (Marsaglia). State must be non-zero. Kept as a macro so a
+   host-side replay of a logged seed produces the identical stream. */
+#define XORSHIFT32_NEXT(state) \
+    ((state) ^= (state) << 13, (state) ^= (state) >> 17, (state) ^= (state) << 5)
+
+/**********************************************
+ * CCM-Resident Code
+ **********************************************/
+/* Time-critical kernels run from CCM SRAM over the I-bus, leaving the
+   flash and the S-bus to the accesses under test. The linker script places
+   .ccmram at the start of CCM and InitializeCCMCode() copies it there. */
+#define CCM_RAMFUNC           __attribute__((section(".ccmram"), noinline, long_call))
+#define CCM_CODE_RESERVED     0x400   /* Bytes at the start of CCM kept for code */
+
+/**********************************************
+ * Hammer Test Definitions
+ **********************************************/
+#define HAMMER_MODE_READ      0       /* LDM bursts from both aggressors */
+#define HAMMER_MODE_WRITE     1       /* STM bursts to both aggressors (SRAM only) */
+#define HAMMER_AGGRESSOR_SIZE 16      /* Bytes moved by one LDM/STM burst */
+
+/**********************************************
+ * DMA Bus-Contention Stress Definitions
+ **********************************************/
+#define DMA_STRESS_SCRATCH_WORDS  256     /* Words per DMA scratch buffer */
+#define DMA_STRESS_PERIOD_MS      10      /* Duty cycle period */
+
+/* Gate state over a span of ticks */
+#define DMA_GATE_CLOSED           0       /* No DMA traffic for the whole span */
+#define DMA_GATE_OPEN             1       /* DMA traffic for the whole span */
+#define DMA_GATE_MIXED            2       /* The gate opened or closed in the span */
+
+/**********************************************
+ * Test Window Guard Definitions
+ **********************************************/
+/* The SRAM test windows are no-access in the MPU except while a kernel
+   runs on them. Kernels are called through WINDOW_KERNEL(), which opens
+   the windows named in the mask for the call and closes them after. */
+#define GUARD_WINDOW(region)  (1U << (region))
+#define GUARD_ALL_WINDOWS     (GUARD_WINDOW(REGION_SRAM1) | GUARD_WINDOW(REGION_SRAM2) | \
+                               GUARD_WINDOW(REGION_CCM_SRAM))
+#define WINDOW_KERNEL(windows, call) \
+    (OpenTestWindows(windows), CloseTestWindowsAfter((windows), (call)))
+
+/**********************************************
+ * Production Mode Definitions
+ **********************************************/
+/* Held high at reset (pulled down otherwise) to run the production
+   go/no-go pass instead of the endless test loop */
+#define PRODUCTION_PIN_PORT   GPIOC
+#define PRODUCTION_PIN        GPIO_PIN_13
+#define PRODUCTION_PIN_CLK_ENABLE() __HAL_RCC_GPIOC_CLK_ENABLE()
+
+/**********************************************
+ * Bus Tier Definitions
+ **********************************************/
+/* RunBusTiers() result; a region's device tests only run on a pass */
+#define BUS_TIER_PASS         0
+#define BUS_TIER_DATA         1       /* Data-bus tier failed */
+#define BUS_TIER_ADDRESS      2       /* Address-bus tier failed */
+#define BUS_TIER_KNOWN_FAULT  3       /* A tier failed again on the lines it diagnosed before */
+
+/**********************************************
+ * Power-On Self-Test Definitions
+ **********************************************/
+/* SystemInit() runs the POST before .data and .bss are set up. The budget
+   can be set from the build; POST steps still pending when it runs out
+   are reported as not done. */
+#ifndef POST_BUDGET_MS
+#define POST_BUDGET_MS        50
+#endif
+#define POST_STEP_DATA_BUS    0x01
+#define POST_STEP_ADDRESS_BUS 0x02
+#define POST_STEP_FLASH_CRC   0x04
+#define POST_STEP_MARCH_SRAM1 0x08
+#define POST_STEP_MARCH_SRAM2 0x10
+#define POST_STEP_MARCH_CCM   0x20
+#define POST_STEP_ALL         0x3F
+
+/**********************************************
+ * Framework State Pages
+ **********************************************/
+/* Configuration, kernel statistics and the last error record sit in the
+   top SRAM2 pages, outside every test window. While a kernel runs the
+   pages are read-only in the MPU, so a writer inside a kernel brackets
+   its update with UnlockFrameworkState() / CommitFrameworkState(). The
+   error log queue, parity event ring and quarantine table live here too.
+   The linker script must place .fwstate at STATE_START_ADDR and keep the
+   MSP stack below it; InitializeFrameworkState() checks both, leaving the
+   pages unguarded if either fails, and clears the section. */
+#define STATE_PAGE_SIZE       0x400
+#define STATE_PAGES           4
+#define STATE_SIZE            (STATE_PAGES * STATE_PAGE_SIZE)
+#define STATE_START_ADDR      (SRAM2_START_ADDR + SRAM2_SIZE - STATE_SIZE)
+#define FRAMEWORK_STATE       __attribute__((section(".fwstate")))
+
+/**********************************************
+ * Retention Test Definitions
+ **********************************************/
+#define RETENTION_MAX_WINDOWS 8       /* Background plus escalation windows in flight */
+
+/**********************************************
+ * Fault Classification Definitions
+ **********************************************/
+#define FAULT_UNCLASSIFIED    0       /* Not re-checked */
+#define FAULT_TRANSIENT       1       /* Word passes every re-check (upset) */
+#define FAULT_INTERMITTENT    2       /* Word fails some re-checks */
+#define FAULT_PERMANENT       3       /* Word fails every re-check */
+#define NUM_FAULT_CLASSES     4
+
+/* Rewrite/re-read trials per failing SRAM word */
+#define RECHECK_SRAM_TRIALS   6
+
+/**********************************************
+ * Persistent Log Record Types
+ **********************************************/
+#define LOG_RECORD_ERROR      0x01    /* Memory error record */
+#define LOG_RECORD_CYCLE      0x02    /* Cycle summary */
+#define LOG_RECORD_RESET      0x03    /* Reset cause at boot */
+#define LOG_RECORD_ECC        0x04    /* Flash ECC event */
+#define LOG_RECORD_DROPPED    0x05    /* Records lost to a full queue */
+#define LOG_RECORD_SEED       0x06    /* Seed of a failing random-data pass */
+#define LOG_RECORD_CHECKPOINT 0x07    /* Burn-in totals */
+
+/**********************************************
+ * Cycle Counter (DWT) Helpers
+ **********************************************/
+#define ENABLE_CYCLE_COUNTER() do { \
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+        DWT->CYCCNT = 0; \
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; \
+    } while (0)
+#define GET_CYCLE_COUNT()      (DWT->CYCCNT)
+#define US_TO_CYCLES(us)       ((us) * (SystemCoreClock / 1000000U))
+#define CYCLES_TO_US(cycles)   ((cycles) / (SystemCoreClock / 1000000U))
+
 /**********************************************
  * Backup Register Definitions
  **********************************************/
@@ -82,8 +313,94 @@ typedef struct {
     uint32_t eccErrorCount;
     uint32_t transactionFailCount;
     uint32_t totalErrors;
+    uint32_t transientErrors;     /* Errors that did not reproduce on re-check */
+    uint32_t intermittentErrors;  /* Errors that reproduced on some re-checks */
+    uint32_t permanentErrors;     /* Errors that reproduced on every re-check */
+    uint32_t parityErrors;        /* Parity NMIs traced to a word in this region */
 } MemoryTestStatus;
 
+/* Work done by one test kernel */
+typedef struct {
+    uint32_t runs;
+    uint64_t bytes;               /* Bytes read plus bytes written */
+    uint64_t cycles;              /* CPU cycles spent in the kernel */
+    uint64_t quietBytes;          /* Bytes moved by runs with the DMA gate closed */
+    uint64_t quietCycles;         /* Cycles of runs with the DMA gate closed */
+    uint64_t contendedBytes;      /* Bytes moved by runs with the DMA gate open */
+    uint64_t contendedCycles;     /* Cycles of runs with the DMA gate open */
+} KernelStats;
+
+/* Iterator over a window's word indices in one address order */
+typedef struct {
+    uint32_t order;               /* ADDRESS_ORDER_x */
+    uint32_t numWords;            /* Indices run from 0 to numWords - 1 */
+    uint32_t bits;                /* Width of the Gray/LFSR index space */
+    uint32_t taps;                /* Galois LFSR feedback mask */
+    uint32_t state;               /* Counter or LFSR state */
+    uint8_t reverse;              /* Walk the sequence backwards */
+} AddressSequence;
+
+/* Quarantine lookups along a verify loop, one bitmap test per block */
+typedef struct {
+    uint32_t blockBase;           /* Block of the last word looked up */
+    uint32_t suspect;             /* Its bitmap bit: something in it is quarantined */
+} QuarantineCursor;
+
+/* Die temperature and analog supply sampled in the background */
+typedef struct {
+    int16_t temperatureC;         /* Die temperature in degrees C */
+    uint16_t vddaMv;              /* VDDA derived from VREFINT, 0 if no sample yet */
+} EnvironmentSample;
+
+/* Memory error record - one per detected mismatch */
+typedef struct {
+    uint32_t cycle;
+    uint32_t address;
+    uint32_t readValue;
+    uint32_t expectedValue;
+    uint8_t region;
+    uint8_t faultClass;           /* FAULT_TRANSIENT, FAULT_INTERMITTENT or FAULT_PERMANENT */
+    EnvironmentSample environment;
+} MemoryErrorRecord;
+
+/* Per-cycle summary record */
+typedef struct {
+    uint32_t cycle;
+    uint32_t tick;
+    uint32_t regionErrors[NUM_TEST_REGIONS];
+    uint32_t quarantined;         /* Quarantine entries, whose errors no longer count */
+    EnvironmentSample environment;
+} CycleSummaryRecord;
+
+/* Burn-in totals, written to the persistent log at each summary */
+typedef struct {
+    uint32_t active;              /* 0 once burn-in has been stopped */
+    uint32_t elapsedSeconds;
+    uint64_t cycles;
+    uint64_t errors;
+    uint32_t megabytes;           /* Bytes read plus bytes written, in MB */
+} BurnInCheckpoint;
+
+/* Error-rate-versus-temperature bins for one region */
+typedef struct {
+    uint32_t cycles[TEMP_BIN_COUNT];   /* Test cycles run with the die in this bin */
+    uint32_t errors[TEMP_BIN_COUNT];   /* Errors detected with the die in this bin */
+} TemperatureErrorBins;
+
+/* One March element: address order and up to MARCH_MAX_OPS operations */
+typedef struct {
+    uint8_t order;
+    uint8_t numOps;
+    uint8_t ops[MARCH_MAX_OPS];
+} MarchElement;
+
+/* March algorithm: named sequence of elements */
+typedef struct {
+    const char* name;
+    const MarchElement* elements;
+    uint32_t numElements;
+} MarchAlgorithm;
+
 /* Test configuration structure */
 typedef struct {
     /* Test region sizes (in bytes) */
@@ -109,6 +426,33 @@ typedef struct {
     /* Cycle settings */
     uint8_t rotateStartingOffsets; /* If true, rotate starting offsets on each cycle */
     uint8_t rotateTestSizes;       /* If true, vary test coverage size on each cycle */
+
+    /* Persistent log settings */
+    uint32_t logFlushBudgetUs;     /* Max time per cycle spent programming the log */
+    uint32_t logCycleInterval;     /* Log a clean cycle summary every N cycles */
+
+    /* Adaptive escalation settings */
+    uint32_t escalationCycles;     /* Cycles of intensive testing after a block fails */
+    uint32_t decayCycles;          /* Clean cycles per step down in sampling rate */
+
+    /* Retention test settings */
+    uint32_t retentionDelayMs;     /* Time a retention window holds its pattern */
+    uint32_t retentionWindowSize;  /* Bytes per background retention window */
+    uint32_t retentionWindows;     /* Background windows kept in flight */
+
+    /* Hammer test settings */
+    uint32_t hammerDurationMs;     /* Time spent hammering each target */
+    uint32_t hammerAggressorStride; /* Bytes between the two aggressors */
+
+    /* DMA stress settings */
+    uint32_t dmaStressDutyPercent; /* Share of each period the DMA streams run */
+    uint32_t dmaStressControlInterval; /* Every Nth stress cycle runs without DMA */
+
+    /* Relocated-stack March settings */
+    uint32_t relocatedMarchInterval; /* Whole-region March every N cycles, 0 = never */
+    uint32_t burnInSummaryMinutes;  /* Burn-in summary and checkpoint every N minutes, 0 = never */
+    uint32_t burnInHeartbeatSeconds; /* Burn-in heartbeat every N seconds, 0 = never */
+    uint32_t scriptInterval;       /* Run the uploaded test script every N cycles, 0 = never */
 } MemoryTestConfig;
 
 /**********************************************
@@ -131,14 +475,30 @@ extern MemoryTestStatus cacheStatus;
 
 extern MemoryTestConfig testConfig;
 
+extern MemoryErrorRecord lastErrorRecord;
+extern CycleSummaryRecord lastCycleSummary;
+
 /**********************************************
  * Function Prototypes - Core Framework
  **********************************************/
 
 /* memory_test_framework.c */
 uint32_t RunCheckerboardTest(uint32_t startAddr, uint32_t size, uint32_t pattern, MemoryTestStatus* status);
+uint32_t RunCheckerboardTestOrdered(uint32_t startAddr, uint32_t size, uint32_t pattern,
+                                    uint32_t addressOrder, MemoryTestStatus* status);
 void RunCacheTest(MemoryTestStatus* status);
 uint32_t RunAddressTest(uint32_t startAddr, uint32_t size, MemoryTestStatus* status);
+uint32_t RecordMemoryError(const char* testName, uint32_t address, uint32_t readValue, uint32_t expectedValue);
+uint32_t RecordRecheckedMemoryError(const char* testName, uint32_t address, uint32_t readValue,
+                                    uint32_t expectedValue, uint32_t failures, uint32_t trials);
+uint32_t GetRegionForAddress(uint32_t address);
+MemoryTestStatus* GetRegionStatus(uint32_t region);
+const char* GetRegionName(uint32_t region);
+uint32_t InitializeCCMCode(void);
+void RecordKernelRun(uint32_t kernel, uint32_t bytes, uint32_t cycles);
+uint64_t GetKernelBytes(void);
+void ReportKernelStatus(void);
+uint32_t IsCCMCodeReady(void);
 
 /* memory_test_main.c */
 void InitializeTests(void);
@@ -170,18 +530,242 @@ void HandleECCError(uint32_t operationCode);
 uint32_t GetECCErrorCount(void);
 void ResetECCErrorCount(void);
 
+/**********************************************
+ * Function Prototypes - Environment Monitor
+ **********************************************/
+
+/* environment_monitor.c */
+void ConfigureEnvironmentMonitor(void);
+void SampleEnvironment(EnvironmentSample* sample);
+void RecordCycleSummary(const uint32_t regionErrors[NUM_TEST_REGIONS]);
+void ReportEnvironmentStatus(void);
+void PauseEnvironmentMonitor(void);
+void ResumeEnvironmentMonitor(void);
+
+/**********************************************
+ * Function Prototypes - Test Scripts
+ **********************************************/
+
+/* test_script.c */
+void InitializeTestScript(void);
+uint32_t LoadTestScript(uint32_t length);
+void EraseTestScript(void);
+void RunTestScript(void);
+void ReportTestScriptStatus(void);
+
+/**********************************************
+ * Function Prototypes - Burn-In Mode
+ **********************************************/
+
+/* burn_in.c */
+void InitializeBurnIn(void);
+void StartBurnIn(void);
+void StopBurnIn(void);
+uint32_t IsBurnInActive(void);
+void ServiceBurnIn(const uint32_t* cycleErrors);
+
+/**********************************************
+ * Function Prototypes - Production Mode
+ **********************************************/
+
+/* production_test.c */
+uint32_t IsProductionPinAsserted(void);
+void RunProductionTest(void);
+
+/**********************************************
+ * Function Prototypes - Bus Tiers
+ **********************************************/
+
+/* bus_tier_tests.c */
+uint32_t RunBusTiers(uint32_t region, uint32_t startAddr, uint32_t size);
+uint32_t IsBusTierFaulty(uint32_t region);
+void ReportBusTierStatus(void);
+
+/**********************************************
+ * Function Prototypes - Power-On Self-Test
+ **********************************************/
+
+/* power_on_self_test.c */
+void PowerOnSelfTest(void);
+uint32_t IsPostPassed(void);
+void GetPostSteps(uint32_t* completedSteps, uint32_t* failedSteps);
+void ReportPostResult(void);
+
+/**********************************************
+ * Function Prototypes - Relocated-Stack March
+ **********************************************/
+
+/* stack_relocation.c */
+uint32_t RunRelocatedMarch(uint32_t region);
+void ReportRelocationStatus(void);
+
+/**********************************************
+ * Function Prototypes - Stack High-Water Monitor
+ **********************************************/
+
+/* stack_monitor.c */
+void InitializeStackMonitor(void);
+void ServiceStackMonitor(void);
+void ReportStackStatus(void);
+
+/**********************************************
+ * Function Prototypes - Memory Layout Discovery
+ **********************************************/
+
+/* memory_layout.c */
+void InitializeMemoryLayout(void);
+void SetStackReservation(uint32_t bytes);
+uint32_t GetRegionFreeRange(uint32_t region, uint32_t* startAddr, uint32_t* endAddr);
+void ReportMemoryLayout(void);
+
+/**********************************************
+ * Function Prototypes - Test Window Guard
+ **********************************************/
+
+/* window_guard.c */
+void InitializeWindowGuard(void);
+void ArmWindowGuard(void);
+void OpenTestWindows(uint32_t windows);
+void CloseTestWindows(uint32_t windows);
+uint32_t CloseTestWindowsAfter(uint32_t windows, uint32_t result);
+void InitializeFrameworkState(void);
+void UnlockFrameworkState(void);
+void CommitFrameworkState(void);
+uint32_t UnlockFrameworkStateNMI(void);
+void CommitFrameworkStateNMI(uint32_t saved);
+uint32_t HandleWindowGuardFault(uint32_t* frame);
+void ServiceWindowGuard(void);
+void ReportWindowGuardStatus(void);
+
+/**********************************************
+ * Function Prototypes - Dual-Region Interleaved Tests
+ **********************************************/
+
+/* dual_region_tests.c */
+uint32_t RunDualRegionTest(uint32_t ccmStart, uint32_t ccmSize, uint32_t sramStart, uint32_t sramSize,
+                           uint32_t pattern);
+void ReportDualRegionStatus(void);
+
+/**********************************************
+ * Function Prototypes - SRAM Parity Monitor
+ **********************************************/
+
+/* parity_monitor.c */
+void InitializeParityMonitor(void);
+uint32_t HandleParityNMI(void);
+void ServiceParityEvents(void);
+void ReportParityStatus(void);
+
+/**********************************************
+ * Function Prototypes - Background Fill
+ **********************************************/
+
+/* background_fill.c */
+void FillBackground(uint32_t startAddr, uint32_t size, uint32_t value);
+void ReportBackgroundFillStatus(void);
+
+/**********************************************
+ * Function Prototypes - DMA + CRC Flash Verifier
+ **********************************************/
+
+/* crc_verifier.c */
+void InitializeCrcVerifier(void);
+void StartCrcVerifier(void);
+uint32_t JoinCrcVerifier(void);
+void ReportCrcVerifierStatus(void);
+
+/**********************************************
+ * Function Prototypes - DMA Bus-Contention Stress
+ **********************************************/
+
+/* dma_stress.c */
+void InitializeDmaStress(void);
+void StartDmaStress(void);
+void StopDmaStress(void);
+uint32_t IsDmaStressActive(void);
+uint32_t GetDmaGateState(uint32_t startTick, uint32_t endTick);
+void DmaStressTick(void);
+void RunStressTestCycle(void);
+void ReportDmaStressStatus(void);
+
+/**********************************************
+ * Function Prototypes - Fault Classification
+ **********************************************/
+
+/* fault_classification.c */
+uint32_t ClassifyMemoryError(uint32_t address, uint32_t readValue, uint32_t expectedValue);
+uint32_t RecheckSRAMWord(volatile uint32_t* addr, uint32_t failMask, uint32_t expectedValue, uint32_t cyclesPerUs);
+uint32_t CountFaultClass(uint32_t address, uint32_t failures, uint32_t trials);
+const char* GetFaultClassName(uint32_t faultClass);
+void ReportFaultClassStatus(void);
+
+/**********************************************
+ * Function Prototypes - Persistent Result Log
+ **********************************************/
+
+/* persistent_log.c */
+void InitializePersistentLog(void);
+void LogErrorRecord(const MemoryErrorRecord* record);
+void LogCycleSummary(const CycleSummaryRecord* summary);
+void LogResetEvent(uint32_t resetCause, uint32_t resetCount, uint32_t lastCycle);
+void LogECCEvent(uint32_t address, uint32_t uncorrectable);
+void LogRandomSeed(uint32_t seed, uint32_t addressOrder, uint32_t startAddr, uint32_t size, uint32_t errors);
+void LogBurnInCheckpoint(const BurnInCheckpoint* checkpoint);
+uint32_t FindLastBurnInCheckpoint(BurnInCheckpoint* checkpoint);
+void ServicePersistentLog(void);
+void ReportPersistentLogStatus(void);
+void GetFlashBankPage(uint32_t address, uint32_t* bank, uint32_t* page);
+uint32_t UnlockFlashForWrite(uint32_t wait);
+
+/**********************************************
+ * Function Prototypes - Bad-Address Quarantine
+ **********************************************/
+
+/* quarantine_table.c */
+void InitializeQuarantine(void);
+void QuarantineAddress(uint32_t address);
+uint32_t IsAddressQuarantined(uint32_t address);
+uint32_t IsRangeQuarantined(uint32_t startAddr, uint32_t size);
+void SetQuarantineExemption(uint32_t startAddr, uint32_t size);
+uint32_t IsQuarantineExempt(uint32_t address);
+void StartQuarantineCursor(QuarantineCursor* cursor);
+uint32_t SkipQuarantinedWord(QuarantineCursor* cursor, uint32_t address);
+uint32_t GetQuarantineCount(void);
+uint32_t GetQuarantineEntry(uint32_t index, uint32_t* address, uint32_t* isBlock);
+void ClearQuarantine(void);
+void ServiceQuarantine(void);
+void ReportQuarantineStatus(void);
+
 /**********************************************
  * Function Prototypes - Advanced Memory Test Patterns
  **********************************************/
 
 /* memory_test_patterns.c */
+extern const MarchAlgorithm marchCAlgorithm;
+extern const MarchAlgorithm marchBAlgorithm;
+extern const uint32_t marchDataBackgrounds[MARCH_NUM_BACKGROUNDS];
+uint32_t RunMarchTest(const MarchAlgorithm* algorithm, uint32_t startAddr, uint32_t size, uint32_t background);
+uint32_t RunMarchTestOrdered(const MarchAlgorithm* algorithm, uint32_t startAddr, uint32_t size,
+                             uint32_t background, uint32_t addressOrder);
 uint32_t RunMarchCTest(uint32_t startAddr, uint32_t size);
+uint32_t GenerateRandomSeed(uint32_t startAddr);
+uint32_t RunRandomDataTest(uint32_t startAddr, uint32_t size, uint32_t seed, uint32_t addressOrder,
+                           MemoryTestStatus* status);
 uint32_t RunGalpatTest(uint32_t startAddr, uint32_t size);
 uint32_t RunWalkingOnesTest(uint32_t startAddr, uint32_t size);
 uint32_t RunWalkingZerosTest(uint32_t startAddr, uint32_t size);
 uint32_t RunModifiedCheckerboardTest(uint32_t startAddr, uint32_t size);
 uint32_t RunButterflyTest(uint32_t startAddr, uint32_t size);
 
+/**********************************************
+ * Function Prototypes - Address Orders
+ **********************************************/
+
+/* address_order.c */
+void StartAddressSequence(AddressSequence* sequence, uint32_t order, uint32_t numWords, uint32_t reverse);
+uint32_t NextAddressIndex(AddressSequence* sequence);
+const char* GetAddressOrderName(uint32_t order);
+
 /**********************************************
  * Function Prototypes - Improved Address Tests
  **********************************************/
@@ -203,15 +787,68 @@ uint32_t GetSRAM1TestStart(void);
 uint32_t GetSRAM2TestStart(void);
 uint32_t GetCCMTestStart(void);
 void RotateTestParameters(uint32_t cycleCounter);
+void GetRegionTestBounds(uint32_t region, uint32_t* startAddr, uint32_t* endAddr);
+void GetRegionTestWindow(uint32_t region, uint32_t* startAddr, uint32_t* size);
+
+/**********************************************
+ * Function Prototypes - Adaptive Escalation
+ **********************************************/
+
+/* adaptive_escalation.c */
+void InitializeAdaptiveControl(void);
+void PlanAdaptiveCycle(void);
+uint32_t GetSampledTestSize(uint32_t region, uint32_t configuredSize);
+void RecordRegionCost(uint32_t region, uint32_t cycles, uint32_t bytes);
+void NotifyBlockFailure(uint32_t address);
+void RunEscalatedTests(void);
+void ReportAdaptiveStatus(void);
+
+/**********************************************
+ * Function Prototypes - Pipelined Retention Test
+ **********************************************/
+
+/* retention_test.c */
+void InitializeRetentionTests(void);
+uint32_t StartRetentionWindow(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t delayMs);
+void ServiceRetentionTests(void);
+uint32_t IsRetentionPending(uint32_t startAddr, uint32_t size);
+void CancelRetentionWindows(uint32_t startAddr, uint32_t size);
+uint32_t ClipWindowForRetention(uint32_t region, uint32_t* startAddr, uint32_t* size);
+void ReportRetentionStatus(void);
+
+/**********************************************
+ * Function Prototypes - Access Width Tests
+ **********************************************/
+
+/* access_width_tests.c */
+uint32_t RunByteAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunHalfwordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunWordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunDoublewordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunUnalignedHalfwordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunUnalignedWordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunAccessWidthTests(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder,
+                             MemoryTestStatus* status);
+
+/**********************************************
+ * Function Prototypes - Hammer Test
+ **********************************************/
+
+/* hammer_test.c */
+uint32_t RunHammerTest(uint32_t startAddr, uint32_t size, uint32_t mode, uint32_t durationMs);
+void ReportHammerStatus(void);
 
 /**********************************************
  * Function Prototypes - UART Command Interface
  **********************************************/
 
 /* uart_command_interface.c */
-void InitCommandInterface(void);
-void ProcessCommands(void);
-void SendResponse(const char* response);
+void InitializeCommandInterface(void);
+void ServiceCommandInterface(void);
+void SuspendCommandInput(void);
+void ResumeCommandInput(void);
+
+/* main.c */
 void ReportConfigStatus(void);
 
 #endif /* MEMORY_TEST_H */
@@ -0,0 +1,182 @@
+/**
+ * Access Width Test Kernels for STM32G473CB Memory Test
+ *
+ * One kernel per access width (byte, halfword, word, doubleword) plus
+ * unaligned halfword and word variants, generated from a single macro
+ * template so each is specialized at compile time with no per-access
+ * dispatch. Elements are written in two interleaved passes over a
+ * background, and every element is verified after each pass, so a write
+ * strobe that disturbs a neighbouring byte lane is caught before the
+ * neighbour is rewritten. Doublewords use LDRD/STRD, which must be aligned;
+ * unaligned halfword and word accesses are legal on the Cortex-M4 S-bus.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Unaligned element types - GCC emits plain LDR/LDRH/STR/STRH for these */
+typedef uint16_t __attribute__((aligned(1))) uint16_unaligned_t;
+typedef uint32_t __attribute__((aligned(1))) uint32_unaligned_t;
+
+/* Function prototypes */
+uint32_t RunByteAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunHalfwordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunWordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunDoublewordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunUnalignedHalfwordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunUnalignedWordAccessTest(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder);
+uint32_t RunAccessWidthTests(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder,
+                             MemoryTestStatus* status);
+
+/* Element value - distinct in every byte lane, truncated to the element width */
+#define WIDTH_ELEMENT_VALUE(type, pattern, index) \
+    ((type)((((uint64_t)((pattern) ^ ((uint32_t)(index) * 0x9E3779B9U))) << 32) | \
+            ((pattern) ^ ((uint32_t)(index) * 0x85EBCA6BU))))
+
+/* Background - inverse pattern in every byte lane */
+#define WIDTH_BACKGROUND(type, pattern) \
+    ((type)((((uint64_t)~(pattern)) << 32) | (uint32_t)~(pattern)))
+
+/**
+  * @brief  Report a mismatching element as errors in the words it covers
+  * @param  testName: Name of the kernel
+  * @param  address: Element address
+  * @param  readValue: Element value read back
+  * @param  expectedValue: Element value expected
+  * @param  width: Element width in bytes
+  * @retval Number of errors recorded
+  * @note   Errors are always recorded per aligned word, with the bytes outside
+  *         the element taken from memory, so the quarantine and the re-check
+  *         in RecordMemoryError see whole words like every other kernel.
+  */
+static uint32_t RecordWidthError(const char* testName, uint32_t address, uint64_t readValue,
+                                 uint64_t expectedValue, uint32_t width)
+{
+    uint32_t errors = 0;
+    uint32_t firstWord = address & ~0x3U;
+    uint32_t lastWord = (address + width - 1) & ~0x3U;
+
+    for (uint32_t word = firstWord; word <= lastWord; word += 4) {
+        uint32_t readWord = *(volatile uint32_t*)word;
+        uint32_t expectedWord = readWord;
+
+        for (uint32_t byte = 0; byte < width; byte++) {
+            uint32_t byteAddr = address + byte;
+            if ((byteAddr & ~0x3U) != word) continue;
+
+            uint32_t shift = (byteAddr & 0x3U) * 8;
+            uint32_t laneMask = 0xFFU << shift;
+            readWord = (readWord & ~laneMask) | ((uint32_t)((readValue >> (byte * 8)) & 0xFF) << shift);
+            expectedWord = (expectedWord & ~laneMask) | ((uint32_t)((expectedValue >> (byte * 8)) & 0xFF) << shift);
+        }
+
+        if (readWord != expectedWord) {
+            errors += RecordMemoryError(testName, word, readWord, expectedWord);
+        }
+    }
+
+    return errors;
+}
+
+/**
+  * Kernel template
+  *   name:    function name
+  *   type:    element type, sets the access width and alignment
+  *   offset:  byte offset of the first element from startAddr
+  *   kernel:  kernel identifier for throughput accounting
+  *   label:   test name used in error reports
+  *
+  * Pass 0 writes the even elements, pass 1 the odd ones. After each pass
+  * every element is read back: written ones must hold their value, the
+  * rest must still hold the background. Both the element writes and the
+  * reads follow addressOrder over the element indices.
+  */
+#define DEFINE_ACCESS_WIDTH_KERNEL(name, type, offset, kernel, label)                       \
+uint32_t name(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder)    \
+{                                                                                            \
+    uint32_t errors = 0;                                                                     \
+    uint32_t start = GET_CYCLE_COUNT();                                                      \
+    volatile uint32_t* words = (volatile uint32_t*)startAddr;                                \
+    volatile type* elements = (volatile type*)(startAddr + (offset));                        \
+    uint32_t count = (size - ((offset) ? sizeof(type) : 0)) / sizeof(type);                  \
+    const type background = WIDTH_BACKGROUND(type, pattern);                                 \
+    uint32_t linear = (addressOrder == ADDRESS_ORDER_UP);                                    \
+    AddressSequence sequence;                                                                \
+                                                                                             \
+    /* Background, written a word at a time */                                               \
+    for (uint32_t i = 0; i < size / 4; i++) {                                                \
+        words[i] = ~pattern;                                                                 \
+    }                                                                                        \
+                                                                                             \
+    for (uint32_t pass = 0; pass < 2; pass++) {                                              \
+        StartAddressSequence(&sequence, addressOrder, count, 0);                             \
+        for (uint32_t n = 0; n < count; n++) {                                               \
+            uint32_t i = linear ? n : NextAddressIndex(&sequence);                           \
+            if ((i & 1) != pass) continue;                                                   \
+            elements[i] = WIDTH_ELEMENT_VALUE(type, pattern, i);                             \
+        }                                                                                    \
+                                                                                             \
+        StartAddressSequence(&sequence, addressOrder, count, 0);                             \
+        for (uint32_t n = 0; n < count; n++) {                                               \
+            uint32_t i = linear ? n : NextAddressIndex(&sequence);                           \
+            type expected = ((i & 1) <= pass) ? WIDTH_ELEMENT_VALUE(type, pattern, i)        \
+                                              : background;                                  \
+            type readValue = elements[i];                                                    \
+            if (readValue != expected) {                                                     \
+                errors += RecordWidthError(label, (uint32_t)&elements[i],                    \
+                                           (uint64_t)readValue, (uint64_t)expected,          \
+                                           sizeof(type));                                    \
+            }                                                                                \
+        }                                                                                    \
+    }                                                                                        \
+                                                                                             \
+    /* Background, two half write passes and two read passes */                              \
+    RecordKernelRun(kernel, size * 4, GET_CYCLE_COUNT() - start);                            \
+                                                                                             \
+    return errors;                                                                           \
+}
+
+DEFINE_ACCESS_WIDTH_KERNEL(RunByteAccessTest, uint8_t, 0, KERNEL_WIDTH_8, "Byte Access")
+DEFINE_ACCESS_WIDTH_KERNEL(RunHalfwordAccessTest, uint16_t, 0, KERNEL_WIDTH_16, "Halfword Access")
+DEFINE_ACCESS_WIDTH_KERNEL(RunWordAccessTest, uint32_t, 0, KERNEL_WIDTH_32, "Word Access")
+DEFINE_ACCESS_WIDTH_KERNEL(RunDoublewordAccessTest, uint64_t, 0, KERNEL_WIDTH_64, "Doubleword Access")
+DEFINE_ACCESS_WIDTH_KERNEL(RunUnalignedHalfwordAccessTest, uint16_unaligned_t, 1, KERNEL_WIDTH_16_UNALIGNED, "Unaligned Halfword Access")
+DEFINE_ACCESS_WIDTH_KERNEL(RunUnalignedWordAccessTest, uint32_unaligned_t, 1, KERNEL_WIDTH_32_UNALIGNED, "Unaligned Word Access")
+
+/**
+  * @brief  Run every access width kernel over a window
+  * @param  startAddr: Start address of memory region to test, word aligned
+  * @param  size: Size of memory region to test, a multiple of 8
+  * @param  pattern: Base pattern for element values
+  * @param  addressOrder: ADDRESS_ORDER_x each kernel walks its elements in
+  * @param  status: Pointer to status structure to update
+  * @retval Number of errors detected
+  */
+uint32_t RunAccessWidthTests(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t addressOrder,
+                             MemoryTestStatus* status)
+{
+    uint32_t errors = 0;
+    size &= ~0x7U;
+    if (size == 0) return 0;
+
+    status->dataTestTotal++;
+
+    errors += RunByteAccessTest(startAddr, size, pattern, addressOrder);
+    errors += RunHalfwordAccessTest(startAddr, size, pattern, addressOrder);
+    errors += RunWordAccessTest(startAddr, size, pattern, addressOrder);
+    errors += RunDoublewordAccessTest(startAddr, size, pattern, addressOrder);
+    errors += RunUnalignedHalfwordAccessTest(startAddr, size, pattern, addressOrder);
+    errors += RunUnalignedWordAccessTest(startAddr, size, pattern, addressOrder);
+
+    if (errors == 0) {
+        status->dataTestSuccess++;
+    }
+
+    return errors;
+}
@@ -0,0 +1,409 @@
+/**
+ * Adaptive Test Escalation for STM32G473CB Memory Test
+ *
+ * Shifts test effort from clean regions to blocks that have just failed.
+ * Regions that stay clean decay to a fraction of their configured window,
+ * and the CPU time this frees is spent running March B, the March data
+ * backgrounds, retention and read-hammer stages on each failing block and
+ * its neighbours for testConfig.escalationCycles cycles. The time freed is
+ * estimated from the measured cost per byte of each region, so the total
+ * cycle time stays about the same while a fault is being characterized.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern MemoryTestConfig testConfig;
+extern volatile uint32_t testCycleCounter;
+
+/* Escalation stages, run in rotation on each escalated block */
+#define STAGE_MARCH_B          0
+#define STAGE_BACKGROUNDS      1
+#define STAGE_RETENTION        2
+#define STAGE_HAMMER           3
+#define NUM_ESCALATION_STAGES  4
+
+/* Fixed-point scale for cycles-per-byte estimates */
+#define COST_FRACTION_BITS     8
+
+/* One block under intensive test */
+typedef struct {
+    uint32_t startAddr;            /* Block start, 0 if the slot is free */
+    uint32_t cyclesLeft;           /* Test cycles left before the block is released */
+    uint32_t stage;                /* Next stage to run */
+    uint32_t background;           /* Next data background index */
+    uint32_t errors;               /* Errors found while escalated */
+} EscalatedBlock;
+
+/* Per-region sampling state */
+typedef struct {
+    uint32_t cleanStreak;          /* Consecutive cycles without new errors */
+    uint32_t decayLevel;           /* Window is scaled by 1 / (1 << decayLevel) */
+    uint32_t lastErrors;           /* totalErrors at the start of the cycle */
+    uint32_t cyclesPerByte;        /* Measured cost, COST_FRACTION_BITS fixed point */
+} RegionSampling;
+
+/* Function prototypes */
+void InitializeAdaptiveControl(void);
+void PlanAdaptiveCycle(void);
+uint32_t GetSampledTestSize(uint32_t region, uint32_t configuredSize);
+void RecordRegionCost(uint32_t region, uint32_t cycles, uint32_t bytes);
+void NotifyBlockFailure(uint32_t address);
+void RunEscalatedTests(void);
+void ReportAdaptiveStatus(void);
+
+static EscalatedBlock escalatedBlocks[ESCALATION_MAX_BLOCKS];
+static RegionSampling regionSampling[NUM_TEST_REGIONS];
+
+/* Cycles freed by sampling this cycle, spent on escalated blocks */
+static uint32_t escalationBudget = 0;
+
+/* Slot the next cycle starts from, so every block gets its turn */
+static uint32_t nextSlot = 0;
+
+/* Statistics */
+static uint32_t escalationsStarted = 0;
+static uint32_t escalationsDropped = 0;
+static uint32_t stagesRun = 0;
+
+/**
+  * @brief  Reset the sampling levels and release all escalated blocks
+  */
+void InitializeAdaptiveControl(void)
+{
+    memset(escalatedBlocks, 0, sizeof(escalatedBlocks));
+    memset(regionSampling, 0, sizeof(regionSampling));
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        regionSampling[region].lastErrors = GetRegionStatus(region)->totalErrors;
+    }
+
+    escalationBudget = 0;
+    nextSlot = 0;
+    escalationsStarted = 0;
+    escalationsDropped = 0;
+    stagesRun = 0;
+}
+
+/**
+  * @brief  Count the blocks currently under escalation
+  * @retval Number of active slots
+  */
+static uint32_t GetActiveEscalations(void)
+{
+    uint32_t active = 0;
+
+    for (uint32_t i = 0; i < ESCALATION_MAX_BLOCKS; i++) {
+        if (escalatedBlocks[i].startAddr != 0) active++;
+    }
+
+    return active;
+}
+
+/**
+  * @brief  Update each region's sampling level at the start of a cycle
+  * @note   A region that found errors last cycle goes back to its full window.
+  *         A clean region halves its window every testConfig.decayCycles
+  *         cycles, and is held at half or less while blocks are escalated.
+  */
+void PlanAdaptiveCycle(void)
+{
+    uint32_t escalating = (GetActiveEscalations() > 0);
+    uint32_t decayCycles = (testConfig.decayCycles > 0) ? testConfig.decayCycles : 1;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        RegionSampling* sampling = &regionSampling[region];
+        uint32_t totalErrors = GetRegionStatus(region)->totalErrors;
+
+        if (totalErrors != sampling->lastErrors) {
+            sampling->cleanStreak = 0;
+        }
+        else {
+            sampling->cleanStreak++;
+        }
+        sampling->lastErrors = totalErrors;
+
+        sampling->decayLevel = sampling->cleanStreak / decayCycles;
+        if (sampling->decayLevel > ESCALATION_MAX_DECAY) {
+            sampling->decayLevel = ESCALATION_MAX_DECAY;
+        }
+
+        /* Make room for escalated blocks in regions that aren't failing */
+        if (escalating && sampling->cleanStreak > 0 && sampling->decayLevel == 0) {
+            sampling->decayLevel = 1;
+        }
+    }
+
+    escalationBudget = 0;
+}
+
+/**
+  * @brief  Get the window size to test in a region this cycle
+  * @param  region: Region identifier
+  * @param  configuredSize: Full window size from the configuration
+  * @retval Sampled window size, word aligned and never zero
+  */
+uint32_t GetSampledTestSize(uint32_t region, uint32_t configuredSize)
+{
+    if (region >= NUM_TEST_REGIONS) return configuredSize;
+
+    uint32_t size = (configuredSize >> regionSampling[region].decayLevel) & ~0x3U;
+    if (size < 4) size = 4;
+
+    /* Bill the bytes skipped this cycle to the escalation budget */
+    uint32_t skipped = configuredSize - size;
+    escalationBudget += (skipped * regionSampling[region].cyclesPerByte) >> COST_FRACTION_BITS;
+
+    return size;
+}
+
+/**
+  * @brief  Record how long a region's tests took, to price the bytes skipped
+  * @param  region: Region identifier
+  * @param  cycles: CPU cycles spent on the region
+  * @param  bytes: Window size that was tested
+  */
+void RecordRegionCost(uint32_t region, uint32_t cycles, uint32_t bytes)
+{
+    if (region >= NUM_TEST_REGIONS || bytes == 0) return;
+
+    RegionSampling* sampling = &regionSampling[region];
+    uint32_t cost = (uint32_t)(((uint64_t)cycles << COST_FRACTION_BITS) / bytes);
+
+    /* Moving average over ~8 cycles, seeded by the first measurement */
+    if (sampling->cyclesPerByte == 0) {
+        sampling->cyclesPerByte = cost;
+    }
+    else {
+        sampling->cyclesPerByte = sampling->cyclesPerByte - (sampling->cyclesPerByte >> 3) + (cost >> 3);
+    }
+}
+
+/**
+  * @brief  Start or refresh escalation of a single block
+  * @param  blockAddr: Block start address
+  */
+static void EscalateBlock(uint32_t blockAddr)
+{
+    EscalatedBlock* freeSlot = NULL;
+
+    for (uint32_t i = 0; i < ESCALATION_MAX_BLOCKS; i++) {
+        if (escalatedBlocks[i].startAddr == blockAddr) {
+            escalatedBlocks[i].cyclesLeft = testConfig.escalationCycles;
+            return;
+        }
+        if (escalatedBlocks[i].startAddr == 0 && freeSlot == NULL) {
+            freeSlot = &escalatedBlocks[i];
+        }
+    }
+
+    if (freeSlot == NULL) {
+        escalationsDropped++;
+        return;
+    }
+
+    freeSlot->startAddr = blockAddr;
+    freeSlot->cyclesLeft = testConfig.escalationCycles;
+    freeSlot->stage = STAGE_MARCH_B;
+    freeSlot->background = 0;
+    freeSlot->errors = 0;
+    escalationsStarted++;
+}
+
+/**
+  * @brief  Escalate the block containing a failing address and its neighbours
+  * @param  address: Failing address
+  * @note   Flash is skipped - it can't be rewritten in place, and ECC already
+  *         reports its faults.
+  */
+void NotifyBlockFailure(uint32_t address)
+{
+    uint32_t region = GetRegionForAddress(address);
+    if (region == REGION_NONE || region == REGION_FLASH) return;
+
+    uint32_t startAddr, endAddr;
+    GetRegionTestBounds(region, &startAddr, &endAddr);
+    if (address < startAddr || address >= endAddr) return;
+
+    uint32_t blockAddr = address & ~(ESCALATION_BLOCK_SIZE - 1);
+
+    /* Failing block first, so it keeps a slot if the table is full */
+    EscalateBlock(blockAddr);
+    if (blockAddr >= startAddr + ESCALATION_BLOCK_SIZE) {
+        EscalateBlock(blockAddr - ESCALATION_BLOCK_SIZE);
+    }
+    if (blockAddr + 2 * ESCALATION_BLOCK_SIZE <= endAddr) {
+        EscalateBlock(blockAddr + ESCALATION_BLOCK_SIZE);
+    }
+}
+
+/**
+  * @brief  Read-hammer a few aggressor words, then verify the whole block
+  * @param  startAddr: Block start address
+  * @param  pattern: Victim background pattern
+  * @retval Number of errors detected
+  */
+static uint32_t RunBlockHammer(uint32_t startAddr, uint32_t pattern)
+{
+    uint32_t errors = 0;
+    volatile uint32_t* base = (volatile uint32_t*)startAddr;
+    uint32_t numWords = ESCALATION_BLOCK_SIZE / 4;
+    uint32_t aggressors[3] = { 0, numWords / 2, numWords - 1 };
+
+    /* Victims hold the background, aggressors hold its inverse */
+    for (uint32_t i = 0; i < numWords; i++) {
+        base[i] = pattern;
+    }
+    for (uint32_t a = 0; a < 3; a++) {
+        base[aggressors[a]] = ~pattern;
+    }
+
+    for (uint32_t n = 0; n < ESCALATION_HAMMER_READS; n++) {
+        (void)base[aggressors[n % 3]];
+    }
+
+    for (uint32_t i = 0; i < numWords; i++) {
+        uint32_t expected = (i == aggressors[0] || i == aggressors[1] || i == aggressors[2]) ? ~pattern : pattern;
+        uint32_t readValue = base[i];
+        if (readValue != expected) {
+            errors += RecordMemoryError("Escalated Hammer", (uint32_t)&base[i], readValue, expected);
+        }
+    }
+
+    return errors;
+}
+
+/**
+  * @brief  Run the next stage on one escalated block
+  * @param  block: Escalated block
+  * @retval Number of errors detected
+  */
+static uint32_t RunEscalationStage(EscalatedBlock* block)
+{
+    uint32_t errors = 0;
+    uint32_t background = marchDataBackgrounds[block->background];
+
+    switch (block->stage) {
+        case STAGE_MARCH_B:
+            UpdateTestOperation("Escalated March B");
+            errors = RunMarchTest(&marchBAlgorithm, block->startAddr, ESCALATION_BLOCK_SIZE, background);
+            break;
+
+        case STAGE_BACKGROUNDS:
+            /* March C over every data background in turn, one per visit */
+            UpdateTestOperation("Escalated March C Background");
+            errors = RunMarchTest(&marchCAlgorithm, block->startAddr, ESCALATION_BLOCK_SIZE, background);
+            block->background = (block->background + 1) % MARCH_NUM_BACKGROUNDS;
+            break;
+
+        case STAGE_RETENTION:
+            /* Held and verified by the retention pipeline, which counts
+               its errors against the region */
+            UpdateTestOperation("Escalated Retention");
+            StartRetentionWindow(block->startAddr, ESCALATION_BLOCK_SIZE, background, ESCALATION_RETENTION_MS);
+            break;
+
+        case STAGE_HAMMER:
+        default:
+            UpdateTestOperation("Escalated Hammer");
+            errors = RunBlockHammer(block->startAddr, background);
+            break;
+    }
+
+    block->stage = (block->stage + 1) % NUM_ESCALATION_STAGES;
+    stagesRun++;
+
+    return errors;
+}
+
+/**
+  * @brief  Spend this cycle's freed time on the escalated blocks
+  * @note   Always runs at least one stage so escalation makes progress
+  *         before any region has been priced. Each cycle starts after the
+  *         last block served, so blocks share the budget in turn. The block
+  *         is exempt from the quarantine while its stage runs, so the word
+  *         that put it here is tested again. Each block ages by one cycle.
+  */
+void RunEscalatedTests(void)
+{
+    uint32_t start = GET_CYCLE_COUNT();
+    uint32_t ranStage = 0;
+    uint32_t first = nextSlot;
+
+    for (uint32_t n = 0; n < ESCALATION_MAX_BLOCKS; n++) {
+        uint32_t i = (first + n) % ESCALATION_MAX_BLOCKS;
+        EscalatedBlock* block = &escalatedBlocks[i];
+        if (block->startAddr == 0) continue;
+
+        /* Leave the block alone while it holds a retention pattern */
+        if (IsRetentionPending(block->startAddr, ESCALATION_BLOCK_SIZE)) continue;
+
+        if (ranStage && (GET_CYCLE_COUNT() - start) >= escalationBudget) break;
+
+        SetQuarantineExemption(block->startAddr, ESCALATION_BLOCK_SIZE);
+        uint32_t errors = RunEscalationStage(block);
+        SetQuarantineExemption(0, 0);
+        ranStage = 1;
+        nextSlot = (i + 1) % ESCALATION_MAX_BLOCKS;
+
+        if (errors > 0) {
+            uint32_t region = GetRegionForAddress(block->startAddr);
+            GetRegionStatus(region)->totalErrors += errors;
+            block->errors += errors;
+        }
+
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+
+    /* Age all blocks, whether or not they got a stage this cycle */
+    for (uint32_t i = 0; i < ESCALATION_MAX_BLOCKS; i++) {
+        EscalatedBlock* block = &escalatedBlocks[i];
+        if (block->startAddr == 0) continue;
+
+        if (block->cyclesLeft > 0) block->cyclesLeft--;
+        if (block->cyclesLeft == 0) {
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer),
+                     "Escalation released: block=0x%08lX errors=%lu\r\n",
+                     block->startAddr, block->errors);
+            if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+            block->startAddr = 0;
+        }
+    }
+}
+
+/**
+  * @brief  Report sampling levels and escalated blocks
+  */
+void ReportAdaptiveStatus(void)
+{
+    char buffer[256];
+
+    snprintf(buffer, sizeof(buffer),
+             "Adaptive: sampling Flash=1/%lu SRAM1=1/%lu SRAM2=1/%lu CCM=1/%lu | "
+             "Escalated=%lu started=%lu dropped=%lu stages=%lu\r\n",
+             1UL << regionSampling[REGION_FLASH].decayLevel,
+             1UL << regionSampling[REGION_SRAM1].decayLevel,
+             1UL << regionSampling[REGION_SRAM2].decayLevel,
+             1UL << regionSampling[REGION_CCM_SRAM].decayLevel,
+             GetActiveEscalations(), escalationsStarted, escalationsDropped, stagesRun);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    for (uint32_t i = 0; i < ESCALATION_MAX_BLOCKS; i++) {
+        EscalatedBlock* block = &escalatedBlocks[i];
+        if (block->startAddr == 0) continue;
+
+        snprintf(buffer, sizeof(buffer),
+                 "  Block 0x%08lX (%s): %lu cycles left, %lu errors\r\n",
+                 block->startAddr,
+                 GetRegionName(GetRegionForAddress(block->startAddr)),
+                 block->cyclesLeft, block->errors);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+}
@@ -0,0 +1,150 @@
+/**
+ * Address Order Sequences for STM32G473CB Memory Test
+ *
+ * Generates the word indices of a test window in one of several orders:
+ * ascending, descending, Gray code, or a maximal-length Galois LFSR
+ * permutation. Each step is computed from the previous one in O(1), with
+ * no index table. Gray and LFSR sequences run over the next power of two
+ * and skip indices past the end of the window, which costs at most one
+ * extra step per index on average. The LFSR can also be stepped backwards,
+ * so every order has a reverse for March "down" elements.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* LFSR widths covered by the feedback table */
+#define LFSR_MIN_BITS   2
+#define LFSR_MAX_BITS   24
+
+/* Function prototypes */
+void StartAddressSequence(AddressSequence* sequence, uint32_t order, uint32_t numWords, uint32_t reverse);
+uint32_t NextAddressIndex(AddressSequence* sequence);
+const char* GetAddressOrderName(uint32_t order);
+
+/* Galois feedback masks for maximal-length LFSRs, indexed by width
+   (taps from Xilinx XAPP052, bit n-1 set for tap n) */
+static const uint32_t lfsrTaps[LFSR_MAX_BITS + 1] = {
+    0, 0,
+    0x000003, 0x000006, 0x00000C, 0x000014, 0x000030, 0x000060, 0x0000B8,
+    0x000110, 0x000240, 0x000500, 0x000829, 0x00100D, 0x002015, 0x006000,
+    0x00B400, 0x012000, 0x020400, 0x040023, 0x090000, 0x140000, 0x300000,
+    0x420000, 0xE10000
+};
+
+static const char* const addressOrderNames[NUM_ADDRESS_ORDERS] = {
+    "up", "down", "Gray", "LFSR"
+};
+
+/**
+  * @brief  Step a Galois LFSR forward
+  */
+static uint32_t LfsrForward(uint32_t state, uint32_t taps)
+{
+    uint32_t lsb = state & 1;
+    state >>= 1;
+    return lsb ? state ^ taps : state;
+}
+
+/**
+  * @brief  Step a Galois LFSR backward
+  * @note   The top bit after a forward step is the bit that was shifted out
+  */
+static uint32_t LfsrBackward(uint32_t state, uint32_t taps, uint32_t bits)
+{
+    uint32_t mask = (1U << bits) - 1;
+
+    if ((state >> (bits - 1)) & 1) {
+        return (((state ^ taps) << 1) | 1) & mask;
+    }
+    return (state << 1) & mask;
+}
+
+/**
+  * @brief  Start iterating over a window's word indices
+  * @param  sequence: Iterator to initialize
+  * @param  order: ADDRESS_ORDER_x
+  * @param  numWords: Number of words in the window
+  * @param  reverse: Non-zero to walk the order backwards
+  */
+void StartAddressSequence(AddressSequence* sequence, uint32_t order, uint32_t numWords, uint32_t reverse)
+{
+    /* Descending is ascending walked backwards */
+    if (order == ADDRESS_ORDER_DOWN) {
+        order = ADDRESS_ORDER_UP;
+        reverse = !reverse;
+    }
+
+    sequence->order = order;
+    sequence->numWords = numWords;
+    sequence->reverse = reverse ? 1 : 0;
+
+    /* Smallest index space that holds every word */
+    uint32_t bits = LFSR_MIN_BITS;
+    while (bits < LFSR_MAX_BITS && (1U << bits) < numWords + 1) bits++;
+    sequence->bits = bits;
+    sequence->taps = lfsrTaps[bits];
+
+    switch (order) {
+        case ADDRESS_ORDER_GRAY:
+            /* Position in the Gray sequence, one past the next to visit */
+            sequence->state = reverse ? (1U << bits) : 0;
+            break;
+
+        case ADDRESS_ORDER_LFSR:
+            /* States 1..2^bits-1 map to indices 0..2^bits-2; state 1 comes first */
+            sequence->state = reverse ? 1 : LfsrBackward(1, sequence->taps, bits);
+            break;
+
+        case ADDRESS_ORDER_UP:
+        default:
+            sequence->order = ADDRESS_ORDER_UP;
+            sequence->state = reverse ? numWords : 0;
+            break;
+    }
+}
+
+/**
+  * @brief  Get the next word index
+  * @param  sequence: Iterator
+  * @retval Word index; call exactly numWords times per sequence
+  */
+uint32_t NextAddressIndex(AddressSequence* sequence)
+{
+    uint32_t index;
+
+    switch (sequence->order) {
+        case ADDRESS_ORDER_GRAY:
+            do {
+                uint32_t position = sequence->reverse ? --sequence->state : sequence->state++;
+                index = position ^ (position >> 1);
+            } while (index >= sequence->numWords);
+            return index;
+
+        case ADDRESS_ORDER_LFSR:
+            do {
+                sequence->state = sequence->reverse ?
+                    LfsrBackward(sequence->state, sequence->taps, sequence->bits) :
+                    LfsrForward(sequence->state, sequence->taps);
+                index = sequence->state - 1;
+            } while (index >= sequence->numWords);
+            return index;
+
+        case ADDRESS_ORDER_UP:
+        default:
+            return sequence->reverse ? --sequence->state : sequence->state++;
+    }
+}
+
+/**
+  * @brief  Get the printable name of an address order
+  * @param  order: ADDRESS_ORDER_x
+  * @retval Order name
+  */
+const char* GetAddressOrderName(uint32_t order)
+{
+    return (order < NUM_ADDRESS_ORDERS) ? addressOrderNames[order] : "unknown";
+}
@@ -53,15 +53,9 @@ uint32_t RunAddressTest(uint32_t startAddr, uint32_t size, uint32_t totalSize)
         expectedValue = GenerateAddressPattern((uint32_t)addr);
 
         /* Read and verify */
-        if (*addr != expectedValue) {
-            errors++;
-
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Address Test Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     (uint32_t)addr, *addr, expectedValue);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        uint32_t readValue = *addr;
+        if (readValue != expectedValue) {
+            errors += RecordMemoryError("Address Test", (uint32_t)addr, readValue, expectedValue);
         }
     }
 
@@ -154,26 +148,14 @@ uint32_t RunEnhancedButterflyTest(uint32_t startAddr, uint32_t size, uint32_t to
         *(uint32_t*)pairs[i][1] = pattern2;
 
         /* Verify patterns */
-        if (*(uint32_t*)pairs[i][0] != pattern1) {
-            errors++;
-
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Butterfly Test Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     pairs[i][0], *(uint32_t*)pairs[i][0], pattern1);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        uint32_t readValue0 = *(uint32_t*)pairs[i][0];
+        if (readValue0 != pattern1) {
+            errors += RecordMemoryError("Butterfly Test", pairs[i][0], readValue0, pattern1);
         }
 
-        if (*(uint32_t*)pairs[i][1] != pattern2) {
-            errors++;
-
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Butterfly Test Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     pairs[i][1], *(uint32_t*)pairs[i][1], pattern2);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        uint32_t readValue1 = *(uint32_t*)pairs[i][1];
+        if (readValue1 != pattern2) {
+            errors += RecordMemoryError("Butterfly Test", pairs[i][1], readValue1, pattern2);
         }
 
         /* Swap patterns and test again */
@@ -181,8 +163,8 @@ uint32_t RunEnhancedButterflyTest(uint32_t startAddr, uint32_t size, uint32_t to
         *(uint32_t*)pairs[i][1] = pattern1;
 
         /* Verify patterns */
-        if (*(uint32_t*)pairs[i][0] != pattern2) errors++;
-        if (*(uint32_t*)pairs[i][1] != pattern1) errors++;
+        if (*(uint32_t*)pairs[i][0] != pattern2 && !IsAddressQuarantined(pairs[i][0])) errors++;
+        if (*(uint32_t*)pairs[i][1] != pattern1 && !IsAddressQuarantined(pairs[i][1])) errors++;
     }
 
     return errors;
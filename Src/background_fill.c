@@ -0,0 +1,173 @@
+/**
+ * Background Fill for STM32G473CB Memory Test
+ *
+ * Fills a window with a constant background for the March and
+ * checkerboard engines. A zero background in CCM SRAM can come from the
+ * SYSCFG hardware erase (SCSR.CCMER), which clears the whole 32KB while
+ * the CPU waits on CCMBSY. The erase also clears the .ccmram kernels, so
+ * they are copied back afterwards. It is used only when nothing else in
+ * CCM must be preserved and its measured cost beats the store loop. Every
+ * other fill uses STM bursts of eight words. The G4 has no hardware erase
+ * for SRAM2 (unlike the L4), so SRAM1 and SRAM2 always use the burst path.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* SYSCFG_SKR unlock sequence for SCSR.CCMER */
+#define CCM_ERASE_KEY1        0xCA
+#define CCM_ERASE_KEY2        0x53
+#define CCM_ERASE_TIMEOUT_MS  10
+
+/* Smallest window for which the erase is tried before it has been measured */
+#define CCM_ERASE_MIN_SIZE    0x1000
+
+/* Function prototypes */
+void FillBackground(uint32_t startAddr, uint32_t size, uint32_t value);
+void ReportBackgroundFillStatus(void);
+
+/* Measured costs */
+static uint32_t burstCyclesPerKB = 0;     /* Store loop, smoothed */
+static uint32_t eraseCycles = 0;          /* Erase plus code restore, last measured */
+
+/* Statistics */
+static uint32_t burstFills = 0;
+static uint32_t hardwareErases = 0;
+static int64_t cyclesSaved = 0;
+
+/**
+  * @brief  Store a value to every word of a window in eight-word bursts
+  * @param  startAddr: Window start, word aligned
+  * @param  size: Window size in bytes
+  * @param  value: Value to store
+  * @note   r7 is left out of the burst: it is the frame pointer in Debug builds
+  */
+static void BurstFill(uint32_t startAddr, uint32_t size, uint32_t value)
+{
+    uint32_t* addr = (uint32_t*)startAddr;
+    uint32_t bursts = size / 32;
+
+    if (bursts > 0) {
+        __asm volatile (
+            "mov   r4, %[v]            \n"
+            "mov   r5, %[v]            \n"
+            "mov   r6, %[v]            \n"
+            "mov   r8, %[v]            \n"
+            "mov   r9, %[v]            \n"
+            "mov   r10, %[v]           \n"
+            "mov   r11, %[v]           \n"
+            "mov   r12, %[v]           \n"
+            "1:                        \n"
+            "stmia %[a]!, {r4-r6, r8-r12} \n"
+            "subs  %[n], %[n], #1      \n"
+            "bne   1b                  \n"
+            : [a] "+r" (addr), [n] "+r" (bursts)
+            : [v] "r" (value)
+            : "r4", "r5", "r6", "r8", "r9", "r10", "r11", "r12", "cc", "memory");
+    }
+
+    /* Tail of fewer than eight words */
+    for (uint32_t i = 0; i < (size % 32) / 4; i++) {
+        ((volatile uint32_t*)addr)[i] = value;
+    }
+}
+
+/**
+  * @brief  Check whether the CCM hardware erase may stand in for a zero fill
+  * @param  startAddr: Window start
+  * @param  size: Window size in bytes
+  * @retval 1 if the erase is allowed and expected to be faster
+  */
+static uint32_t CanEraseCCM(uint32_t startAddr, uint32_t size)
+{
+    if (GetRegionForAddress(startAddr) != REGION_CCM_SRAM) return 0;
+
+    /* The erase clears all of CCM - no retention pattern may be in flight */
+    if (IsRetentionPending(CCM_SRAM_START_ADDR, CCM_SRAM_SIZE)) return 0;
+
+    /* Until both paths are measured, only try it on larger windows */
+    if (eraseCycles == 0 || burstCyclesPerKB == 0) return (size >= CCM_ERASE_MIN_SIZE);
+
+    return ((uint64_t)size * burstCyclesPerKB / 1024 > eraseCycles);
+}
+
+/**
+  * @brief  Clear CCM SRAM with the SYSCFG hardware erase
+  * @retval 1 if the erase completed
+  */
+static uint32_t EraseCCM(void)
+{
+    uint32_t startTick = HAL_GetTick();
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+
+    /* CCMER is write-protected; the key sequence unlocks it once */
+    SYSCFG->SKR = CCM_ERASE_KEY1;
+    SYSCFG->SKR = CCM_ERASE_KEY2;
+    SYSCFG->SCSR |= SYSCFG_SCSR_CCMER;
+
+    while (SYSCFG->SCSR & SYSCFG_SCSR_CCMBSY) {
+        if (HAL_GetTick() - startTick > CCM_ERASE_TIMEOUT_MS) return 0;
+    }
+
+    /* The .ccmram kernels went with everything else */
+    InitializeCCMCode();
+
+    return 1;
+}
+
+/**
+  * @brief  Fill a window with a background value
+  * @param  startAddr: Window start, word aligned
+  * @param  size: Window size in bytes
+  * @param  value: Background value
+  */
+void FillBackground(uint32_t startAddr, uint32_t size, uint32_t value)
+{
+    uint32_t start = GET_CYCLE_COUNT();
+
+    if (value == 0 && CanEraseCCM(startAddr, size) && EraseCCM()) {
+        eraseCycles = GET_CYCLE_COUNT() - start;
+        hardwareErases++;
+
+        /* Saving against what the store loop would have taken */
+        if (burstCyclesPerKB > 0) {
+            cyclesSaved += (int64_t)((uint64_t)size * burstCyclesPerKB / 1024) - eraseCycles;
+        }
+        return;
+    }
+
+    BurstFill(startAddr, size, value);
+
+    uint32_t cycles = GET_CYCLE_COUNT() - start;
+    burstFills++;
+
+    if (size >= 1024) {
+        uint32_t perKB = (uint32_t)((uint64_t)cycles * 1024 / size);
+        burstCyclesPerKB = burstCyclesPerKB ? (burstCyclesPerKB * 7 + perKB) / 8 : perKB;
+    }
+}
+
+/**
+  * @brief  Report background fills and the cycles saved by hardware erase
+  */
+void ReportBackgroundFillStatus(void)
+{
+    char buffer[160];
+
+    if (hardwareErases == 0 && burstFills == 0) return;
+
+    int32_t savedPerCycle = testCycleCounter ? (int32_t)(cyclesSaved / (int64_t)testCycleCounter) : 0;
+    snprintf(buffer, sizeof(buffer),
+             "Background fill: burst=%lu (%lu cycles/KB) CCM erase=%lu (%lu cycles) saved=%ldus/cycle\r\n",
+             burstFills, burstCyclesPerKB, hardwareErases, eraseCycles,
+             savedPerCycle / (int32_t)(SystemCoreClock / 1000000U));
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,351 @@
+/**
+ * Burn-In Mode for STM32G473CB Memory Test
+ *
+ * A chamber burn-in runs for days with nobody reading the console, and the
+ * per-second status reports and per-event lines cost test time without
+ * telling anyone anything. In burn-in mode the status reports, the periodic
+ * configuration dump and the per-event lines are all switched off. Each
+ * cycle only adds to 64-bit totals: cycles, errors per region, bytes moved
+ * by the kernels and the temperature and supply range seen. A one-line
+ * heartbeat goes out every burnInHeartbeatSeconds. Every
+ * burnInSummaryMinutes a summary line goes out and the totals are written
+ * to the persistent log as a checkpoint.
+ *
+ * The totals live in .noinit, so a watchdog reset carries on from where it
+ * stopped. After a power loss the newest checkpoint in the log is picked
+ * up instead, losing at most one summary interval. The summary reports the
+ * share of CPU time burn-in itself took, so the overhead can be checked.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Marks valid totals in .noinit */
+#define BURN_IN_MAGIC         0x4255524EU   /* "BURN" */
+
+/* Totals that survive a reset */
+typedef struct {
+    uint32_t magic;
+    uint32_t active;
+    uint64_t elapsedMs;
+    uint64_t cycles;
+    uint64_t regionErrors[NUM_TEST_REGIONS];
+    uint64_t priorErrors;            /* From a checkpoint, not split by region */
+    uint64_t bytes;
+    uint64_t overheadCycles;         /* Spent on burn-in output and checkpoints */
+    uint32_t resets;
+    uint32_t checkpoints;
+    int16_t minTemperatureC;
+    int16_t maxTemperatureC;
+    uint16_t minVddaMv;
+    uint16_t maxVddaMv;
+    uint32_t check;
+} BurnInState;
+
+/* Function prototypes */
+void InitializeBurnIn(void);
+void StartBurnIn(void);
+void StopBurnIn(void);
+uint32_t IsBurnInActive(void);
+void ServiceBurnIn(const uint32_t* cycleErrors);
+
+__attribute__((section(".noinit"))) static BurnInState burnIn;
+
+/* Progress since boot */
+static uint32_t lastServiceTick = 0;
+static uint64_t lastKernelBytes = 0;
+static uint64_t nextHeartbeatMs = 0;
+static uint64_t nextSummaryMs = 0;
+
+/**
+  * @brief  Compute the check word of the totals
+  * @retval XOR of every word before the check word, folded with the magic
+  */
+static uint32_t ComputeBurnInCheck(void)
+{
+    uint32_t check = BURN_IN_MAGIC;
+
+    for (const uint32_t* word = (const uint32_t*)&burnIn; word < &burnIn.check; word++) {
+        check ^= *word;
+    }
+    return check;
+}
+
+/**
+  * @brief  Clear the totals
+  */
+static void ResetBurnInTotals(void)
+{
+    memset(&burnIn, 0, sizeof(burnIn));
+    burnIn.magic = BURN_IN_MAGIC;
+    burnIn.minTemperatureC = INT16_MAX;
+    burnIn.maxTemperatureC = INT16_MIN;
+    burnIn.minVddaMv = UINT16_MAX;
+}
+
+/**
+  * @brief  Get the elapsed time an interval from now
+  * @param  intervalMs: Interval, 0 for never
+  * @retval Elapsed time the interval ends at
+  */
+static uint64_t GetBurnInDeadline(uint64_t intervalMs)
+{
+    return intervalMs ? burnIn.elapsedMs + intervalMs : UINT64_MAX;
+}
+
+/**
+  * @brief  Start counting from this cycle on
+  */
+static void MarkBurnInStart(void)
+{
+    lastServiceTick = HAL_GetTick();
+    lastKernelBytes = GetKernelBytes();
+    nextHeartbeatMs = GetBurnInDeadline((uint64_t)testConfig.burnInHeartbeatSeconds * 1000);
+    nextSummaryMs = GetBurnInDeadline((uint64_t)testConfig.burnInSummaryMinutes * 60000);
+}
+
+/**
+  * @brief  Format a 64-bit count in decimal
+  * @param  text: Receives the digits, at least 21 characters
+  * @param  value: Count to format
+  * @retval text
+  */
+static const char* FormatCount(char* text, uint64_t value)
+{
+    /* 32-bit printf: split into a high part and nine low digits */
+    if (value >= 1000000000ULL) {
+        snprintf(text, 21, "%lu%09lu", (uint32_t)(value / 1000000000ULL), (uint32_t)(value % 1000000000ULL));
+    }
+    else {
+        snprintf(text, 21, "%lu", (uint32_t)value);
+    }
+    return text;
+}
+
+/**
+  * @brief  Total errors, including those carried over from a checkpoint
+  * @retval Error count
+  */
+static uint64_t GetBurnInErrors(void)
+{
+    uint64_t errors = burnIn.priorErrors;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        errors += burnIn.regionErrors[region];
+    }
+    return errors;
+}
+
+/**
+  * @brief  Write the totals to the persistent log
+  */
+static void WriteBurnInCheckpoint(void)
+{
+    BurnInCheckpoint checkpoint;
+
+    checkpoint.active = burnIn.active;
+    checkpoint.elapsedSeconds = (uint32_t)(burnIn.elapsedMs / 1000);
+    checkpoint.cycles = burnIn.cycles;
+    checkpoint.errors = GetBurnInErrors();
+    checkpoint.megabytes = (uint32_t)(burnIn.bytes >> 20);
+    LogBurnInCheckpoint(&checkpoint);
+
+    burnIn.checkpoints++;
+}
+
+/**
+  * @brief  Send the one-line heartbeat
+  */
+static void SendBurnInHeartbeat(void)
+{
+    char buffer[96];
+    char cycles[21], errors[21];
+    uint32_t minutes = (uint32_t)(burnIn.elapsedMs / 60000);
+
+    snprintf(buffer, sizeof(buffer), "BI %lu:%02lu cycles=%s errors=%s\r\n",
+             minutes / 60, minutes % 60,
+             FormatCount(cycles, burnIn.cycles), FormatCount(errors, GetBurnInErrors()));
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
+
+/**
+  * @brief  Send the summary line
+  */
+static void SendBurnInSummary(void)
+{
+    char buffer[320];
+    char count[21];
+    uint32_t minutes = (uint32_t)(burnIn.elapsedMs / 60000);
+
+    int length = snprintf(buffer, sizeof(buffer), "Burn-in: up=%lud%02luh%02lum cycles=%s",
+                          minutes / 1440, (minutes / 60) % 24, minutes % 60,
+                          FormatCount(count, burnIn.cycles));
+    length += snprintf(buffer + length, sizeof(buffer) - length, " MB=%s",
+                       FormatCount(count, burnIn.bytes >> 20));
+    length += snprintf(buffer + length, sizeof(buffer) - length, " quarantined=%lu errors=%s (",
+                       GetQuarantineCount(), FormatCount(count, GetBurnInErrors()));
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, "%s%s=%s",
+                           region ? " " : "", GetRegionName(region),
+                           FormatCount(count, burnIn.regionErrors[region]));
+    }
+
+    /* Overhead in hundredths of a percent of the CPU time since the start */
+    uint64_t elapsedCycles = burnIn.elapsedMs * (SystemCoreClock / 1000);
+    uint32_t overhead = elapsedCycles ? (uint32_t)(burnIn.overheadCycles * 10000 / elapsedCycles) : 0;
+
+    if (length < (int)sizeof(buffer)) {
+        if (burnIn.maxVddaMv > 0) {
+            length += snprintf(buffer + length, sizeof(buffer) - length,
+                               ") T=%d..%dC VDDA=%u..%umV", burnIn.minTemperatureC, burnIn.maxTemperatureC,
+                               burnIn.minVddaMv, burnIn.maxVddaMv);
+        }
+        else {
+            length += snprintf(buffer + length, sizeof(buffer) - length, ")");
+        }
+    }
+    if (length < (int)sizeof(buffer)) {
+        length += snprintf(buffer + length, sizeof(buffer) - length,
+                           " resets=%lu checkpoints=%lu overhead=%lu.%02lu%%",
+                           burnIn.resets, burnIn.checkpoints, overhead / 100, overhead % 100);
+    }
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
+
+/**
+  * @brief  Resume a burn-in that was running before the reset
+  * @note   Call after InitializePersistentLog() and InitializeDefaultConfig()
+  */
+void InitializeBurnIn(void)
+{
+    BurnInCheckpoint checkpoint;
+
+    /* Warm reset: the totals in .noinit are intact */
+    if (burnIn.magic == BURN_IN_MAGIC && burnIn.check == ComputeBurnInCheck()) {
+        if (!burnIn.active) return;
+        burnIn.resets++;
+    }
+    /* Power loss: carry on from the newest checkpoint */
+    else if (FindLastBurnInCheckpoint(&checkpoint) && checkpoint.active) {
+        ResetBurnInTotals();
+        burnIn.active = 1;
+        burnIn.elapsedMs = (uint64_t)checkpoint.elapsedSeconds * 1000;
+        burnIn.cycles = checkpoint.cycles;
+        burnIn.priorErrors = checkpoint.errors;
+        burnIn.bytes = (uint64_t)checkpoint.megabytes << 20;
+        burnIn.resets = 1;
+    }
+    else {
+        ResetBurnInTotals();
+        burnIn.check = ComputeBurnInCheck();
+        return;
+    }
+
+    burnIn.check = ComputeBurnInCheck();
+    MarkBurnInStart();
+
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "Burn-in: resumed after reset %lu\r\n", burnIn.resets);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
+
+/**
+  * @brief  Start a new burn-in, clearing the totals
+  */
+void StartBurnIn(void)
+{
+    ResetBurnInTotals();
+    burnIn.active = 1;
+    MarkBurnInStart();
+
+    /* A power loss before the first summary still resumes in burn-in */
+    WriteBurnInCheckpoint();
+    burnIn.check = ComputeBurnInCheck();
+
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "Burn-in: started, heartbeat every %lus, summary every %lumin\r\n",
+             testConfig.burnInHeartbeatSeconds, testConfig.burnInSummaryMinutes);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
+
+/**
+  * @brief  End the burn-in with a final summary and checkpoint
+  */
+void StopBurnIn(void)
+{
+    if (!burnIn.active) return;
+
+    burnIn.active = 0;
+    SendBurnInSummary();
+    WriteBurnInCheckpoint();
+    burnIn.check = ComputeBurnInCheck();
+}
+
+/**
+  * @brief  Check whether burn-in mode is on
+  * @retval 1 if per-event and status output are off
+  */
+uint32_t IsBurnInActive(void)
+{
+    return burnIn.active;
+}
+
+/**
+  * @brief  Add a cycle to the totals and send what is due
+  * @param  cycleErrors: Errors this cycle found, per region
+  * @note   Replaces the status reports while burn-in is on
+  */
+void ServiceBurnIn(const uint32_t* cycleErrors)
+{
+    if (!burnIn.active) return;
+
+    uint32_t now = HAL_GetTick();
+    uint64_t kernelBytes = GetKernelBytes();
+
+    burnIn.elapsedMs += now - lastServiceTick;
+    lastServiceTick = now;
+    burnIn.bytes += kernelBytes - lastKernelBytes;
+    lastKernelBytes = kernelBytes;
+    burnIn.cycles++;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        burnIn.regionErrors[region] += cycleErrors[region];
+    }
+
+    const EnvironmentSample* environment = &lastCycleSummary.environment;
+    if (environment->vddaMv > 0) {
+        if (environment->temperatureC < burnIn.minTemperatureC) burnIn.minTemperatureC = environment->temperatureC;
+        if (environment->temperatureC > burnIn.maxTemperatureC) burnIn.maxTemperatureC = environment->temperatureC;
+        if (environment->vddaMv < burnIn.minVddaMv) burnIn.minVddaMv = environment->vddaMv;
+        if (environment->vddaMv > burnIn.maxVddaMv) burnIn.maxVddaMv = environment->vddaMv;
+    }
+
+    if (burnIn.elapsedMs >= nextHeartbeatMs || burnIn.elapsedMs >= nextSummaryMs) {
+        uint32_t start = GET_CYCLE_COUNT();
+
+        /* A summary stands in for the heartbeat that falls due with it */
+        if (burnIn.elapsedMs >= nextSummaryMs) {
+            SendBurnInSummary();
+            WriteBurnInCheckpoint();
+            nextSummaryMs = GetBurnInDeadline((uint64_t)testConfig.burnInSummaryMinutes * 60000);
+        }
+        else {
+            SendBurnInHeartbeat();
+        }
+        nextHeartbeatMs = GetBurnInDeadline((uint64_t)testConfig.burnInHeartbeatSeconds * 1000);
+
+        burnIn.overheadCycles += GET_CYCLE_COUNT() - start;
+    }
+
+    burnIn.check = ComputeBurnInCheck();
+}
@@ -0,0 +1,387 @@
+/**
+ * Tiered Bus Checks for STM32G473CB Memory Test
+ *
+ * A dead data line makes every device test in a region fail in turn, each
+ * logging its own errors, and the cause has to be worked out from the
+ * flood. Before the device tests run on a window, two cheap tiers check
+ * the paths to it. The data-bus tier walks a one and a zero through a
+ * single word, which separates stuck lines from shorted pairs. The
+ * address-bus tier writes the partner word of a base for every address
+ * line the window spans and checks that each write lands only on its own
+ * word. Both tiers skip quarantined words, and an address tier failure is
+ * repeated at a second base that shares no word with the first, so a bad
+ * cell is recorded and quarantined like any other error rather than taken
+ * for a line fault. The first tier that fails ends the sequence: the
+ * region's device tests are skipped for the cycle, one error is recorded
+ * and the diagnosis names the lines involved. A diagnosis is printed when
+ * it first appears or changes, with the time it took to reach it. Later
+ * cycles still run both tiers, so a known fault keeps the device tests
+ * deferred without being recorded or counted again.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* Address tier patterns */
+#define BUS_PATTERN           0xAAAAAAAAU
+#define BUS_ANTIPATTERN       0x55555555U
+
+/* Candidate bases tried per address tier run */
+#define BUS_BASE_ATTEMPTS     32
+
+/* What the last failing tier found */
+typedef struct {
+    uint32_t tier;                 /* BUS_TIER_* */
+    uint32_t address;              /* Word the fault was seen at */
+    uint32_t stuckLow;             /* Lines that read 0 when driven 1 */
+    uint32_t stuckHigh;            /* Lines that read 1 when driven 0 */
+    uint32_t shorted;              /* Lines that followed another line */
+} BusDiagnosis;
+
+/* Per region */
+typedef struct {
+    uint32_t runs;
+    uint32_t dataFaults;
+    uint32_t addressFaults;
+    uint32_t cellFaults;           /* Address tier failures that did not repeat at a second base */
+    uint32_t addressLines;         /* Highest address line the window spans */
+    uint32_t lastVerdictCycles;
+    uint32_t maxPassCycles;
+    BusDiagnosis diagnosis;
+} BusTierStats;
+
+/* Function prototypes */
+uint32_t RunBusTiers(uint32_t region, uint32_t startAddr, uint32_t size);
+uint32_t IsBusTierFaulty(uint32_t region);
+void ReportBusTierStatus(void);
+
+static BusTierStats busTierStats[NUM_TEST_REGIONS];
+
+/**
+  * @brief  Walk a one and a zero through every data line of one word
+  * @param  addr: Word to test
+  * @param  diagnosis: Filled with the failing lines
+  * @retval 1 if every line behaved
+  */
+static uint32_t RunDataBusTier(volatile uint32_t* addr, BusDiagnosis* diagnosis)
+{
+    /* Stuck lines first, from each line's own bit */
+    for (uint32_t bit = 0; bit < 32; bit++) {
+        uint32_t line = 1U << bit;
+
+        *addr = line;
+        if (!(*addr & line)) diagnosis->stuckLow |= line;
+        *addr = ~line;
+        if (*addr & line) diagnosis->stuckHigh |= line;
+    }
+
+    /* Then working lines pulled along by another - wired-OR or wired-AND */
+    uint32_t working = ~(diagnosis->stuckLow | diagnosis->stuckHigh);
+    for (uint32_t bit = 0; bit < 32; bit++) {
+        uint32_t line = 1U << bit;
+        if (!(working & line)) continue;
+
+        *addr = line;
+        uint32_t coupled = *addr & ~line;
+        *addr = ~line;
+        coupled |= ~*addr & ~line;
+
+        coupled &= working;
+        if (coupled) diagnosis->shorted |= coupled | line;
+    }
+
+    *addr = 0;
+    diagnosis->address = (uint32_t)addr;
+
+    return (diagnosis->stuckLow | diagnosis->stuckHigh | diagnosis->shorted) == 0;
+}
+
+/**
+  * @brief  Check each address line the window spans for stuck and shorted bits
+  * @param  base: Any word of the span
+  * @param  span: Power of two; base ^ offset stays inside the window for
+  *         every offset below it
+  * @param  diagnosis: Filled with the failing lines, as address bit masks
+  * @retval 1 if every line behaved
+  */
+static uint32_t RunAddressBusTier(uint32_t base, uint32_t span, BusDiagnosis* diagnosis)
+{
+    volatile uint32_t* baseWord = (volatile uint32_t*)base;
+
+    for (uint32_t offset = 4; offset < span; offset <<= 1) {
+        *(volatile uint32_t*)(base ^ offset) = BUS_PATTERN;
+    }
+
+    /* Line stuck at the base's value: the partner word is the base word */
+    *baseWord = BUS_ANTIPATTERN;
+    for (uint32_t offset = 4; offset < span; offset <<= 1) {
+        if (*(volatile uint32_t*)(base ^ offset) != BUS_PATTERN) {
+            diagnosis->stuckHigh |= offset;
+            if (!diagnosis->address) diagnosis->address = base ^ offset;
+        }
+    }
+    *baseWord = BUS_PATTERN;
+
+    /* Stuck at the partner's value lands on the base word; a short lands
+       on the other line's partner */
+    for (uint32_t test = 4; test < span; test <<= 1) {
+        if (diagnosis->stuckHigh & test) continue;
+        *(volatile uint32_t*)(base ^ test) = BUS_ANTIPATTERN;
+
+        if (*baseWord != BUS_PATTERN) {
+            diagnosis->stuckLow |= test;
+            if (!diagnosis->address) diagnosis->address = base ^ test;
+            *baseWord = BUS_PATTERN;
+        }
+        for (uint32_t offset = 4; offset < span; offset <<= 1) {
+            if (offset == test || ((diagnosis->stuckHigh | diagnosis->stuckLow) & offset)) continue;
+            if (*(volatile uint32_t*)(base ^ offset) != BUS_PATTERN) {
+                diagnosis->shorted |= test | offset;
+                if (!diagnosis->address) diagnosis->address = base ^ offset;
+                *(volatile uint32_t*)(base ^ offset) = BUS_PATTERN;
+            }
+        }
+
+        *(volatile uint32_t*)(base ^ test) = BUS_PATTERN;
+    }
+
+    /* The loops assume the base drives each line low; swap the labels of
+       the lines it drives high */
+    uint32_t flipped = base & (span - 1);
+    uint32_t stuckLow = diagnosis->stuckLow;
+    uint32_t stuckHigh = diagnosis->stuckHigh;
+    diagnosis->stuckLow = (stuckLow & ~flipped) | (stuckHigh & flipped);
+    diagnosis->stuckHigh = (stuckHigh & ~flipped) | (stuckLow & flipped);
+
+    return (diagnosis->stuckLow | diagnosis->stuckHigh | diagnosis->shorted) == 0;
+}
+
+/**
+  * @brief  Check that a base and all of its partner words are usable
+  * @param  base: Candidate base
+  * @param  span: Address span being tested
+  * @retval 1 if none of the words is quarantined
+  */
+static uint32_t IsAddressBaseClean(uint32_t base, uint32_t span)
+{
+    if (IsAddressQuarantined(base)) return 0;
+
+    for (uint32_t offset = 4; offset < span; offset <<= 1) {
+        if (IsAddressQuarantined(base ^ offset)) return 0;
+    }
+    return 1;
+}
+
+/**
+  * @brief  Pick a base for the address tier clear of quarantined words
+  * @param  spanBase: Aligned start of the span
+  * @param  span: Address span being tested
+  * @param  other: Base already used, or 0
+  * @param  base: Receives the base
+  * @retval 1 if found, 0 if every candidate touches a quarantined word
+  * @note   With another base given, the new one differs from it in three
+  *         or more lines, so the two bases share no word.
+  */
+static uint32_t FindAddressBase(uint32_t spanBase, uint32_t span, uint32_t other, uint32_t* base)
+{
+    for (uint32_t k = 0; k < BUS_BASE_ATTEMPTS && (k << 2) < span; k++) {
+        uint32_t candidate = spanBase + (k << 2);
+
+        if (other != 0 && __builtin_popcount(candidate ^ other) < 3) continue;
+        if (!IsAddressBaseClean(candidate, span)) continue;
+
+        *base = candidate;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Find the biggest aligned block inside a window
+  * @param  startAddr: Window start
+  * @param  size: Window size in bytes
+  * @param  base: Receives the block start
+  * @retval Block size, a power of two, or 0 if the window is too small
+  */
+static uint32_t FindAddressSpan(uint32_t startAddr, uint32_t size, uint32_t* base)
+{
+    for (uint32_t span = 0x80000000U; span >= 8; span >>= 1) {
+        if (span > size) continue;
+        uint32_t aligned = (startAddr + span - 1) & ~(span - 1);
+        if (aligned >= startAddr && aligned - startAddr + span <= size) {
+            *base = aligned;
+            return span;
+        }
+    }
+    return 0;
+}
+
+/**
+  * @brief  Print a diagnosis that is new or has changed
+  * @param  region: Region identifier
+  * @param  stats: Region statistics holding the diagnosis
+  */
+static void ReportBusDiagnosis(uint32_t region, BusTierStats* stats)
+{
+    char buffer[192];
+    BusDiagnosis* diagnosis = &stats->diagnosis;
+    char line = (diagnosis->tier == BUS_TIER_DATA) ? 'D' : 'A';
+    uint32_t faulty = diagnosis->stuckLow | diagnosis->stuckHigh | diagnosis->shorted;
+    uint32_t firstLine = 0;
+
+    while (firstLine < 31 && !(faulty & (1U << firstLine))) firstLine++;
+
+    snprintf(buffer, sizeof(buffer),
+             "Bus Tier: %s %s bus fault at 0x%08lX, first line %c%lu, stuck low=0x%08lX high=0x%08lX "
+             "shorted=0x%08lX, verdict in %luus\r\n",
+             GetRegionName(region), (diagnosis->tier == BUS_TIER_DATA) ? "data" : "address",
+             diagnosis->address, line, firstLine, diagnosis->stuckLow, diagnosis->stuckHigh,
+             diagnosis->shorted, CYCLES_TO_US(stats->lastVerdictCycles));
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
+
+/**
+  * @brief  Run the data-bus tier, then the address-bus tier, on a window
+  * @param  region: Region identifier
+  * @param  startAddr: Window start, word aligned
+  * @param  size: Window size in bytes
+  * @retval BUS_TIER_PASS, the tier that failed, or BUS_TIER_KNOWN_FAULT
+  * @note   Skip the region's device tests unless this returns BUS_TIER_PASS.
+  *         A new failure records one error against the region; a repeat on
+  *         the same lines records nothing and keeps the region deferred.
+  */
+uint32_t RunBusTiers(uint32_t region, uint32_t startAddr, uint32_t size)
+{
+    if (region >= NUM_TEST_REGIONS || size < 4) return BUS_TIER_PASS;
+
+    BusTierStats* stats = &busTierStats[region];
+    BusDiagnosis diagnosis;
+    uint32_t tier = BUS_TIER_PASS;
+    uint32_t start = GET_CYCLE_COUNT();
+
+    memset(&diagnosis, 0, sizeof(diagnosis));
+    stats->runs++;
+
+    /* A word already known to be bad would fail the tier every cycle */
+    uint32_t dataWord = startAddr;
+    while (dataWord + 4 <= startAddr + size && IsAddressQuarantined(dataWord)) dataWord += 4;
+
+    uint32_t spanBase = 0;
+    uint32_t base = 0;
+    uint32_t span = FindAddressSpan(startAddr, size, &spanBase);
+    if (span > 0) {
+        stats->addressLines = 31 - __builtin_clz(span - 1);
+        if (!FindAddressBase(spanBase, span, 0, &base)) span = 0;
+    }
+
+    if (dataWord + 4 <= startAddr + size && !RunDataBusTier((volatile uint32_t*)dataWord, &diagnosis)) {
+        tier = BUS_TIER_DATA;
+    }
+    else if (span > 0 && !RunAddressBusTier(base, span, &diagnosis)) {
+        /* A line fails at every base, a bad cell only at the base that
+           touched it: keep the lines that fail at a second base too */
+        BusDiagnosis confirm;
+        uint32_t second;
+
+        memset(&confirm, 0, sizeof(confirm));
+        if (FindAddressBase(spanBase, span, base, &second)) {
+            RunAddressBusTier(second, span, &confirm);
+            diagnosis.stuckLow &= confirm.stuckLow;
+            diagnosis.stuckHigh &= confirm.stuckHigh;
+            diagnosis.shorted &= confirm.shorted;
+        }
+
+        if (diagnosis.stuckLow | diagnosis.stuckHigh | diagnosis.shorted) {
+            tier = BUS_TIER_ADDRESS;
+        }
+        else {
+            /* Recorded and quarantined like any other error; the next
+               cycle picks a base clear of it */
+            stats->cellFaults++;
+            GetRegionStatus(region)->totalErrors +=
+                RecordMemoryError("Address Bus Tier", diagnosis.address,
+                                  *(volatile uint32_t*)diagnosis.address, BUS_PATTERN);
+        }
+    }
+
+    uint32_t cycles = GET_CYCLE_COUNT() - start;
+    stats->lastVerdictCycles = cycles;
+
+    if (tier == BUS_TIER_PASS) {
+        if (cycles > stats->maxPassCycles) stats->maxPassCycles = cycles;
+        stats->diagnosis.tier = BUS_TIER_PASS;
+        return BUS_TIER_PASS;
+    }
+
+    diagnosis.tier = tier;
+
+    /* Both tiers move off quarantined words, so a line fault shows up at a
+       new word each cycle; it is known by its lines, not by its address */
+    uint32_t known = (stats->diagnosis.tier == tier &&
+                      stats->diagnosis.stuckLow == diagnosis.stuckLow &&
+                      stats->diagnosis.stuckHigh == diagnosis.stuckHigh &&
+                      stats->diagnosis.shorted == diagnosis.shorted);
+    if (known) return BUS_TIER_KNOWN_FAULT;
+
+    if (tier == BUS_TIER_DATA) stats->dataFaults++;
+    else stats->addressFaults++;
+
+    /* One error for the whole region, not one per word of every test */
+    uint32_t expected = (tier == BUS_TIER_DATA) ? 0 : BUS_PATTERN;
+    GetRegionStatus(region)->totalErrors +=
+        RecordMemoryError((tier == BUS_TIER_DATA) ? "Data Bus Tier" : "Address Bus Tier",
+                          diagnosis.address, *(volatile uint32_t*)diagnosis.address, expected);
+
+    stats->diagnosis = diagnosis;
+    if (!IsBurnInActive()) ReportBusDiagnosis(region, stats);
+
+    return tier;
+}
+
+/**
+  * @brief  Check whether a region's last bus tier run diagnosed a fault
+  * @param  region: Region identifier
+  * @retval 1 if the region's device tests are being deferred
+  * @note   For tests run outside the main test functions, which don't see
+  *         the RunBusTiers() result
+  */
+uint32_t IsBusTierFaulty(uint32_t region)
+{
+    if (region >= NUM_TEST_REGIONS) return 0;
+
+    return busTierStats[region].diagnosis.tier != BUS_TIER_PASS;
+}
+
+/**
+  * @brief  Report bus tier verdicts per region
+  */
+void ReportBusTierStatus(void)
+{
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "Bus tiers:");
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        BusTierStats* stats = &busTierStats[region];
+        if (stats->runs == 0) continue;
+
+        length += snprintf(buffer + length, sizeof(buffer) - length,
+                           " %s=%s runs=%lu data=%lu address=%lu cells=%lu lines=A2-A%lu pass<=%luus",
+                           GetRegionName(region),
+                           (stats->diagnosis.tier == BUS_TIER_DATA) ? "DATA FAULT" :
+                           (stats->diagnosis.tier == BUS_TIER_ADDRESS) ? "ADDRESS FAULT" : "ok",
+                           stats->runs, stats->dataFaults, stats->addressFaults, stats->cellFaults,
+                           stats->addressLines, CYCLES_TO_US(stats->maxPassCycles));
+    }
+
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,278 @@
+/**
+ * DMA + CRC Flash Verifier for STM32G473CB Memory Test
+ *
+ * The DMA controller and the CRC unit act as a second worker beside the
+ * CPU. A job feeds a run of flash blocks into the CRC unit by DMA while
+ * the CPU tests the SRAM regions. Each block gets its own signature: the
+ * transfer-complete interrupt reads the signature, resets the unit and
+ * starts the next block. At the join point the signatures are compared
+ * with each block's reference, which is recorded the first time the block
+ * is read. The job length is rebalanced on every join from the measured
+ * DMA rate and the CPU time it overlapped, so the DMA job finishes as the
+ * CPU reaches the join point.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Flash below the log and quarantine pages, which change at run time */
+#define CRC_BLOCK_SIZE        FLASH_PAGE_SIZE
+#define CRC_NUM_BLOCKS        ((FLASH_RESERVED_START - FLASH_START_ADDR) / CRC_BLOCK_SIZE)
+
+/* Job length limits, in blocks */
+#define CRC_MIN_JOB_BLOCKS    1
+#define CRC_MAX_JOB_BLOCKS    32
+#define CRC_JOIN_TIMEOUT_MS   100
+
+/* DMA handle - DMA1 channel 3 is free of the ADC and the stress streams */
+DMA_HandleTypeDef hdma_crc;
+
+/* Function prototypes */
+void InitializeCrcVerifier(void);
+void StartCrcVerifier(void);
+uint32_t JoinCrcVerifier(void);
+void ReportCrcVerifierStatus(void);
+
+/* Reference signature per block, valid once the block has been read */
+static uint32_t blockReference[CRC_NUM_BLOCKS];
+static uint8_t blockReferenceValid[(CRC_NUM_BLOCKS + 7) / 8];
+static uint32_t referencedBlocks = 0;
+
+/* Current job, shared with the interrupt handler */
+static volatile uint32_t jobSignatures[CRC_MAX_JOB_BLOCKS];
+static volatile uint32_t jobBlocksDone = 0;
+static volatile uint32_t jobRunning = 0;
+static volatile uint32_t jobEndCycles = 0;
+static uint32_t jobFirstBlock = 0;
+static uint32_t jobBlocks = 0;
+static uint32_t jobStartCycles = 0;
+static uint32_t jobActive = 0;
+
+/* Scheduling */
+static uint32_t crcVerifierReady = 0;
+static uint32_t blockCursor = 0;
+static uint32_t nextJobBlocks = 4;
+
+/* Statistics */
+static uint32_t crcJobs = 0;
+static uint32_t crcBlocksVerified = 0;
+static uint32_t crcMismatches = 0;
+static volatile uint32_t crcTransferErrors = 0;
+static uint64_t crcDmaBytes = 0;
+static uint64_t crcDmaCycles = 0;
+static uint64_t crcJoinWaitCycles = 0;
+static uint64_t crcIdleCycles = 0;
+
+/**
+  * @brief  Reset the CRC unit and start one block through it
+  * @param  block: Block index
+  */
+static void StartCrcBlock(uint32_t block)
+{
+    CRC->CR |= CRC_CR_RESET;
+    hdma_crc.Instance->CPAR = FLASH_START_ADDR + block * CRC_BLOCK_SIZE;
+    hdma_crc.Instance->CNDTR = CRC_BLOCK_SIZE / 4;
+    __HAL_DMA_ENABLE(&hdma_crc);
+}
+
+/**
+  * @brief  DMA1 channel 3 interrupt handler - collect a signature, start the next block
+  */
+void DMA1_Channel3_IRQHandler(void)
+{
+    uint32_t transferError = __HAL_DMA_GET_FLAG(&hdma_crc, __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_crc));
+
+    __HAL_DMA_DISABLE(&hdma_crc);
+    __HAL_DMA_CLEAR_FLAG(&hdma_crc, __HAL_DMA_GET_GI_FLAG_INDEX(&hdma_crc));
+
+    if (transferError) {
+        /* A flash read the DMA could not complete, e.g. a double ECC error */
+        crcTransferErrors++;
+    }
+    else {
+        jobSignatures[jobBlocksDone++] = CRC->DR;
+        if (jobBlocksDone < jobBlocks) {
+            StartCrcBlock(jobFirstBlock + jobBlocksDone);
+            return;
+        }
+    }
+
+    jobEndCycles = GET_CYCLE_COUNT();
+    jobRunning = 0;
+}
+
+/**
+  * @brief  Configure the CRC unit and its DMA channel
+  * @note   The CRC unit keeps its reset configuration: CRC-32 polynomial,
+  *         0xFFFFFFFF initial value, 32-bit input.
+  */
+void InitializeCrcVerifier(void)
+{
+    memset(blockReferenceValid, 0, sizeof(blockReferenceValid));
+    referencedBlocks = 0;
+    blockCursor = 0;
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    __HAL_RCC_DMAMUX1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    /* Memory to memory: flash (incrementing) into CRC->DR (fixed) */
+    hdma_crc.Instance = DMA1_Channel3;
+    hdma_crc.Init.Request = DMA_REQUEST_MEM2MEM;
+    hdma_crc.Init.Direction = DMA_MEMORY_TO_MEMORY;
+    hdma_crc.Init.PeriphInc = DMA_PINC_ENABLE;
+    hdma_crc.Init.MemInc = DMA_MINC_DISABLE;
+    hdma_crc.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_crc.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma_crc.Init.Mode = DMA_NORMAL;
+    hdma_crc.Init.Priority = DMA_PRIORITY_LOW;
+    if (HAL_DMA_Init(&hdma_crc) != HAL_OK) {
+        char buffer[] = "CRC Verifier Error: DMA init failed\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+
+    hdma_crc.Instance->CMAR = (uint32_t)&CRC->DR;
+    __HAL_DMA_ENABLE_IT(&hdma_crc, DMA_IT_TC | DMA_IT_TE);
+
+    HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+
+    crcVerifierReady = 1;
+}
+
+/**
+  * @brief  Start the next run of flash blocks through the CRC unit
+  * @note   Returns at once; the CPU carries on until JoinCrcVerifier()
+  */
+void StartCrcVerifier(void)
+{
+    if (!crcVerifierReady || jobActive) return;
+
+    uint32_t blocks = nextJobBlocks;
+    if (blocks > CRC_NUM_BLOCKS - blockCursor) blocks = CRC_NUM_BLOCKS - blockCursor;
+
+    jobFirstBlock = blockCursor;
+    jobBlocks = blocks;
+    jobBlocksDone = 0;
+    jobActive = 1;
+    jobRunning = 1;
+    jobStartCycles = GET_CYCLE_COUNT();
+
+    StartCrcBlock(jobFirstBlock);
+}
+
+/**
+  * @brief  Wait for the running job, compare signatures and rebalance
+  * @retval Number of blocks whose signature changed or could not be read
+  */
+uint32_t JoinCrcVerifier(void)
+{
+    uint32_t errors = 0;
+    char buffer[128];
+
+    if (!jobActive) return 0;
+
+    /* CPU work overlapped with the job */
+    uint32_t joinCycles = GET_CYCLE_COUNT();
+    uint32_t cpuCycles = joinCycles - jobStartCycles;
+    uint32_t startTick = HAL_GetTick();
+
+    while (jobRunning) {
+        if (HAL_GetTick() - startTick > CRC_JOIN_TIMEOUT_MS) {
+            __HAL_DMA_DISABLE(&hdma_crc);
+            jobEndCycles = GET_CYCLE_COUNT();
+            jobRunning = 0;
+            crcTransferErrors++;
+        }
+    }
+
+    uint32_t dmaCycles = jobEndCycles - jobStartCycles;
+    if ((int32_t)(jobEndCycles - joinCycles) > 0) {
+        crcJoinWaitCycles += jobEndCycles - joinCycles;
+    }
+    else {
+        crcIdleCycles += joinCycles - jobEndCycles;
+    }
+
+    /* Compare each signature with its block's reference */
+    uint32_t done = jobBlocksDone;
+    for (uint32_t i = 0; i < done; i++) {
+        uint32_t block = jobFirstBlock + i;
+        uint32_t signature = jobSignatures[i];
+
+        if (!(blockReferenceValid[block / 8] & (1U << (block % 8)))) {
+            blockReference[block] = signature;
+            blockReferenceValid[block / 8] |= (uint8_t)(1U << (block % 8));
+            referencedBlocks++;
+            continue;
+        }
+
+        if (signature != blockReference[block]) {
+            errors++;
+            crcMismatches++;
+            snprintf(buffer, sizeof(buffer),
+                     "CRC Verify: flash block 0x%08lX signature 0x%08lX, expected 0x%08lX\r\n",
+                     FLASH_START_ADDR + block * CRC_BLOCK_SIZE, signature, blockReference[block]);
+            if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        }
+    }
+
+    /* A block the DMA could not read counts as an error too */
+    if (done < jobBlocks) {
+        errors++;
+        snprintf(buffer, sizeof(buffer), "CRC Verify: flash block 0x%08lX could not be read\r\n",
+                 FLASH_START_ADDR + (jobFirstBlock + done) * CRC_BLOCK_SIZE);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        done++;
+    }
+
+    /* Size the next job to the CPU time this one overlapped */
+    if (jobBlocksDone > 0 && dmaCycles > 0) {
+        uint32_t cyclesPerBlock = dmaCycles / jobBlocksDone;
+        uint32_t target = cyclesPerBlock ? cpuCycles / cyclesPerBlock : CRC_MAX_JOB_BLOCKS;
+        nextJobBlocks = (nextJobBlocks + target + 1) / 2;
+        if (nextJobBlocks < CRC_MIN_JOB_BLOCKS) nextJobBlocks = CRC_MIN_JOB_BLOCKS;
+        if (nextJobBlocks > CRC_MAX_JOB_BLOCKS) nextJobBlocks = CRC_MAX_JOB_BLOCKS;
+
+        crcDmaBytes += jobBlocksDone * CRC_BLOCK_SIZE;
+        crcDmaCycles += dmaCycles;
+    }
+
+    blockCursor += done;
+    if (blockCursor >= CRC_NUM_BLOCKS) blockCursor = 0;
+
+    crcJobs++;
+    crcBlocksVerified += jobBlocksDone;
+    jobActive = 0;
+
+    return errors;
+}
+
+/**
+  * @brief  Report verifier coverage, throughput and load balance
+  */
+void ReportCrcVerifierStatus(void)
+{
+    char buffer[256];
+
+    if (crcJobs == 0) return;
+
+    /* Bytes per microsecond is MB/s; multiplying by the clock would overflow */
+    uint64_t dmaUs = CYCLES_TO_US(crcDmaCycles);
+    uint32_t mbPerSecond = dmaUs ? (uint32_t)(crcDmaBytes / dmaUs) : 0;
+    snprintf(buffer, sizeof(buffer),
+             "CRC Verifier: jobs=%lu blocks=%lu referenced=%lu/%lu mismatches=%lu transfer errors=%lu | "
+             "next job=%lu blocks, DMA %lu MB/s, avg join wait=%luus, avg DMA idle=%luus\r\n",
+             crcJobs, crcBlocksVerified, referencedBlocks, (uint32_t)CRC_NUM_BLOCKS,
+             crcMismatches, crcTransferErrors, nextJobBlocks, mbPerSecond,
+             (uint32_t)CYCLES_TO_US(crcJoinWaitCycles / crcJobs),
+             (uint32_t)CYCLES_TO_US(crcIdleCycles / crcJobs));
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,375 @@
+/**
+ * DMA Bus-Contention Stress for STM32G473CB Memory Test
+ *
+ * Runs memory-to-memory DMA traffic in the background while the CPU test
+ * kernels run, so the memories are tested with the bus matrix under load
+ * instead of idle. One DMA1 stream copies part of the flash image into a
+ * scratch buffer, and one DMA2 stream copies that buffer into a second one.
+ * Both streams restart from their transfer-complete interrupt while the
+ * duty-cycle gate, driven by SysTick, is open. The scratch buffers are
+ * outside every test window and are verified when the streams stop.
+ * Kernel throughput under contention is accounted separately so the
+ * slowdown can be reported. Every Nth stress cycle runs without DMA as a
+ * control for the error rate.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern MemoryTestConfig testConfig;
+
+/* Streams - DMA1 channel 1 belongs to the ADC */
+#define DMA_STREAM_FLASH      0       /* DMA1 channel 2: flash image -> scratch A */
+#define DMA_STREAM_SRAM       1       /* DMA2 channel 1: scratch A -> scratch B */
+#define DMA_NUM_STREAMS       2
+
+/* Flash read by the first stream - the start of the program image */
+#define DMA_STRESS_SOURCE_ADDR  FLASH_START_ADDR
+
+/* DMA handles */
+DMA_HandleTypeDef hdma_stress_flash;
+DMA_HandleTypeDef hdma_stress_sram;
+
+/* Function prototypes */
+void InitializeDmaStress(void);
+void StartDmaStress(void);
+void StopDmaStress(void);
+uint32_t IsDmaStressActive(void);
+uint32_t GetDmaGateState(uint32_t startTick, uint32_t endTick);
+void DmaStressTick(void);
+void RunStressTestCycle(void);
+void ReportDmaStressStatus(void);
+
+static DMA_HandleTypeDef* const stressStreams[DMA_NUM_STREAMS] = {
+    &hdma_stress_flash, &hdma_stress_sram
+};
+
+/* Scratch buffers, written only by DMA while the streams run.
+   Scratch A holds a copy of the flash source before the streams start,
+   so both buffers hold the same data whatever point a transfer stops at. */
+static uint32_t dmaScratchA[DMA_STRESS_SCRATCH_WORDS];
+static uint32_t dmaScratchB[DMA_STRESS_SCRATCH_WORDS];
+
+static uint32_t dmaStressReady = 0;
+static volatile uint32_t dmaStressActive = 0;
+static volatile uint32_t dmaStressGate = 0;
+
+/* Statistics */
+static volatile uint32_t dmaTransfers[DMA_NUM_STREAMS];
+static volatile uint32_t dmaTransferErrors = 0;
+static uint32_t stressCycleCount = 0;
+static uint32_t stressedCycles = 0;
+static uint32_t stressedErrors = 0;
+static uint32_t controlCycles = 0;
+static uint32_t controlErrors = 0;
+static uint32_t scratchErrors = 0;
+
+/**
+  * @brief  Configure one memory-to-memory channel for word transfers
+  * @param  hdma: DMA handle
+  * @param  instance: DMA channel
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef ConfigureStressChannel(DMA_HandleTypeDef* hdma, DMA_Channel_TypeDef* instance)
+{
+    hdma->Instance = instance;
+    hdma->Init.Request = DMA_REQUEST_MEM2MEM;
+    hdma->Init.Direction = DMA_MEMORY_TO_MEMORY;
+    hdma->Init.PeriphInc = DMA_PINC_ENABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_MEDIUM;
+
+    return HAL_DMA_Init(hdma);
+}
+
+/**
+  * @brief  Configure the stress channels and their interrupts
+  */
+void InitializeDmaStress(void)
+{
+    memset((void*)dmaTransfers, 0, sizeof(dmaTransfers));
+
+    __HAL_RCC_DMAMUX1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    if (ConfigureStressChannel(&hdma_stress_flash, DMA1_Channel2) != HAL_OK ||
+        ConfigureStressChannel(&hdma_stress_sram, DMA2_Channel1) != HAL_OK) {
+        char buffer[] = "DMA Stress Error: channel init failed\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+
+    /* Same priority as SysTick, so the restart interrupt and the duty-cycle
+       gate never preempt each other */
+    HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Channel1_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Channel1_IRQn);
+
+    dmaStressReady = 1;
+}
+
+/**
+  * @brief  Reload a stopped channel and start another transfer
+  * @param  hdma: DMA handle
+  */
+static void KickStressChannel(DMA_HandleTypeDef* hdma)
+{
+    hdma->Instance->CNDTR = DMA_STRESS_SCRATCH_WORDS;
+    __HAL_DMA_ENABLE(hdma);
+}
+
+/**
+  * @brief  Transfer-complete handling shared by both streams
+  * @param  stream: DMA_STREAM_x
+  * @note   Registers are used directly to keep the restart short - this
+  *         runs every few microseconds while the gate is open.
+  */
+static void ServiceStressChannel(uint32_t stream)
+{
+    DMA_HandleTypeDef* hdma = stressStreams[stream];
+    uint32_t transferError = __HAL_DMA_GET_FLAG(hdma, __HAL_DMA_GET_TE_FLAG_INDEX(hdma));
+
+    __HAL_DMA_DISABLE(hdma);
+    __HAL_DMA_CLEAR_FLAG(hdma, __HAL_DMA_GET_GI_FLAG_INDEX(hdma));
+
+    if (transferError) {
+        /* The channel stays off until the next start */
+        dmaTransferErrors++;
+        return;
+    }
+
+    dmaTransfers[stream]++;
+
+    if (dmaStressActive && dmaStressGate) {
+        KickStressChannel(hdma);
+    }
+}
+
+/**
+  * @brief  DMA1 channel 2 interrupt handler
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+    ServiceStressChannel(DMA_STREAM_FLASH);
+}
+
+/**
+  * @brief  DMA2 channel 1 interrupt handler
+  */
+void DMA2_Channel1_IRQHandler(void)
+{
+    ServiceStressChannel(DMA_STREAM_SRAM);
+}
+
+/**
+  * @brief  Check whether the duty-cycle gate is open at a tick
+  * @param  tick: HAL tick
+  * @retval 1 if the gate is open for that millisecond
+  */
+static uint32_t IsGateOpenAt(uint32_t tick)
+{
+    uint32_t phaseMs = tick % DMA_STRESS_PERIOD_MS;
+    return (phaseMs * 100 < testConfig.dmaStressDutyPercent * DMA_STRESS_PERIOD_MS);
+}
+
+/**
+  * @brief  Open or close the duty-cycle gate
+  * @note   Called from SysTick every millisecond. The gate is open for the
+  *         first dmaStressDutyPercent of each DMA_STRESS_PERIOD_MS period;
+  *         idle channels are restarted when it opens.
+  */
+void DmaStressTick(void)
+{
+    if (!dmaStressActive) return;
+
+    dmaStressGate = IsGateOpenAt(HAL_GetTick());
+
+    if (!dmaStressGate) return;
+
+    for (uint32_t stream = 0; stream < DMA_NUM_STREAMS; stream++) {
+        DMA_HandleTypeDef* hdma = stressStreams[stream];
+        if ((hdma->Instance->CCR & DMA_CCR_EN) == 0) {
+            KickStressChannel(hdma);
+        }
+    }
+}
+
+/**
+  * @brief  Start background DMA traffic
+  * @note   Nothing starts if the channels failed to initialize or the duty
+  *         cycle is 0. Traffic begins on the next SysTick.
+  */
+void StartDmaStress(void)
+{
+    if (!dmaStressReady || dmaStressActive || testConfig.dmaStressDutyPercent == 0) return;
+
+    memcpy(dmaScratchA, (const void*)DMA_STRESS_SOURCE_ADDR, sizeof(dmaScratchA));
+
+    /* Fixed addresses - only the count is reloaded per transfer */
+    hdma_stress_flash.Instance->CPAR = DMA_STRESS_SOURCE_ADDR;
+    hdma_stress_flash.Instance->CMAR = (uint32_t)dmaScratchA;
+    hdma_stress_sram.Instance->CPAR = (uint32_t)dmaScratchA;
+    hdma_stress_sram.Instance->CMAR = (uint32_t)dmaScratchB;
+
+    for (uint32_t stream = 0; stream < DMA_NUM_STREAMS; stream++) {
+        DMA_HandleTypeDef* hdma = stressStreams[stream];
+        __HAL_DMA_DISABLE(hdma);
+        __HAL_DMA_CLEAR_FLAG(hdma, __HAL_DMA_GET_GI_FLAG_INDEX(hdma));
+        __HAL_DMA_ENABLE_IT(hdma, DMA_IT_TC | DMA_IT_TE);
+    }
+
+    dmaStressGate = 0;
+    dmaStressActive = 1;
+}
+
+/**
+  * @brief  Stop background DMA traffic and verify the scratch buffers
+  */
+void StopDmaStress(void)
+{
+    if (!dmaStressActive) return;
+
+    dmaStressActive = 0;
+    dmaStressGate = 0;
+
+    /* A transfer in progress stops after its current word */
+    for (uint32_t stream = 0; stream < DMA_NUM_STREAMS; stream++) {
+        DMA_HandleTypeDef* hdma = stressStreams[stream];
+        __HAL_DMA_DISABLE_IT(hdma, DMA_IT_TC | DMA_IT_TE);
+        __HAL_DMA_DISABLE(hdma);
+        __HAL_DMA_CLEAR_FLAG(hdma, __HAL_DMA_GET_GI_FLAG_INDEX(hdma));
+    }
+
+    /* Both copies must still match the flash source */
+    const volatile uint32_t* source = (const volatile uint32_t*)DMA_STRESS_SOURCE_ADDR;
+    volatile uint32_t* copies[DMA_NUM_STREAMS] = { dmaScratchA, dmaScratchB };
+    uint32_t errors = 0;
+
+    for (uint32_t stream = 0; stream < DMA_NUM_STREAMS; stream++) {
+        for (uint32_t i = 0; i < DMA_STRESS_SCRATCH_WORDS; i++) {
+            uint32_t expected = source[i];
+            uint32_t readValue = copies[stream][i];
+            if (readValue != expected) {
+                errors += RecordMemoryError("DMA Scratch", (uint32_t)&copies[stream][i], readValue, expected);
+            }
+        }
+    }
+
+    if (errors > 0) {
+        GetRegionStatus(GetRegionForAddress((uint32_t)dmaScratchA))->totalErrors += errors;
+        scratchErrors += errors;
+    }
+}
+
+/**
+  * @brief  Check whether background DMA traffic is running
+  * @retval 1 while the stress streams are started
+  */
+uint32_t IsDmaStressActive(void)
+{
+    return dmaStressActive;
+}
+
+/**
+  * @brief  Get the duty-cycle gate state over a span of ticks
+  * @param  startTick: HAL tick the span started in
+  * @param  endTick: HAL tick the span ended in
+  * @retval DMA_GATE_CLOSED, DMA_GATE_OPEN, or DMA_GATE_MIXED if the gate
+  *         changed state during the span
+  * @note   The gate follows the tick, so the span is checked one millisecond
+  *         at a time. Stress is assumed to have been started or stopped
+  *         outside the span, as RunStressTestCycle does.
+  */
+uint32_t GetDmaGateState(uint32_t startTick, uint32_t endTick)
+{
+    if (!dmaStressActive) return DMA_GATE_CLOSED;
+    if (endTick - startTick >= DMA_STRESS_PERIOD_MS) {
+        if (testConfig.dmaStressDutyPercent >= 100) return DMA_GATE_OPEN;
+        return DMA_GATE_MIXED;
+    }
+
+    uint32_t open = IsGateOpenAt(startTick);
+    for (uint32_t tick = startTick + 1; tick != endTick + 1; tick++) {
+        if (IsGateOpenAt(tick) != open) return DMA_GATE_MIXED;
+    }
+
+    return open ? DMA_GATE_OPEN : DMA_GATE_CLOSED;
+}
+
+/**
+  * @brief  Sum of error totals over all regions
+  */
+static uint32_t TotalRegionErrors(void)
+{
+    uint32_t total = 0;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        total += GetRegionStatus(region)->totalErrors;
+    }
+
+    return total;
+}
+
+/**
+  * @brief  Run the full test cycle with background DMA traffic
+  * @note   Every dmaStressControlInterval-th cycle runs without DMA, so the
+  *         error rates with and without contention come from the same mode.
+  */
+void RunStressTestCycle(void)
+{
+    uint32_t errorsBefore = TotalRegionErrors();
+
+    stressCycleCount++;
+    if (testConfig.dmaStressControlInterval == 0 ||
+        stressCycleCount % testConfig.dmaStressControlInterval != 0) {
+        StartDmaStress();
+    }
+    uint32_t stressed = IsDmaStressActive();
+
+    TestAllMemoryRegions();
+
+    StopDmaStress();
+
+    uint32_t errors = TotalRegionErrors() - errorsBefore;
+    if (stressed) {
+        stressedCycles++;
+        stressedErrors += errors;
+    }
+    else {
+        controlCycles++;
+        controlErrors += errors;
+    }
+}
+
+/**
+  * @brief  Report DMA traffic and error rates with and without contention
+  */
+void ReportDmaStressStatus(void)
+{
+    char buffer[256];
+
+    if (stressedCycles == 0 && controlCycles == 0) return;
+
+    uint32_t transferBytes = DMA_STRESS_SCRATCH_WORDS * 4;
+    snprintf(buffer, sizeof(buffer),
+             "DMA Stress: duty=%lu%% | stressed cycles=%lu errors=%lu (%lu/kcycle) | "
+             "control cycles=%lu errors=%lu (%lu/kcycle) | "
+             "KB flash->SRAM=%lu SRAM->SRAM=%lu transfer errors=%lu scratch errors=%lu\r\n",
+             testConfig.dmaStressDutyPercent,
+             stressedCycles, stressedErrors, stressedCycles ? stressedErrors * 1000 / stressedCycles : 0,
+             controlCycles, controlErrors, controlCycles ? controlErrors * 1000 / controlCycles : 0,
+             (uint32_t)((uint64_t)dmaTransfers[DMA_STREAM_FLASH] * transferBytes / 1024),
+             (uint32_t)((uint64_t)dmaTransfers[DMA_STREAM_SRAM] * transferBytes / 1024),
+             dmaTransferErrors, scratchErrors);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,218 @@
+/**
+ * Dual-Region Interleaved Test Kernels for STM32G473CB Memory Test
+ *
+ * CCM SRAM is reached over the D-bus and SRAM1/SRAM2 over the S-bus, so a
+ * loop that touches both in the same body keeps two bus-matrix paths busy
+ * instead of one. The interleaved kernel fills and verifies a CCM window
+ * and an SRAM window word by word in lockstep. The two windows hold
+ * complementary data, so a write that lands in the wrong region shows up
+ * as an error. Every DUAL_BASELINE_INTERVAL-th run with each partner does
+ * the same work one region after the other, which gives the sequential
+ * baseline that the aggregate bandwidth is compared against.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* One run in this many is sequential, for the baseline */
+#define DUAL_BASELINE_INTERVAL  4
+
+/* Word value for index i: checkerboard of the pattern and its inverse */
+#define DUAL_VALUE(pattern, i)  (((i) & 1) ? ~(pattern) : (pattern))
+
+/* Aggregate bandwidth per partner region, interleaved and sequential */
+typedef struct {
+    uint32_t runCount;             /* Runs with this partner, picks the baseline runs */
+    uint32_t runs[2];
+    uint64_t bytes[2];
+    uint64_t cycles[2];
+} DualRegionStats;
+
+#define DUAL_MODE_SEQUENTIAL  0
+#define DUAL_MODE_INTERLEAVED 1
+
+/* Function prototypes */
+uint32_t RunDualRegionTest(uint32_t ccmStart, uint32_t ccmSize, uint32_t sramStart, uint32_t sramSize,
+                           uint32_t pattern);
+void ReportDualRegionStatus(void);
+
+static DualRegionStats dualStats[NUM_TEST_REGIONS];
+
+/**
+  * @brief  Fill two windows in lockstep, then verify both in lockstep
+  * @param  ccm: CCM window
+  * @param  ccmWords: CCM window size in words
+  * @param  sram: SRAM window
+  * @param  sramWords: SRAM window size in words
+  * @param  pattern: Pattern for this pass; the SRAM window gets the inverse
+  * @param  ccmErrors: Incremented by errors found in the CCM window
+  * @param  sramErrors: Incremented by errors found in the SRAM window
+  */
+static void RunInterleavedPass(volatile uint32_t* ccm, uint32_t ccmWords,
+                               volatile uint32_t* sram, uint32_t sramWords,
+                               uint32_t pattern, uint32_t* ccmErrors, uint32_t* sramErrors)
+{
+    uint32_t common = (ccmWords < sramWords) ? ccmWords : sramWords;
+
+    /* Fill - one store down each path per iteration */
+    for (uint32_t i = 0; i < common; i++) {
+        uint32_t value = DUAL_VALUE(pattern, i);
+        ccm[i] = value;
+        sram[i] = ~value;
+    }
+    for (uint32_t i = common; i < ccmWords; i++) {
+        ccm[i] = DUAL_VALUE(pattern, i);
+    }
+    for (uint32_t i = common; i < sramWords; i++) {
+        sram[i] = ~DUAL_VALUE(pattern, i);
+    }
+
+    /* Verify - both loads issued before either is compared */
+    for (uint32_t i = 0; i < common; i++) {
+        uint32_t expected = DUAL_VALUE(pattern, i);
+        uint32_t ccmValue = ccm[i];
+        uint32_t sramValue = sram[i];
+        if (ccmValue != expected) {
+            *ccmErrors += RecordMemoryError("Dual Region", (uint32_t)&ccm[i], ccmValue, expected);
+        }
+        if (sramValue != ~expected) {
+            *sramErrors += RecordMemoryError("Dual Region", (uint32_t)&sram[i], sramValue, ~expected);
+        }
+    }
+    for (uint32_t i = common; i < ccmWords; i++) {
+        uint32_t expected = DUAL_VALUE(pattern, i);
+        uint32_t readValue = ccm[i];
+        if (readValue != expected) {
+            *ccmErrors += RecordMemoryError("Dual Region", (uint32_t)&ccm[i], readValue, expected);
+        }
+    }
+    for (uint32_t i = common; i < sramWords; i++) {
+        uint32_t expected = ~DUAL_VALUE(pattern, i);
+        uint32_t readValue = sram[i];
+        if (readValue != expected) {
+            *sramErrors += RecordMemoryError("Dual Region", (uint32_t)&sram[i], readValue, expected);
+        }
+    }
+}
+
+/**
+  * @brief  Fill and verify one window on its own
+  * @param  base: Window
+  * @param  numWords: Window size in words
+  * @param  pattern: Pattern for this pass
+  * @param  invert: Non-zero to store the inverse, as the SRAM side does
+  * @param  errors: Incremented by errors found
+  */
+static void RunSequentialPass(volatile uint32_t* base, uint32_t numWords, uint32_t pattern,
+                              uint32_t invert, uint32_t* errors)
+{
+    uint32_t mask = invert ? 0xFFFFFFFF : 0;
+
+    for (uint32_t i = 0; i < numWords; i++) {
+        base[i] = DUAL_VALUE(pattern, i) ^ mask;
+    }
+
+    for (uint32_t i = 0; i < numWords; i++) {
+        uint32_t expected = DUAL_VALUE(pattern, i) ^ mask;
+        uint32_t readValue = base[i];
+        if (readValue != expected) {
+            *errors += RecordMemoryError("Dual Region", (uint32_t)&base[i], readValue, expected);
+        }
+    }
+}
+
+/**
+  * @brief  Test a CCM window and an SRAM window together
+  * @param  ccmStart: CCM window start, word aligned
+  * @param  ccmSize: CCM window size in bytes
+  * @param  sramStart: SRAM1 or SRAM2 window start, word aligned
+  * @param  sramSize: SRAM window size in bytes
+  * @param  pattern: Base pattern, run as-is and inverted
+  * @retval Number of errors detected
+  * @note   Errors are added to each region's status here, as they may fall
+  *         in either region.
+  */
+uint32_t RunDualRegionTest(uint32_t ccmStart, uint32_t ccmSize, uint32_t sramStart, uint32_t sramSize,
+                           uint32_t pattern)
+{
+    uint32_t ccmErrors = 0;
+    uint32_t sramErrors = 0;
+    uint32_t ccmWords = ccmSize / 4;
+    uint32_t sramWords = sramSize / 4;
+    uint32_t partner = GetRegionForAddress(sramStart);
+
+    if (ccmWords == 0 || sramWords == 0 || partner == REGION_NONE) return 0;
+
+    /* Counted per partner, so a baseline interval that divides the
+       partner alternation can't starve one partner of baseline runs */
+    DualRegionStats* stats = &dualStats[partner];
+    uint32_t mode = (stats->runCount++ % DUAL_BASELINE_INTERVAL == 0) ? DUAL_MODE_SEQUENTIAL : DUAL_MODE_INTERLEAVED;
+    uint32_t start = GET_CYCLE_COUNT();
+
+    for (uint32_t invert = 0; invert < 2; invert++) {
+        uint32_t passPattern = invert ? ~pattern : pattern;
+
+        if (mode == DUAL_MODE_INTERLEAVED) {
+            RunInterleavedPass((volatile uint32_t*)ccmStart, ccmWords, (volatile uint32_t*)sramStart, sramWords,
+                               passPattern, &ccmErrors, &sramErrors);
+        }
+        else {
+            RunSequentialPass((volatile uint32_t*)ccmStart, ccmWords, passPattern, 0, &ccmErrors);
+            RunSequentialPass((volatile uint32_t*)sramStart, sramWords, passPattern, 1, &sramErrors);
+        }
+    }
+
+    /* Two passes, each writing and reading every word of both windows */
+    uint32_t cycles = GET_CYCLE_COUNT() - start;
+    uint32_t bytes = (ccmWords + sramWords) * 4 * 4;
+
+    stats->runs[mode]++;
+    stats->bytes[mode] += bytes;
+    stats->cycles[mode] += cycles;
+    RecordKernelRun((mode == DUAL_MODE_INTERLEAVED) ? KERNEL_DUAL_INTERLEAVED : KERNEL_DUAL_SEQUENTIAL,
+                    bytes, cycles);
+
+    if (ccmErrors > 0) ccmStatus.totalErrors += ccmErrors;
+    if (sramErrors > 0) GetRegionStatus(partner)->totalErrors += sramErrors;
+
+    return ccmErrors + sramErrors;
+}
+
+/**
+  * @brief  Report aggregate bandwidth, interleaved against sequential
+  */
+void ReportDualRegionStatus(void)
+{
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "Dual region (MB/s interleaved/sequential):");
+    uint32_t reported = 0;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        DualRegionStats* stats = &dualStats[region];
+        if (stats->cycles[DUAL_MODE_INTERLEAVED] == 0 || stats->cycles[DUAL_MODE_SEQUENTIAL] == 0) continue;
+
+        /* Bytes per microsecond is MB/s; multiplying by the clock would overflow */
+        uint64_t interleavedUs = CYCLES_TO_US(stats->cycles[DUAL_MODE_INTERLEAVED]);
+        uint64_t sequentialUs = CYCLES_TO_US(stats->cycles[DUAL_MODE_SEQUENTIAL]);
+        uint32_t interleavedRate = interleavedUs ? (uint32_t)(stats->bytes[DUAL_MODE_INTERLEAVED] / interleavedUs) : 0;
+        uint32_t sequentialRate = sequentialUs ? (uint32_t)(stats->bytes[DUAL_MODE_SEQUENTIAL] / sequentialUs) : 0;
+        int32_t gain = sequentialRate ? (int32_t)((uint64_t)interleavedRate * 100 / sequentialRate) - 100 : 0;
+
+        length += snprintf(buffer + length, sizeof(buffer) - length, " CCM+%s=%lu/%lu (%+ld%%)",
+                           GetRegionName(region), interleavedRate, sequentialRate, gain);
+        reported++;
+    }
+
+    if (reported == 0) return;
+
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -67,7 +67,8 @@ void FLASH_IRQHandler(void)
         snprintf(buffer, sizeof(buffer),
                  "Flash ECC Correctable Error Detected at: 0x%08lX\r\n",
                  eccErrorAddress);
-        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        LogECCEvent(eccErrorAddress, 0);
 
         /* Save error state but continue operation */
         SaveTestState(0, ERROR_ECC_DETECTED);
@@ -89,7 +90,8 @@ void FLASH_IRQHandler(void)
         snprintf(buffer, sizeof(buffer),
                  "Flash ECC Uncorrectable Error Detected at: 0x%08lX\r\n",
                  eccErrorAddress);
-        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        LogECCEvent(eccErrorAddress, 1);
 
         /* Save error state and continue operation */
         SaveTestState(0, ERROR_ECC_DETECTED);
@@ -147,7 +149,7 @@ void FLASH_IRQHandler(void)
     /* Report any other Flash errors */
     if (error) {
         char buffer[] = "Flash Error Detected\r\n";
-        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
     }
 }
 
@@ -0,0 +1,247 @@
+/**
+ * Die Temperature and Supply Monitor for STM32G473CB Memory Test
+ *
+ * Samples the internal temperature sensor and VREFINT with ADC1 in continuous
+ * mode, with DMA1 writing the results into RAM in circular mode. No interrupts
+ * are enabled, so readings cost the CPU nothing until they are converted.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* Function prototypes */
+void ConfigureEnvironmentMonitor(void);
+void SampleEnvironment(EnvironmentSample* sample);
+void RecordCycleSummary(const uint32_t regionErrors[NUM_TEST_REGIONS]);
+void ReportEnvironmentStatus(void);
+void PauseEnvironmentMonitor(void);
+void ResumeEnvironmentMonitor(void);
+
+/* ADC sequence ranks, in DMA buffer order */
+#define ENV_RANK_TEMPSENSOR   0
+#define ENV_RANK_VREFINT      1
+#define ENV_NUM_CHANNELS      2
+
+/* ADC and DMA handles */
+ADC_HandleTypeDef hadc1;
+DMA_HandleTypeDef hdma_adc1;
+
+/* Written by DMA only, read by SampleEnvironment() */
+static volatile uint16_t adcDmaBuffer[ENV_NUM_CHANNELS];
+
+/* Error rate versus temperature, per region */
+static TemperatureErrorBins temperatureBins[NUM_TEST_REGIONS];
+
+/* Most recent cycle summary */
+CycleSummaryRecord lastCycleSummary;
+
+/* Set while the DMA stream is running, and while it is paused */
+static uint32_t adcDmaRunning = 0;
+static uint32_t adcDmaPaused = 0;
+
+/**
+  * @brief  Start the circular DMA transfer of both ranks
+  * @retval 1 if the transfer started
+  */
+static uint32_t StartEnvironmentDma(void)
+{
+    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adcDmaBuffer, ENV_NUM_CHANNELS) != HAL_OK) {
+        return 0;
+    }
+
+    /* HAL_ADC_Start_DMA enables transfer and overrun interrupts - the buffer is
+       read on demand, so keep the CPU out of it entirely */
+    __HAL_DMA_DISABLE_IT(&hdma_adc1, DMA_IT_TC | DMA_IT_HT);
+    __HAL_ADC_DISABLE_IT(&hadc1, ADC_IT_OVR);
+    adcDmaRunning = 1;
+
+    return 1;
+}
+
+/**
+  * @brief  Configure ADC1 and DMA to sample the temperature sensor and VREFINT
+  */
+void ConfigureEnvironmentMonitor(void)
+{
+    ADC_ChannelConfTypeDef sConfig = {0};
+
+    memset(temperatureBins, 0, sizeof(temperatureBins));
+    memset(&lastCycleSummary, 0, sizeof(lastCycleSummary));
+
+    /* Continuous scan of both internal channels, oversampled to reduce noise
+       and DMA traffic. Results are overwritten in place, so no overrun handling. */
+    hadc1.Instance = ADC1;
+    hadc1.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    hadc1.Init.Resolution = ADC_RESOLUTION_12B;
+    hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    hadc1.Init.GainCompensation = 0;
+    hadc1.Init.ScanConvMode = ADC_SCAN_ENABLE;
+    hadc1.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    hadc1.Init.LowPowerAutoWait = DISABLE;
+    hadc1.Init.ContinuousConvMode = ENABLE;
+    hadc1.Init.NbrOfConversion = ENV_NUM_CHANNELS;
+    hadc1.Init.DiscontinuousConvMode = DISABLE;
+    hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadc1.Init.DMAContinuousRequests = ENABLE;
+    hadc1.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+    hadc1.Init.OversamplingMode = ENABLE;
+    hadc1.Init.Oversampling.Ratio = ADC_OVERSAMPLING_RATIO_16;
+    hadc1.Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_4;
+    hadc1.Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+    hadc1.Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
+    if (HAL_ADC_Init(&hadc1) != HAL_OK) {
+        char buffer[] = "Environment Monitor Error: ADC init failed\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+
+    /* Both internal channels need the longest sampling time (>= 5us for the sensor) */
+    sConfig.SamplingTime = ADC_SAMPLETIME_640CYCLES_5;
+    sConfig.SingleDiff = ADC_SINGLE_ENDED;
+    sConfig.OffsetNumber = ADC_OFFSET_NONE;
+    sConfig.Offset = 0;
+
+    sConfig.Channel = ADC_CHANNEL_TEMPSENSOR_ADC1;
+    sConfig.Rank = ADC_REGULAR_RANK_1;
+    HAL_ADC_ConfigChannel(&hadc1, &sConfig);
+
+    sConfig.Channel = ADC_CHANNEL_VREFINT;
+    sConfig.Rank = ADC_REGULAR_RANK_2;
+    HAL_ADC_ConfigChannel(&hadc1, &sConfig);
+
+    HAL_ADCEx_Calibration_Start(&hadc1, ADC_SINGLE_ENDED);
+
+    if (!StartEnvironmentDma()) {
+        char buffer[] = "Environment Monitor Error: ADC DMA start failed\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+}
+
+/**
+  * @brief  Stop the ADC and its DMA stream, keeping the last readings
+  * @note   For code that moves or overwrites the memory the DMA writes to
+  */
+void PauseEnvironmentMonitor(void)
+{
+    if (!adcDmaRunning) return;
+
+    HAL_ADC_Stop_DMA(&hadc1);
+    adcDmaRunning = 0;
+    adcDmaPaused = 1;
+}
+
+/**
+  * @brief  Restart conversions stopped by PauseEnvironmentMonitor()
+  */
+void ResumeEnvironmentMonitor(void)
+{
+    if (!adcDmaPaused) return;
+
+    adcDmaPaused = 0;
+    StartEnvironmentDma();
+}
+
+/**
+  * @brief  Convert the latest DMA readings into temperature and VDDA
+  * @param  sample: Pointer to sample structure to fill
+  */
+void SampleEnvironment(EnvironmentSample* sample)
+{
+    uint32_t vrefRaw = adcDmaBuffer[ENV_RANK_VREFINT];
+    uint32_t tempRaw = adcDmaBuffer[ENV_RANK_TEMPSENSOR];
+
+    /* No conversion has completed yet */
+    if (vrefRaw == 0) {
+        sample->temperatureC = 0;
+        sample->vddaMv = 0;
+        return;
+    }
+
+    uint32_t vddaMv = __HAL_ADC_CALC_VREFANALOG_VOLTAGE(vrefRaw, ADC_RESOLUTION_12B);
+    sample->vddaMv = (uint16_t)vddaMv;
+    sample->temperatureC = (int16_t)__HAL_ADC_CALC_TEMPERATURE(vddaMv, tempRaw, ADC_RESOLUTION_12B);
+}
+
+/**
+  * @brief  Map a temperature to its error-rate bin
+  * @param  temperatureC: Die temperature in degrees C
+  * @retval Bin index, clamped to the first and last bin
+  */
+static uint32_t GetTemperatureBin(int32_t temperatureC)
+{
+    if (temperatureC < TEMP_BIN_MIN_C) return 0;
+
+    uint32_t bin = (uint32_t)(temperatureC - TEMP_BIN_MIN_C) / TEMP_BIN_WIDTH_C;
+    return (bin < TEMP_BIN_COUNT) ? bin : TEMP_BIN_COUNT - 1;
+}
+
+/**
+  * @brief  Tag the cycle that just finished with temperature and supply
+  * @param  regionErrors: Errors detected in each region during the cycle
+  */
+void RecordCycleSummary(const uint32_t regionErrors[NUM_TEST_REGIONS])
+{
+    lastCycleSummary.cycle = testCycleCounter;
+    lastCycleSummary.tick = HAL_GetTick();
+    lastCycleSummary.quarantined = GetQuarantineCount();
+    SampleEnvironment(&lastCycleSummary.environment);
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        lastCycleSummary.regionErrors[region] = regionErrors[region];
+    }
+
+    /* Cycles without a valid reading can't be attributed to a bin */
+    if (lastCycleSummary.environment.vddaMv == 0) return;
+
+    uint32_t bin = GetTemperatureBin(lastCycleSummary.environment.temperatureC);
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        temperatureBins[region].cycles[bin]++;
+        temperatureBins[region].errors[bin] += regionErrors[region];
+    }
+}
+
+/**
+  * @brief  Report current readings and the non-empty error-rate bins
+  */
+void ReportEnvironmentStatus(void)
+{
+    char buffer[256];
+    EnvironmentSample sample;
+    SampleEnvironment(&sample);
+
+    snprintf(buffer, sizeof(buffer),
+             "Environment: T=%dC VDDA=%umV | Last cycle %lu: T=%dC VDDA=%umV quarantined=%lu\r\n",
+             sample.temperatureC, sample.vddaMv,
+             lastCycleSummary.cycle,
+             lastCycleSummary.environment.temperatureC,
+             lastCycleSummary.environment.vddaMv,
+             lastCycleSummary.quarantined);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        int length = snprintf(buffer, sizeof(buffer), "%s errors/cycles by temp:", GetRegionName(region));
+
+        for (uint32_t bin = 0; bin < TEMP_BIN_COUNT && length < (int)sizeof(buffer); bin++) {
+            if (temperatureBins[region].cycles[bin] == 0) continue;
+
+            length += snprintf(buffer + length, sizeof(buffer) - length, " [%ldC]%lu/%lu",
+                               (int32_t)(TEMP_BIN_MIN_C + (int32_t)bin * TEMP_BIN_WIDTH_C),
+                               temperatureBins[region].errors[bin],
+                               temperatureBins[region].cycles[bin]);
+        }
+
+        if (length < (int)sizeof(buffer) - 2) {
+            strcpy(buffer + length, "\r\n");
+        }
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+}
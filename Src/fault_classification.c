@@ -0,0 +1,197 @@
+/**
+ * Transient / Intermittent / Permanent Fault Classification
+ *
+ * When a test finds a mismatch, the failing word is re-checked on the spot
+ * instead of repeating the whole pass. SRAM words are rewritten and re-read
+ * with varied neighbouring bits and dwell times; flash words, which can't be
+ * rewritten in place, are re-read with the ART cache flushed in between.
+ * An error that never reproduces is transient (an upset), one that always
+ * reproduces is permanent, anything in between is intermittent.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Re-check schedule; RECHECK_SRAM_TRIALS is in memory_test.h */
+#define RECHECK_FLASH_READS   4
+
+/* Function prototypes */
+uint32_t ClassifyMemoryError(uint32_t address, uint32_t readValue, uint32_t expectedValue);
+uint32_t RecheckSRAMWord(volatile uint32_t* addr, uint32_t failMask, uint32_t expectedValue, uint32_t cyclesPerUs);
+uint32_t CountFaultClass(uint32_t address, uint32_t failures, uint32_t trials);
+const char* GetFaultClassName(uint32_t faultClass);
+void ReportFaultClassStatus(void);
+
+/* Bits other than the failing ones are flipped by this mask, so the failing
+   bits always hold their expected value while their neighbours change */
+static const uint32_t recheckNeighbourMasks[RECHECK_SRAM_TRIALS] = {
+    0x00000000, 0xFFFFFFFF, 0x55555555, 0xAAAAAAAA, 0x00000000, 0xFFFFFFFF
+};
+
+/* Dwell between write and read-back for each trial */
+static const uint32_t recheckDelaysUs[RECHECK_SRAM_TRIALS] = {
+    0, 0, 10, 10, 100, 1000
+};
+
+static const char* const faultClassNames[NUM_FAULT_CLASSES] = {
+    "unclassified", "transient", "intermittent", "permanent"
+};
+
+/**
+  * @brief  Busy-wait on the cycle counter
+  * @param  cycles: Delay in core clock cycles
+  */
+static void WaitCycles(uint32_t cycles)
+{
+    uint32_t start = GET_CYCLE_COUNT();
+
+    while ((GET_CYCLE_COUNT() - start) < cycles) {
+    }
+}
+
+/**
+  * @brief  Rewrite and re-read a failing SRAM word
+  * @param  addr: Failing word
+  * @param  failMask: Bits that read back wrong
+  * @param  expectedValue: Value the word should hold
+  * @param  cyclesPerUs: Core clock cycles per microsecond
+  * @retval Number of trials that read back wrong
+  * @note   Touches only the word, flash constants and the cycle counter, so
+  *         the relocated March can call it with its chunk switched out.
+  */
+uint32_t RecheckSRAMWord(volatile uint32_t* addr, uint32_t failMask, uint32_t expectedValue, uint32_t cyclesPerUs)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t trial = 0; trial < RECHECK_SRAM_TRIALS; trial++) {
+        uint32_t pattern = expectedValue ^ (recheckNeighbourMasks[trial] & ~failMask);
+
+        /* Write the complement first so every bit has to transition */
+        *addr = ~pattern;
+        *addr = pattern;
+
+        WaitCycles(recheckDelaysUs[trial] * cyclesPerUs);
+
+        if (*addr != pattern) failures++;
+    }
+
+    /* Leave the word as the interrupted test expects to find it */
+    *addr = expectedValue;
+
+    return failures;
+}
+
+/**
+  * @brief  Re-read a failing flash word with the ART cache flushed each time
+  * @param  addr: Failing word
+  * @param  expectedValue: Value the word should hold
+  * @retval Number of reads that returned the wrong value
+  */
+static uint32_t RecheckFlashWord(volatile uint32_t* addr, uint32_t expectedValue)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t read = 0; read < RECHECK_FLASH_READS; read++) {
+        __HAL_FLASH_ART_DISABLE();
+        __HAL_FLASH_ART_RESET();
+        __HAL_FLASH_ART_ENABLE();
+
+        WaitCycles(US_TO_CYCLES(recheckDelaysUs[read]));
+
+        if (*addr != expectedValue) failures++;
+    }
+
+    return failures;
+}
+
+/**
+  * @brief  Re-check a failing word and count it against its region's class
+  * @param  address: Failing address
+  * @param  readValue: Value the test read back
+  * @param  expectedValue: Value the test expected
+  * @retval FAULT_TRANSIENT, FAULT_INTERMITTENT or FAULT_PERMANENT
+  */
+uint32_t ClassifyMemoryError(uint32_t address, uint32_t readValue, uint32_t expectedValue)
+{
+    uint32_t region = GetRegionForAddress(address);
+    volatile uint32_t* addr = (volatile uint32_t*)(address & ~0x3U);
+
+    if (region == REGION_NONE) return FAULT_UNCLASSIFIED;
+
+    if (region == REGION_FLASH) {
+        return CountFaultClass(address, RecheckFlashWord(addr, expectedValue), RECHECK_FLASH_READS);
+    }
+
+    return CountFaultClass(address,
+                           RecheckSRAMWord(addr, readValue ^ expectedValue, expectedValue,
+                                           SystemCoreClock / 1000000U),
+                           RECHECK_SRAM_TRIALS);
+}
+
+/**
+  * @brief  Turn a re-check result into a class and count it for the region
+  * @param  address: Failing address
+  * @param  failures: Re-checks that read back wrong
+  * @param  trials: Re-checks made
+  * @retval FAULT_TRANSIENT, FAULT_INTERMITTENT or FAULT_PERMANENT
+  */
+uint32_t CountFaultClass(uint32_t address, uint32_t failures, uint32_t trials)
+{
+    uint32_t region = GetRegionForAddress(address);
+
+    if (region == REGION_NONE) return FAULT_UNCLASSIFIED;
+
+    MemoryTestStatus* status = GetRegionStatus(region);
+
+    if (failures == 0) {
+        status->transientErrors++;
+        return FAULT_TRANSIENT;
+    }
+    if (failures == trials) {
+        status->permanentErrors++;
+        return FAULT_PERMANENT;
+    }
+
+    status->intermittentErrors++;
+    return FAULT_INTERMITTENT;
+}
+
+/**
+  * @brief  Get the printable name of a fault class
+  * @param  faultClass: Fault class
+  * @retval Class name
+  */
+const char* GetFaultClassName(uint32_t faultClass)
+{
+    return (faultClass < NUM_FAULT_CLASSES) ? faultClassNames[faultClass] : "unknown";
+}
+
+/**
+  * @brief  Report transient/intermittent/permanent counts per region
+  */
+void ReportFaultClassStatus(void)
+{
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "Fault classes (T/I/P):");
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        MemoryTestStatus* status = GetRegionStatus(region);
+
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %s=%lu/%lu/%lu",
+                           GetRegionName(region),
+                           status->transientErrors,
+                           status->intermittentErrors,
+                           status->permanentErrors);
+    }
+
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
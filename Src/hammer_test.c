@@ -0,0 +1,235 @@
+/**
+ * Read/Write Disturb Hammer Test for STM32G473CB Memory Test
+ *
+ * Alternates LDM (or, for SRAM, STM) bursts between two aggressor addresses
+ * at full bus rate, then checks the victims between them. The inner loop is
+ * unrolled and runs from CCM SRAM, so instruction fetches use the I-bus and
+ * the ART cache can be turned off for flash targets without slowing the
+ * kernel. Hammering is split into short slices with a watchdog refresh in
+ * between, and the achieved access rate is measured with the cycle counter.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern MemoryTestConfig testConfig;
+
+/* Kernel geometry */
+#define HAMMER_WORDS_PER_ITER     32      /* 8 bursts of 4 words per loop pass */
+#define HAMMER_SLICE_ITERATIONS   4096    /* ~131k accesses between watchdog refreshes */
+#define HAMMER_FLASH_VICTIM_WORDS 256     /* Flash victims snapshotted before hammering */
+
+/* Per-region results */
+typedef struct {
+    uint32_t runs;
+    uint32_t errors;
+    uint32_t lastMode;
+    uint32_t lastRate;             /* Accesses per second on the last run */
+    uint32_t peakRate;
+} HammerStats;
+
+/* Function prototypes */
+uint32_t RunHammerTest(uint32_t startAddr, uint32_t size, uint32_t mode, uint32_t durationMs);
+void ReportHammerStatus(void);
+
+static HammerStats hammerStats[NUM_TEST_REGIONS];
+static uint32_t hammerSkipped = 0;
+
+/* Flash can't be rewritten, so victims are compared against a copy */
+static uint32_t flashVictimSnapshot[HAMMER_FLASH_VICTIM_WORDS];
+
+/**
+  * @brief  Read both aggressors in LDM bursts
+  * @param  aggressorA: First aggressor, 4 words
+  * @param  aggressorB: Second aggressor, 4 words
+  * @param  iterations: Loop passes, each making HAMMER_WORDS_PER_ITER reads
+  * @note   The bursts skip r7, the frame pointer in Debug builds
+  */
+CCM_RAMFUNC static void HammerReadBurst(volatile uint32_t* aggressorA, volatile uint32_t* aggressorB, uint32_t iterations)
+{
+    __asm volatile (
+        "1:                        \n"
+        "ldm   %[a], {r4-r6, r8}   \n"
+        "ldm   %[b], {r4-r6, r8}   \n"
+        "ldm   %[a], {r4-r6, r8}   \n"
+        "ldm   %[b], {r4-r6, r8}   \n"
+        "ldm   %[a], {r4-r6, r8}   \n"
+        "ldm   %[b], {r4-r6, r8}   \n"
+        "ldm   %[a], {r4-r6, r8}   \n"
+        "ldm   %[b], {r4-r6, r8}   \n"
+        "subs  %[n], %[n], #1      \n"
+        "bne   1b                  \n"
+        : [n] "+r" (iterations)
+        : [a] "r" (aggressorA), [b] "r" (aggressorB)
+        : "r4", "r5", "r6", "r8", "cc", "memory");
+}
+
+/**
+  * @brief  Write both aggressors in STM bursts
+  * @param  aggressorA: First aggressor, 4 words
+  * @param  aggressorB: Second aggressor, 4 words
+  * @param  value: Value written to every aggressor word
+  * @param  iterations: Loop passes, each making HAMMER_WORDS_PER_ITER writes
+  */
+CCM_RAMFUNC static void HammerWriteBurst(volatile uint32_t* aggressorA, volatile uint32_t* aggressorB, uint32_t value, uint32_t iterations)
+{
+    __asm volatile (
+        "mov   r4, %[v]            \n"
+        "mov   r5, %[v]            \n"
+        "mov   r6, %[v]            \n"
+        "mov   r8, %[v]            \n"
+        "1:                        \n"
+        "stm   %[a], {r4-r6, r8}   \n"
+        "stm   %[b], {r4-r6, r8}   \n"
+        "stm   %[a], {r4-r6, r8}   \n"
+        "stm   %[b], {r4-r6, r8}   \n"
+        "stm   %[a], {r4-r6, r8}   \n"
+        "stm   %[b], {r4-r6, r8}   \n"
+        "stm   %[a], {r4-r6, r8}   \n"
+        "stm   %[b], {r4-r6, r8}   \n"
+        "subs  %[n], %[n], #1      \n"
+        "bne   1b                  \n"
+        : [n] "+r" (iterations)
+        : [a] "r" (aggressorA), [b] "r" (aggressorB), [v] "r" (value)
+        : "r4", "r5", "r6", "r8", "cc", "memory");
+}
+
+/**
+  * @brief  Hammer two aggressors in a window and check the victims between them
+  * @param  startAddr: Window start, first aggressor
+  * @param  size: Window size in bytes
+  * @param  mode: HAMMER_MODE_READ or HAMMER_MODE_WRITE (SRAM only)
+  * @param  durationMs: Time to spend hammering
+  * @retval Number of errors detected
+  * @note   The second aggressor sits testConfig.hammerAggressorStride bytes
+  *         after the first, shortened to fit the window.
+  */
+uint32_t RunHammerTest(uint32_t startAddr, uint32_t size, uint32_t mode, uint32_t durationMs)
+{
+    uint32_t errors = 0;
+    uint32_t region = GetRegionForAddress(startAddr);
+
+    if (region == REGION_NONE || !IsCCMCodeReady()) {
+        hammerSkipped++;
+        return 0;
+    }
+
+    /* Aggressors and victims */
+    uint32_t stride = testConfig.hammerAggressorStride & ~(HAMMER_AGGRESSOR_SIZE - 1);
+    if (stride + HAMMER_AGGRESSOR_SIZE > size) {
+        stride = (size - HAMMER_AGGRESSOR_SIZE) & ~(HAMMER_AGGRESSOR_SIZE - 1);
+    }
+    if (size < 2 * HAMMER_AGGRESSOR_SIZE || stride < 2 * HAMMER_AGGRESSOR_SIZE) {
+        hammerSkipped++;
+        return 0;
+    }
+
+    volatile uint32_t* aggressorA = (volatile uint32_t*)startAddr;
+    volatile uint32_t* aggressorB = (volatile uint32_t*)(startAddr + stride);
+    volatile uint32_t* victims = (volatile uint32_t*)(startAddr + HAMMER_AGGRESSOR_SIZE);
+    uint32_t numVictims = (stride - HAMMER_AGGRESSOR_SIZE) / 4;
+
+    HammerStats* stats = &hammerStats[region];
+    uint32_t pattern = marchDataBackgrounds[stats->runs % MARCH_NUM_BACKGROUNDS];
+
+    if (region == REGION_FLASH) {
+        /* Flash is read-only here - record what the victims hold now */
+        mode = HAMMER_MODE_READ;
+        if (numVictims > HAMMER_FLASH_VICTIM_WORDS) numVictims = HAMMER_FLASH_VICTIM_WORDS;
+        for (uint32_t i = 0; i < numVictims; i++) {
+            flashVictimSnapshot[i] = victims[i];
+        }
+
+        /* Every read has to reach the flash array, not the cache */
+        __HAL_FLASH_ART_DISABLE();
+    }
+    else {
+        /* Victims hold the background, aggressors its inverse */
+        for (uint32_t i = 0; i < numVictims; i++) {
+            victims[i] = pattern;
+        }
+        for (uint32_t i = 0; i < HAMMER_AGGRESSOR_SIZE / 4; i++) {
+            aggressorA[i] = ~pattern;
+            aggressorB[i] = ~pattern;
+        }
+    }
+
+    /* Hammer in slices so the watchdog can be fed */
+    uint32_t startTick = HAL_GetTick();
+    uint32_t startCycles = GET_CYCLE_COUNT();
+    uint32_t slices = 0;
+
+    do {
+        if (mode == HAMMER_MODE_WRITE) {
+            HammerWriteBurst(aggressorA, aggressorB, ~pattern, HAMMER_SLICE_ITERATIONS);
+        }
+        else {
+            HammerReadBurst(aggressorA, aggressorB, HAMMER_SLICE_ITERATIONS);
+        }
+        slices++;
+
+        HAL_IWDG_Refresh(&hiwdg);
+    } while (HAL_GetTick() - startTick < durationMs);
+
+    uint32_t elapsedCycles = GET_CYCLE_COUNT() - startCycles;
+
+    if (region == REGION_FLASH) {
+        __HAL_FLASH_ART_RESET();
+        __HAL_FLASH_ART_ENABLE();
+    }
+
+    /* Check the victims */
+    for (uint32_t i = 0; i < numVictims; i++) {
+        uint32_t expected = (region == REGION_FLASH) ? flashVictimSnapshot[i] : pattern;
+        uint32_t readValue = victims[i];
+        if (readValue != expected) {
+            errors += RecordMemoryError("Hammer", (uint32_t)&victims[i], readValue, expected);
+        }
+    }
+
+    /* Achieved access rate */
+    uint64_t accesses = (uint64_t)slices * HAMMER_SLICE_ITERATIONS * HAMMER_WORDS_PER_ITER;
+    if (elapsedCycles > 0) {
+        stats->lastRate = (uint32_t)((accesses * SystemCoreClock) / elapsedCycles);
+        if (stats->lastRate > stats->peakRate) stats->peakRate = stats->lastRate;
+    }
+
+    stats->runs++;
+    stats->errors += errors;
+    stats->lastMode = mode;
+
+    return errors;
+}
+
+/**
+  * @brief  Report hammer runs and achieved access rates per region
+  */
+void ReportHammerStatus(void)
+{
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "Hammer (kaccess/s last/peak):");
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        HammerStats* stats = &hammerStats[region];
+        if (stats->runs == 0) continue;
+
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %s[%s]=%lu/%lu runs=%lu errors=%lu",
+                           GetRegionName(region),
+                           (stats->lastMode == HAMMER_MODE_WRITE) ? "W" : "R",
+                           stats->lastRate / 1000, stats->peakRate / 1000,
+                           stats->runs, stats->errors);
+    }
+
+    if (length < (int)sizeof(buffer)) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, " skipped=%lu", hammerSkipped);
+    }
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
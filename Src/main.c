@@ -49,6 +49,9 @@ void ReportConfigStatus(void);
   */
 void InitializeTests(void)
 {
+    /* Framework state pages must be cleared before anything uses them */
+    InitializeFrameworkState();
+
     /* Reset all status counters */
     memset(&flashStatus, 0, sizeof(MemoryTestStatus));
     memset(&sram1Status, 0, sizeof(MemoryTestStatus));
@@ -56,6 +59,12 @@ void InitializeTests(void)
     memset(&ccmStatus, 0, sizeof(MemoryTestStatus));
     memset(&cacheStatus, 0, sizeof(MemoryTestStatus));
 
+    /* Find the free memory in each region from the linker symbols */
+    InitializeMemoryLayout();
+
+    /* Paint the stack reservation while the stack is still shallow */
+    InitializeStackMonitor();
+
     /* Initialize configuration with default values */
     InitializeDefaultConfig();
 
@@ -68,7 +77,58 @@ void InitializeTests(void)
     /* Initialize reporting timer */
     lastReportTime = 0;
 
-    /* Report initial configuration */
+    /* Cycle counter is used for time budgets */
+    ENABLE_CYCLE_COUNTER();
+
+    /* Kernels that run from CCM SRAM */
+    InitializeCCMCode();
+
+    /* Boot pin selects the production go/no-go pass, which does not return */
+    if (IsProductionPinAsserted()) {
+        RunProductionTest();
+    }
+
+    /* SRAM parity checking, with the checked memory initialized */
+    InitializeParityMonitor();
+
+    /* MPU guard over the SRAM test windows, armed each cycle */
+    InitializeWindowGuard();
+
+    /* Start background temperature and supply sampling */
+    ConfigureEnvironmentMonitor();
+
+    /* Commands are read between cycles */
+    InitializeCommandInterface();
+
+    /* Locate the persistent log write position */
+    InitializePersistentLog();
+
+    /* Reload addresses quarantined before the last reset */
+    InitializeQuarantine();
+
+    /* Pick up a burn-in that was running before the reset */
+    InitializeBurnIn();
+
+    /* Check the uploaded test script, if there is one */
+    InitializeTestScript();
+
+    /* Report the self-test that ran before main, quarantining what it found */
+    ReportPostResult();
+
+    /* All regions start at full sampling with nothing escalated */
+    InitializeAdaptiveControl();
+
+    /* No retention windows in flight */
+    InitializeRetentionTests();
+
+    /* DMA channels for the stress mode, idle until a stress cycle */
+    InitializeDmaStress();
+
+    /* DMA + CRC worker that verifies flash beside the CPU kernels */
+    InitializeCrcVerifier();
+
+    /* Report the memory layout and initial configuration */
+    ReportMemoryLayout();
     ReportConfigStatus();
 }
 
@@ -112,16 +172,33 @@ void MainTestCycle(void)
     /* Rotate test parameters at the beginning of each cycle if enabled */
     RotateTestParameters(testCycleCounter);
 
-    /* Every 20 cycles, report the current configuration */
-    if (testCycleCounter % 20 == 0) {
+    /* Pick this cycle's sampling level for each region */
+    PlanAdaptiveCycle();
+
+    /* Guard this cycle's SRAM windows against everything but the kernels */
+    ArmWindowGuard();
+
+    /* Every 20 cycles, report the current configuration - not during burn-in */
+    if (testCycleCounter % 20 == 0 && !IsBurnInActive()) {
         ReportConfigStatus();
     }
 
+    /* Snapshot error totals so this cycle's errors can be summarized */
+    uint32_t errorsBefore[NUM_TEST_REGIONS];
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        errorsBefore[region] = GetRegionStatus(region)->totalErrors;
+    }
+
+    /* Verify retention windows that have held long enough and start new ones */
+    OpenTestWindows(GUARD_ALL_WINDOWS);
+    ServiceRetentionTests();
+    CloseTestWindows(GUARD_ALL_WINDOWS);
+
     /* Run tests based on current mode */
     switch (currentTestMode) {
         case STRESS_TEST_CYCLE:
-            /* Run all tests with more intensive patterns */
-            TestAllMemoryRegions();
+            /* Run all tests with background DMA loading the bus matrix */
+            RunStressTestCycle();
             break;
 
         case SRAM_ONLY_CYCLE:
@@ -146,9 +223,68 @@ void MainTestCycle(void)
             break;
     }
 
-    /* Report status at configurable intervals */
-    if (HAL_GetTick() - lastReportTime >= testConfig.reportIntervalMs) {
+    /* Spend the time saved by sampling on recently failed blocks */
+    OpenTestWindows(GUARD_ALL_WINDOWS);
+    RunEscalatedTests();
+    CloseTestWindows(GUARD_ALL_WINDOWS);
+
+    /* Now and then March all of SRAM1 or CCM, in turn, with the stack moved out */
+    if (testConfig.relocatedMarchInterval > 0 && testCycleCounter % testConfig.relocatedMarchInterval == 0) {
+        uint32_t pass = testCycleCounter / testConfig.relocatedMarchInterval;
+        RunRelocatedMarch((pass & 1) ? REGION_CCM_SRAM : REGION_SRAM1);
+    }
+
+    /* Algorithms uploaded since the firmware was built */
+    if (testConfig.scriptInterval > 0 && testCycleCounter % testConfig.scriptInterval == 0) {
+        OpenTestWindows(GUARD_ALL_WINDOWS);
+        RunTestScript();
+        CloseTestWindows(GUARD_ALL_WINDOWS);
+    }
+
+    /* Tag this cycle with die temperature and supply */
+    uint32_t cycleErrors[NUM_TEST_REGIONS];
+    uint32_t cycleErrorTotal = 0;
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        cycleErrors[region] = GetRegionStatus(region)->totalErrors - errorsBefore[region];
+        cycleErrorTotal += cycleErrors[region];
+    }
+    RecordCycleSummary(cycleErrors);
+
+    /* Persist cycles with errors, plus a periodic heartbeat of clean ones - burn-in checkpoints instead */
+    if (cycleErrorTotal > 0 || (!IsBurnInActive() && testCycleCounter % testConfig.logCycleInterval == 0)) {
+        LogCycleSummary(&lastCycleSummary);
+    }
+    ServiceWindowGuard();
+    ServiceStackMonitor();
+    ServiceParityEvents();
+    ServicePersistentLog();
+    ServiceQuarantine();
+    ServiceCommandInterface();
+
+    /* Burn-in keeps to its totals and summaries; otherwise report status at configurable intervals */
+    if (IsBurnInActive()) {
+        ServiceBurnIn(cycleErrors);
+    }
+    else if (HAL_GetTick() - lastReportTime >= testConfig.reportIntervalMs) {
         ReportTestStatus();
+        ReportEnvironmentStatus();
+        ReportPersistentLogStatus();
+        ReportFaultClassStatus();
+        ReportParityStatus();
+        ReportWindowGuardStatus();
+        ReportStackStatus();
+        ReportRelocationStatus();
+        ReportQuarantineStatus();
+        ReportAdaptiveStatus();
+        ReportRetentionStatus();
+        ReportHammerStatus();
+        ReportDmaStressStatus();
+        ReportDualRegionStatus();
+        ReportCrcVerifierStatus();
+        ReportBackgroundFillStatus();
+        ReportBusTierStatus();
+        ReportTestScriptStatus();
+        ReportKernelStatus();
         lastReportTime = HAL_GetTick();
     }
 
@@ -167,11 +303,32 @@ void TestAllMemoryRegions(void)
     uint32_t sram2TestStart = GetSRAM2TestStart();
     uint32_t ccmTestStart = GetCCMTestStart();
 
+    /* Clean regions are sampled, freeing time for escalated blocks */
+    uint32_t flashTestSize = GetSampledTestSize(REGION_FLASH, testConfig.flashTestSize);
+    uint32_t sram1TestSize = GetSampledTestSize(REGION_SRAM1, testConfig.sram1TestSize);
+    uint32_t sram2TestSize = GetSampledTestSize(REGION_SRAM2, testConfig.sram2TestSize);
+    uint32_t ccmTestSize = GetSampledTestSize(REGION_CCM_SRAM, testConfig.ccmTestSize);
+
+    /* Windows that hold a retention pattern are tested around it this cycle */
+    uint32_t sram1Deferred = ClipWindowForRetention(REGION_SRAM1, &sram1TestStart, &sram1TestSize);
+    uint32_t sram2Deferred = ClipWindowForRetention(REGION_SRAM2, &sram2TestStart, &sram2TestSize);
+    uint32_t ccmDeferred = ClipWindowForRetention(REGION_CCM_SRAM, &ccmTestStart, &ccmTestSize);
+
+    /* Data bus, then address bus: a region that fails a tier sits the device
+       tests out with one diagnosis instead of an error from every test */
+    sram1Deferred = sram1Deferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1),
+        RunBusTiers(REGION_SRAM1, sram1TestStart, sram1TestSize)) != BUS_TIER_PASS;
+    sram2Deferred = sram2Deferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2),
+        RunBusTiers(REGION_SRAM2, sram2TestStart, sram2TestSize)) != BUS_TIER_PASS;
+    ccmDeferred = ccmDeferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM),
+        RunBusTiers(REGION_CCM_SRAM, ccmTestStart, ccmTestSize)) != BUS_TIER_PASS;
+
     /* Test Flash Memory */
+    uint32_t regionStart = GET_CYCLE_COUNT();
     UpdateTestOperation("Flash Address Test");
     uint32_t errors = RunImprovedAddressTest(
         flashTestStart,
-        testConfig.flashTestSize,
+        flashTestSize,
         FLASH_SIZE);
     flashStatus.addressTestTotal++;
     if (errors == 0) flashStatus.addressTestSuccess++;
@@ -181,7 +338,7 @@ void TestAllMemoryRegions(void)
     UpdateTestOperation("Flash Butterfly Test");
     errors = RunEnhancedButterflyTest(
         flashTestStart,
-        testConfig.flashTestSize,
+        flashTestSize,
         FLASH_SIZE);
     flashStatus.addressTestTotal++;
     if (errors == 0) flashStatus.addressTestSuccess++;
@@ -191,7 +348,7 @@ void TestAllMemoryRegions(void)
     UpdateTestOperation("Flash Checkerboard Test 0xAA55AA55");
     errors = RunCheckerboardTest(
         flashTestStart,
-        testConfig.flashTestSize,
+        flashTestSize,
         0xAA55AA55,
         &flashStatus);
     if (errors > 0) flashStatus.totalErrors += errors;
@@ -199,121 +356,155 @@ void TestAllMemoryRegions(void)
     UpdateTestOperation("Flash Checkerboard Test 0x55AA55AA");
     errors = RunCheckerboardTest(
         flashTestStart,
-        testConfig.flashTestSize,
+        flashTestSize,
         0x55AA55AA,
         &flashStatus);
     if (errors > 0) flashStatus.totalErrors += errors;
 
+    RecordRegionCost(REGION_FLASH, GET_CYCLE_COUNT() - regionStart, flashTestSize);
+
+    /* DMA and CRC unit check flash signatures while the CPU tests SRAM */
+    StartCrcVerifier();
+
     /* Test SRAM1 */
-    UpdateTestOperation("SRAM1 Address Test");
-    errors = RunImprovedAddressTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    /* Run enhanced butterfly test on SRAM1 */
-    UpdateTestOperation("SRAM1 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    /* Run basic checkerboard tests on SRAM1 */
-    UpdateTestOperation("SRAM1 Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0xAA55AA55,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
+    if (!sram1Deferred) {
+        regionStart = GET_CYCLE_COUNT();
+        UpdateTestOperation("SRAM1 Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunImprovedAddressTest(
+            sram1TestStart,
+            sram1TestSize,
+            SRAM1_SIZE));
+        sram1Status.addressTestTotal++;
+        if (errors == 0) sram1Status.addressTestSuccess++;
+        else sram1Status.totalErrors += errors;
 
-    UpdateTestOperation("SRAM1 Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0x55AA55AA,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
+        /* Run enhanced butterfly test on SRAM1 */
+        UpdateTestOperation("SRAM1 Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunEnhancedButterflyTest(
+            sram1TestStart,
+            sram1TestSize,
+            SRAM1_SIZE));
+        sram1Status.addressTestTotal++;
+        if (errors == 0) sram1Status.addressTestSuccess++;
+        else sram1Status.totalErrors += errors;
+
+        /* Run basic checkerboard tests on SRAM1 */
+        UpdateTestOperation("SRAM1 Checkerboard Test 0xAA55AA55");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunCheckerboardTestOrdered(
+            sram1TestStart,
+            sram1TestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram1Status));
+        if (errors > 0) sram1Status.totalErrors += errors;
+
+        /* The checkerboard above already covers the inverse pattern */
+        UpdateTestOperation("SRAM1 Random Data Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunRandomDataTest(
+            sram1TestStart,
+            sram1TestSize,
+            GenerateRandomSeed(sram1TestStart),
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram1Status));
+        if (errors > 0) sram1Status.totalErrors += errors;
+
+        RecordRegionCost(REGION_SRAM1, GET_CYCLE_COUNT() - regionStart, sram1TestSize);
+    }
 
     /* Test SRAM2 */
-    UpdateTestOperation("SRAM2 Address Test");
-    errors = RunImprovedAddressTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    /* Run enhanced butterfly test on SRAM2 */
-    UpdateTestOperation("SRAM2 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    /* Run basic checkerboard tests on SRAM2 */
-    UpdateTestOperation("SRAM2 Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0xAA55AA55,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
+    if (!sram2Deferred) {
+        regionStart = GET_CYCLE_COUNT();
+        UpdateTestOperation("SRAM2 Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunImprovedAddressTest(
+            sram2TestStart,
+            sram2TestSize,
+            SRAM2_SIZE));
+        sram2Status.addressTestTotal++;
+        if (errors == 0) sram2Status.addressTestSuccess++;
+        else sram2Status.totalErrors += errors;
 
-    UpdateTestOperation("SRAM2 Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0x55AA55AA,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
+        /* Run enhanced butterfly test on SRAM2 */
+        UpdateTestOperation("SRAM2 Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunEnhancedButterflyTest(
+            sram2TestStart,
+            sram2TestSize,
+            SRAM2_SIZE));
+        sram2Status.addressTestTotal++;
+        if (errors == 0) sram2Status.addressTestSuccess++;
+        else sram2Status.totalErrors += errors;
+
+        /* Run basic checkerboard tests on SRAM2 */
+        UpdateTestOperation("SRAM2 Checkerboard Test 0xAA55AA55");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunCheckerboardTestOrdered(
+            sram2TestStart,
+            sram2TestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram2Status));
+        if (errors > 0) sram2Status.totalErrors += errors;
+
+        /* The checkerboard above already covers the inverse pattern */
+        UpdateTestOperation("SRAM2 Random Data Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunRandomDataTest(
+            sram2TestStart,
+            sram2TestSize,
+            GenerateRandomSeed(sram2TestStart),
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram2Status));
+        if (errors > 0) sram2Status.totalErrors += errors;
+
+        RecordRegionCost(REGION_SRAM2, GET_CYCLE_COUNT() - regionStart, sram2TestSize);
+    }
 
     /* Test CCM SRAM */
-    UpdateTestOperation("CCM SRAM Address Test");
-    errors = RunImprovedAddressTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    /* Run enhanced butterfly test on CCM SRAM */
-    UpdateTestOperation("CCM SRAM Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    /* Run basic checkerboard tests on CCM SRAM */
-    UpdateTestOperation("CCM SRAM Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0xAA55AA55,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
+    if (!ccmDeferred) {
+        regionStart = GET_CYCLE_COUNT();
+        UpdateTestOperation("CCM SRAM Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunImprovedAddressTest(
+            ccmTestStart,
+            ccmTestSize,
+            CCM_SRAM_SIZE));
+        ccmStatus.addressTestTotal++;
+        if (errors == 0) ccmStatus.addressTestSuccess++;
+        else ccmStatus.totalErrors += errors;
 
-    UpdateTestOperation("CCM SRAM Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0x55AA55AA,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
+        /* Run enhanced butterfly test on CCM SRAM */
+        UpdateTestOperation("CCM SRAM Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunEnhancedButterflyTest(
+            ccmTestStart,
+            ccmTestSize,
+            CCM_SRAM_SIZE));
+        ccmStatus.addressTestTotal++;
+        if (errors == 0) ccmStatus.addressTestSuccess++;
+        else ccmStatus.totalErrors += errors;
+
+        /* Run basic checkerboard tests on CCM SRAM */
+        UpdateTestOperation("CCM SRAM Checkerboard Test 0xAA55AA55");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunCheckerboardTestOrdered(
+            ccmTestStart,
+            ccmTestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &ccmStatus));
+        if (errors > 0) ccmStatus.totalErrors += errors;
+
+        /* The checkerboard above already covers the inverse pattern */
+        UpdateTestOperation("CCM SRAM Random Data Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunRandomDataTest(
+            ccmTestStart,
+            ccmTestSize,
+            GenerateRandomSeed(ccmTestStart),
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &ccmStatus));
+        if (errors > 0) ccmStatus.totalErrors += errors;
+
+        RecordRegionCost(REGION_CCM_SRAM, GET_CYCLE_COUNT() - regionStart, ccmTestSize);
+    }
+
+    /* Join the flash verifier */
+    UpdateTestOperation("Flash CRC Verify Join");
+    errors = JoinCrcVerifier();
+    if (errors > 0) flashStatus.totalErrors += errors;
 
     /* Test Flash Cache */
     UpdateTestOperation("Flash Cache Test");
@@ -327,22 +518,79 @@ void TestAllMemoryRegions(void)
 
     /* Run advanced tests on a schedule */
     if (testCycleCounter % testConfig.advancedTestInterval == 0) {
+        /* March and access width kernels step through the address orders */
+        uint32_t advancedOrder = (testCycleCounter / testConfig.advancedTestInterval) % NUM_ADDRESS_ORDERS;
+
         /* Run March C test on a portion of current SRAM1 test window */
-        UpdateTestOperation("SRAM1 March C Test");
-        uint32_t marchSize = testConfig.sram1TestSize / 8; /* Test 1/8th of the current window */
-        errors = RunMarchCTest(sram1TestStart, marchSize);
-        sram1Status.marchCTestTotal++;
-        if (errors == 0) sram1Status.marchCTestSuccess++;
-        else sram1Status.totalErrors += errors;
+        if (!sram1Deferred) {
+            UpdateTestOperation("SRAM1 March C Test");
+            uint32_t marchSize = sram1TestSize / 8; /* Test 1/8th of the current window */
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1),
+                                   RunMarchTestOrdered(&marchCAlgorithm, sram1TestStart, marchSize,
+                                                       0x00000000, advancedOrder));
+            sram1Status.marchCTestTotal++;
+            if (errors == 0) sram1Status.marchCTestSuccess++;
+            else sram1Status.totalErrors += errors;
+        }
 
         /* Run Walking Ones/Zeros on a portion of current SRAM2 test window */
-        UpdateTestOperation("SRAM2 Walking Test");
-        uint32_t walkingSize = testConfig.sram2TestSize / 8; /* Test 1/8th of the current window */
-        errors = RunWalkingOnesTest(sram2TestStart, walkingSize);
-        errors += RunWalkingZerosTest(sram2TestStart, walkingSize);
-        sram2Status.walkingTestTotal++;
-        if (errors == 0) sram2Status.walkingTestSuccess++;
-        else sram2Status.totalErrors += errors;
+        if (!sram2Deferred) {
+            UpdateTestOperation("SRAM2 Walking Test");
+            uint32_t walkingSize = sram2TestSize / 8; /* Test 1/8th of the current window */
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunWalkingOnesTest(sram2TestStart, walkingSize));
+            errors += WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunWalkingZerosTest(sram2TestStart, walkingSize));
+            sram2Status.walkingTestTotal++;
+            if (errors == 0) sram2Status.walkingTestSuccess++;
+            else sram2Status.totalErrors += errors;
+        }
+
+        /* Hammer the start of the SRAM1 window, alternating reads and writes */
+        if (!sram1Deferred) {
+            UpdateTestOperation("SRAM1 Hammer Test");
+            uint32_t hammerMode = (testCycleCounter / testConfig.advancedTestInterval) & 1 ?
+                                  HAMMER_MODE_WRITE : HAMMER_MODE_READ;
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1),
+                                   RunHammerTest(sram1TestStart, sram1TestSize, hammerMode,
+                                                 testConfig.hammerDurationMs));
+            if (errors > 0) sram1Status.totalErrors += errors;
+        }
+
+        /* Read-hammer the start of the Flash window */
+        UpdateTestOperation("Flash Hammer Test");
+        errors = RunHammerTest(flashTestStart, flashTestSize, HAMMER_MODE_READ, testConfig.hammerDurationMs);
+        if (errors > 0) flashStatus.totalErrors += errors;
+
+        /* Byte to doubleword accesses on 1/8th of each SRAM window */
+        if (!sram1Deferred) {
+            UpdateTestOperation("SRAM1 Access Width Test");
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1),
+                                   RunAccessWidthTests(sram1TestStart, sram1TestSize / 8, 0xAA55AA55, advancedOrder, &sram1Status));
+            if (errors > 0) sram1Status.totalErrors += errors;
+        }
+        if (!sram2Deferred) {
+            UpdateTestOperation("SRAM2 Access Width Test");
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2),
+                                   RunAccessWidthTests(sram2TestStart, sram2TestSize / 8, 0xAA55AA55, advancedOrder, &sram2Status));
+            if (errors > 0) sram2Status.totalErrors += errors;
+        }
+        if (!ccmDeferred) {
+            UpdateTestOperation("CCM SRAM Access Width Test");
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM),
+                                   RunAccessWidthTests(ccmTestStart, ccmTestSize / 8, 0xAA55AA55, advancedOrder, &ccmStatus));
+            if (errors > 0) ccmStatus.totalErrors += errors;
+        }
+
+        /* CCM and one SRAM window in the same loop, alternating the SRAM.
+           Errors are added to both regions' totals by the kernel. */
+        uint32_t dualSram2 = (testCycleCounter / testConfig.advancedTestInterval) & 1;
+        if (!ccmDeferred && !(dualSram2 ? sram2Deferred : sram1Deferred)) {
+            UpdateTestOperation(dualSram2 ? "CCM SRAM + SRAM2 Dual Test" : "CCM SRAM + SRAM1 Dual Test");
+            WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM) | GUARD_WINDOW(dualSram2 ? REGION_SRAM2 : REGION_SRAM1),
+                          RunDualRegionTest(ccmTestStart, ccmTestSize / 4,
+                                            dualSram2 ? sram2TestStart : sram1TestStart,
+                                            (dualSram2 ? sram2TestSize : sram1TestSize) / 4,
+                                            0xAA55AA55));
+        }
     }
 
     /* Refresh watchdog */
@@ -358,116 +606,149 @@ void TestSRAMOnly(void)
     uint32_t sram1TestStart = GetSRAM1TestStart();
     uint32_t sram2TestStart = GetSRAM2TestStart();
     uint32_t ccmTestStart = GetCCMTestStart();
+    uint32_t sram1TestSize = testConfig.sram1TestSize;
+    uint32_t sram2TestSize = testConfig.sram2TestSize;
+    uint32_t ccmTestSize = testConfig.ccmTestSize;
     uint32_t errors;
 
+    /* Windows that hold a retention pattern are tested around it this cycle */
+    uint32_t sram1Deferred = ClipWindowForRetention(REGION_SRAM1, &sram1TestStart, &sram1TestSize);
+    uint32_t sram2Deferred = ClipWindowForRetention(REGION_SRAM2, &sram2TestStart, &sram2TestSize);
+    uint32_t ccmDeferred = ClipWindowForRetention(REGION_CCM_SRAM, &ccmTestStart, &ccmTestSize);
+
+    /* Data bus, then address bus: a region that fails a tier sits the device
+       tests out with one diagnosis instead of an error from every test */
+    sram1Deferred = sram1Deferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1),
+        RunBusTiers(REGION_SRAM1, sram1TestStart, sram1TestSize)) != BUS_TIER_PASS;
+    sram2Deferred = sram2Deferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2),
+        RunBusTiers(REGION_SRAM2, sram2TestStart, sram2TestSize)) != BUS_TIER_PASS;
+    ccmDeferred = ccmDeferred || WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM),
+        RunBusTiers(REGION_CCM_SRAM, ccmTestStart, ccmTestSize)) != BUS_TIER_PASS;
+
     /* Test SRAM1 with basic patterns */
-    UpdateTestOperation("SRAM1 Address Test");
-    errors = RunImprovedAddressTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM1 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM1 Checkerboard Test");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0xAA55AA55,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
+    if (!sram1Deferred) {
+        UpdateTestOperation("SRAM1 Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunImprovedAddressTest(
+            sram1TestStart,
+            sram1TestSize,
+            SRAM1_SIZE));
+        sram1Status.addressTestTotal++;
+        if (errors == 0) sram1Status.addressTestSuccess++;
+        else sram1Status.totalErrors += errors;
+
+        UpdateTestOperation("SRAM1 Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunEnhancedButterflyTest(
+            sram1TestStart,
+            sram1TestSize,
+            SRAM1_SIZE));
+        sram1Status.addressTestTotal++;
+        if (errors == 0) sram1Status.addressTestSuccess++;
+        else sram1Status.totalErrors += errors;
+
+        UpdateTestOperation("SRAM1 Checkerboard Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunCheckerboardTestOrdered(
+            sram1TestStart,
+            sram1TestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram1Status));
+        if (errors > 0) sram1Status.totalErrors += errors;
+    }
 
     /* Test SRAM2 with basic patterns */
-    UpdateTestOperation("SRAM2 Address Test");
-    errors = RunImprovedAddressTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM2 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM2 Checkerboard Test");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0xAA55AA55,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
+    if (!sram2Deferred) {
+        UpdateTestOperation("SRAM2 Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunImprovedAddressTest(
+            sram2TestStart,
+            sram2TestSize,
+            SRAM2_SIZE));
+        sram2Status.addressTestTotal++;
+        if (errors == 0) sram2Status.addressTestSuccess++;
+        else sram2Status.totalErrors += errors;
+
+        UpdateTestOperation("SRAM2 Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunEnhancedButterflyTest(
+            sram2TestStart,
+            sram2TestSize,
+            SRAM2_SIZE));
+        sram2Status.addressTestTotal++;
+        if (errors == 0) sram2Status.addressTestSuccess++;
+        else sram2Status.totalErrors += errors;
+
+        UpdateTestOperation("SRAM2 Checkerboard Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunCheckerboardTestOrdered(
+            sram2TestStart,
+            sram2TestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &sram2Status));
+        if (errors > 0) sram2Status.totalErrors += errors;
+    }
 
     /* Test CCM SRAM with basic patterns */
-    UpdateTestOperation("CCM SRAM Address Test");
-    errors = RunImprovedAddressTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    UpdateTestOperation("CCM SRAM Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    UpdateTestOperation("CCM SRAM Checkerboard Test");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0xAA55AA55,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
+    if (!ccmDeferred) {
+        UpdateTestOperation("CCM SRAM Address Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunImprovedAddressTest(
+            ccmTestStart,
+            ccmTestSize,
+            CCM_SRAM_SIZE));
+        ccmStatus.addressTestTotal++;
+        if (errors == 0) ccmStatus.addressTestSuccess++;
+        else ccmStatus.totalErrors += errors;
+
+        UpdateTestOperation("CCM SRAM Butterfly Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunEnhancedButterflyTest(
+            ccmTestStart,
+            ccmTestSize,
+            CCM_SRAM_SIZE));
+        ccmStatus.addressTestTotal++;
+        if (errors == 0) ccmStatus.addressTestSuccess++;
+        else ccmStatus.totalErrors += errors;
+
+        UpdateTestOperation("CCM SRAM Checkerboard Test");
+        errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM), RunCheckerboardTestOrdered(
+            ccmTestStart,
+            ccmTestSize,
+            0xAA55AA55,
+            testCycleCounter % NUM_ADDRESS_ORDERS,
+            &ccmStatus));
+        if (errors > 0) ccmStatus.totalErrors += errors;
+    }
 
     /* Run advanced tests on a schedule */
     if (testCycleCounter % (testConfig.advancedTestInterval / 2) == 0) {
         /* In SRAM-only mode, run advanced tests more frequently */
 
         /* Run March C test on a larger portion of SRAM1 */
-        UpdateTestOperation("SRAM1 March C Test");
-        uint32_t marchSize = testConfig.sram1TestSize / 4; /* Test 1/4th of the current window */
-        errors = RunMarchCTest(sram1TestStart, marchSize);
-        sram1Status.marchCTestTotal++;
-        if (errors == 0) sram1Status.marchCTestSuccess++;
-        else sram1Status.totalErrors += errors;
+        if (!sram1Deferred) {
+            UpdateTestOperation("SRAM1 March C Test");
+            uint32_t marchSize = sram1TestSize / 4; /* Test 1/4th of the current window */
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM1), RunMarchCTest(sram1TestStart, marchSize));
+            sram1Status.marchCTestTotal++;
+            if (errors == 0) sram1Status.marchCTestSuccess++;
+            else sram1Status.totalErrors += errors;
+        }
 
         /* Run Walking Ones/Zeros on a larger portion of SRAM2 */
-        UpdateTestOperation("SRAM2 Walking Test");
-        uint32_t walkingSize = testConfig.sram2TestSize / 4; /* Test 1/4th of the current window */
-        errors = RunWalkingOnesTest(sram2TestStart, walkingSize);
-        errors += RunWalkingZerosTest(sram2TestStart, walkingSize);
-        sram2Status.walkingTestTotal++;
-        if (errors == 0) sram2Status.walkingTestSuccess++;
-        else sram2Status.totalErrors += errors;
+        if (!sram2Deferred) {
+            UpdateTestOperation("SRAM2 Walking Test");
+            uint32_t walkingSize = sram2TestSize / 4; /* Test 1/4th of the current window */
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunWalkingOnesTest(sram2TestStart, walkingSize));
+            errors += WINDOW_KERNEL(GUARD_WINDOW(REGION_SRAM2), RunWalkingZerosTest(sram2TestStart, walkingSize));
+            sram2Status.walkingTestTotal++;
+            if (errors == 0) sram2Status.walkingTestSuccess++;
+            else sram2Status.totalErrors += errors;
+        }
 
         /* Run Modified Checkerboard and Butterfly on CCM SRAM */
-        UpdateTestOperation("CCM SRAM Modified Checkerboard");
-        errors = RunModifiedCheckerboardTest(ccmTestStart, testConfig.ccmTestSize / 4);
-        ccmStatus.dataTestTotal++;
-        if (errors == 0) ccmStatus.dataTestSuccess++;
-        else ccmStatus.totalErrors += errors;
+        if (!ccmDeferred) {
+            UpdateTestOperation("CCM SRAM Modified Checkerboard");
+            errors = WINDOW_KERNEL(GUARD_WINDOW(REGION_CCM_SRAM),
+                                   RunModifiedCheckerboardTest(ccmTestStart, ccmTestSize / 4));
+            ccmStatus.dataTestTotal++;
+            if (errors == 0) ccmStatus.dataTestSuccess++;
+            else ccmStatus.totalErrors += errors;
+        }
     }
 
     /* Refresh watchdog */
@@ -0,0 +1,251 @@
+/**
+ * Memory Layout Discovery for STM32G473CB Memory Test
+ *
+ * Works out which parts of each SRAM region hold nothing the firmware
+ * needs, from the linker script's own symbols rather than fixed guesses:
+ * .data and .bss (_sdata to _ebss), the heap reserved for sbrk() (from
+ * _end, _Min_Heap_Size bytes), the MSP stack (_Min_Stack_Size below
+ * _estack), the framework state pages (.fwstate), the POST result block
+ * (.noinit) and the .ccmram code.
+ * What is left of a region, less a small margin beside anything in use,
+ * is free; the largest free range becomes the region's test bounds. A
+ * build with a bigger .bss or stack moves the bounds with it, and any
+ * memory the old fixed guards left untested is picked up. The stack
+ * reservation starts at _Min_Stack_Size and is resized at run time from
+ * the measured depth, which moves the bounds beside it.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Linker script symbols */
+extern uint32_t _sdata;
+extern uint32_t _ebss;
+extern uint8_t _end;
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+extern uint32_t _Min_Heap_Size;
+extern uint32_t _sfwstate;
+extern uint32_t _efwstate;
+extern uint32_t _snoinit;
+extern uint32_t _enoinit;
+extern uint32_t _sccmram;
+extern uint32_t _eccmram;
+
+/* Gap kept beside anything in use, and the alignment of free ranges */
+#define LAYOUT_MARGIN         32
+#define LAYOUT_ALIGN          32
+
+/* Sections in use */
+#define LAYOUT_MAX_SECTIONS   8
+
+typedef struct {
+    const char* name;
+    uint32_t start;
+    uint32_t end;                  /* Address just past the section */
+} LayoutSection;
+
+/* Function prototypes */
+void InitializeMemoryLayout(void);
+void SetStackReservation(uint32_t bytes);
+uint32_t GetRegionFreeRange(uint32_t region, uint32_t* startAddr, uint32_t* endAddr);
+void ReportMemoryLayout(void);
+
+static LayoutSection usedSections[LAYOUT_MAX_SECTIONS];
+static uint32_t numUsedSections = 0;
+static uint32_t stackSection = LAYOUT_MAX_SECTIONS;
+
+/* Largest free range per region, empty until discovered */
+static uint32_t freeStart[NUM_TEST_REGIONS];
+static uint32_t freeEnd[NUM_TEST_REGIONS];
+static uint32_t layoutOverlaps = 0;
+
+/**
+  * @brief  Add a section in use
+  * @param  name: Section name for the report
+  * @param  start: Section start
+  * @param  end: Address just past the section
+  */
+static void AddUsedSection(const char* name, uint32_t start, uint32_t end)
+{
+    if (end <= start || numUsedSections >= LAYOUT_MAX_SECTIONS) return;
+
+    usedSections[numUsedSections].name = name;
+    usedSections[numUsedSections].start = start;
+    usedSections[numUsedSections].end = end;
+    numUsedSections++;
+}
+
+/**
+  * @brief  Find the largest range of a region that no section uses
+  * @param  regionStart: Region start
+  * @param  regionEnd: Address just past the region
+  * @param  startAddr: Receives the range start
+  * @param  endAddr: Receives the address just past the range
+  */
+static void FindLargestFreeRange(uint32_t regionStart, uint32_t regionEnd,
+                                 uint32_t* startAddr, uint32_t* endAddr)
+{
+    uint32_t bestStart = 0, bestEnd = 0;
+    uint32_t cursor = regionStart;
+
+    /* Walk the sections in address order; there are only a handful */
+    for (;;) {
+        uint32_t nextStart = regionEnd;
+        uint32_t nextEnd = regionEnd;
+
+        for (uint32_t i = 0; i < numUsedSections; i++) {
+            LayoutSection* section = &usedSections[i];
+            if (section->end <= cursor || section->start >= regionEnd) continue;
+            if (section->start < nextStart) {
+                nextStart = section->start;
+                nextEnd = section->end;
+            }
+        }
+
+        /* Free gap up to the next section, kept clear of both neighbours */
+        uint32_t gapStart = (cursor == regionStart) ? cursor : cursor + LAYOUT_MARGIN;
+        uint32_t gapEnd = (nextStart == regionEnd) ? regionEnd : nextStart - LAYOUT_MARGIN;
+        gapStart = (gapStart + LAYOUT_ALIGN - 1) & ~(LAYOUT_ALIGN - 1);
+        gapEnd &= ~(LAYOUT_ALIGN - 1);
+
+        if (nextStart > cursor && gapEnd > gapStart && gapEnd - gapStart > bestEnd - bestStart) {
+            bestStart = gapStart;
+            bestEnd = gapEnd;
+        }
+
+        if (nextStart >= regionEnd) break;
+        if (nextEnd > cursor) cursor = nextEnd;
+        if (cursor >= regionEnd) break;
+    }
+
+    *startAddr = bestStart;
+    *endAddr = bestEnd;
+}
+
+/**
+  * @brief  Work out each SRAM region's free range from the sections in use
+  */
+static void UpdateFreeRanges(void)
+{
+    static const uint32_t regionBase[NUM_TEST_REGIONS] = {
+        FLASH_START_ADDR, SRAM1_START_ADDR, SRAM2_START_ADDR, CCM_SRAM_START_ADDR
+    };
+    static const uint32_t regionSize[NUM_TEST_REGIONS] = {
+        FLASH_SIZE, SRAM1_SIZE, SRAM2_SIZE, CCM_SRAM_SIZE
+    };
+
+    /* Overlapping sections mean the linker script and this code disagree */
+    layoutOverlaps = 0;
+    for (uint32_t i = 0; i < numUsedSections; i++) {
+        for (uint32_t j = i + 1; j < numUsedSections; j++) {
+            if (usedSections[i].start < usedSections[j].end && usedSections[j].start < usedSections[i].end) {
+                layoutOverlaps++;
+            }
+        }
+    }
+
+    /* Flash is only read by the tests; its bounds stay fixed */
+    freeStart[REGION_FLASH] = 0;
+    freeEnd[REGION_FLASH] = 0;
+    for (uint32_t region = REGION_SRAM1; region < NUM_TEST_REGIONS; region++) {
+        FindLargestFreeRange(regionBase[region], regionBase[region] + regionSize[region],
+                             &freeStart[region], &freeEnd[region]);
+    }
+}
+
+/**
+  * @brief  Read the linker symbols and work out each region's free range
+  * @note   Run before InitializeDefaultConfig(), which fits the windows to it
+  */
+void InitializeMemoryLayout(void)
+{
+    uint32_t stackTop = (uint32_t)&_estack;
+    uint32_t heapStart = (uint32_t)&_end;
+
+    numUsedSections = 0;
+    AddUsedSection(".data/.bss", (uint32_t)&_sdata, (uint32_t)&_ebss);
+    AddUsedSection("heap", heapStart, heapStart + (uint32_t)&_Min_Heap_Size);
+    stackSection = numUsedSections;
+    AddUsedSection("stack", stackTop - (uint32_t)&_Min_Stack_Size, stackTop);
+    AddUsedSection(".fwstate", (uint32_t)&_sfwstate, (uint32_t)&_efwstate);
+    AddUsedSection(".noinit", (uint32_t)&_snoinit, (uint32_t)&_enoinit);
+    AddUsedSection(".ccmram", (uint32_t)&_sccmram, (uint32_t)&_eccmram);
+
+    UpdateFreeRanges();
+}
+
+/**
+  * @brief  Change the bytes reserved below _estack for the MSP stack
+  * @param  bytes: New reservation
+  * @note   The bounds beside the stack move on the next call to
+  *         GetRegionTestBounds(); windows are refitted at the next rotation.
+  */
+void SetStackReservation(uint32_t bytes)
+{
+    if (stackSection >= numUsedSections) return;
+
+    LayoutSection* stack = &usedSections[stackSection];
+    stack->start = stack->end - bytes;
+
+    UpdateFreeRanges();
+}
+
+/**
+  * @brief  Get the largest free range found in a region
+  * @param  region: Region identifier
+  * @param  startAddr: Receives the range start
+  * @param  endAddr: Receives the address just past the range
+  * @retval 1 if a free range is known for the region
+  */
+uint32_t GetRegionFreeRange(uint32_t region, uint32_t* startAddr, uint32_t* endAddr)
+{
+    if (region >= NUM_TEST_REGIONS || freeEnd[region] <= freeStart[region]) return 0;
+
+    *startAddr = freeStart[region];
+    *endAddr = freeEnd[region];
+    return 1;
+}
+
+/**
+  * @brief  Report the sections in use and the free range of each region
+  */
+void ReportMemoryLayout(void)
+{
+    char buffer[256];
+    int length = snprintf(buffer, sizeof(buffer), "Layout:");
+
+    for (uint32_t i = 0; i < numUsedSections && length < (int)sizeof(buffer); i++) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %s=0x%08lX-0x%08lX",
+                           usedSections[i].name, usedSections[i].start, usedSections[i].end);
+    }
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    length = snprintf(buffer, sizeof(buffer), "Free:");
+    for (uint32_t region = REGION_SRAM1; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        if (freeEnd[region] <= freeStart[region]) {
+            length += snprintf(buffer + length, sizeof(buffer) - length, " %s=none", GetRegionName(region));
+            continue;
+        }
+        length += snprintf(buffer + length, sizeof(buffer) - length, " %s=0x%08lX-0x%08lX (%luKB)",
+                           GetRegionName(region), freeStart[region], freeEnd[region],
+                           (freeEnd[region] - freeStart[region]) / 1024);
+    }
+    if (layoutOverlaps > 0 && length < (int)sizeof(buffer)) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, " WARNING: %lu overlapping sections",
+                           layoutOverlaps);
+    }
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
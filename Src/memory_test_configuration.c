@@ -21,6 +21,15 @@
 #define CCM_SRAM_START_ADDR    0x10000000
 #define CCM_SRAM_SIZE          0x8000     /* 32KB */
 
+/* Areas at each end of a region that tests must not touch (stack, variables) */
+#define FLASH_GUARD_HIGH       0x1000     /* 4KB below the reserved log pages */
+#define SRAM1_GUARD_LOW        0x1000     /* 4KB for stack/variables */
+#define SRAM1_GUARD_HIGH       0x1000
+#define SRAM2_GUARD_LOW        0x400      /* 1KB safety margins */
+#define SRAM2_GUARD_HIGH       (0x400 + STATE_SIZE)  /* Margin plus the framework state pages */
+#define CCM_GUARD_LOW          CCM_CODE_RESERVED  /* .ccmram code */
+#define CCM_GUARD_HIGH         0x400
+
 /* Configurable test parameters - default values */
 typedef struct {
     /* Test region sizes (in bytes) */
@@ -46,6 +55,33 @@ typedef struct {
     /* Cycle settings */
     uint8_t rotateStartingOffsets; /* If true, rotate starting offsets on each cycle */
     uint8_t rotateTestSizes;       /* If true, vary test coverage size on each cycle */
+
+    /* Persistent log settings */
+    uint32_t logFlushBudgetUs;     /* Max time per cycle spent programming the log */
+    uint32_t logCycleInterval;     /* Log a clean cycle summary every N cycles */
+
+    /* Adaptive escalation settings */
+    uint32_t escalationCycles;     /* Cycles of intensive testing after a block fails */
+    uint32_t decayCycles;          /* Clean cycles per step down in sampling rate */
+
+    /* Retention test settings */
+    uint32_t retentionDelayMs;     /* Time a retention window holds its pattern */
+    uint32_t retentionWindowSize;  /* Bytes per background retention window */
+    uint32_t retentionWindows;     /* Background windows kept in flight */
+
+    /* Hammer test settings */
+    uint32_t hammerDurationMs;     /* Time spent hammering each target */
+    uint32_t hammerAggressorStride; /* Bytes between the two aggressors */
+
+    /* DMA stress settings */
+    uint32_t dmaStressDutyPercent; /* Share of each period the DMA streams run */
+    uint32_t dmaStressControlInterval; /* Every Nth stress cycle runs without DMA */
+
+    /* Relocated-stack March settings */
+    uint32_t relocatedMarchInterval; /* Whole-region March every N cycles, 0 = never */
+    uint32_t burnInSummaryMinutes;  /* Burn-in summary and checkpoint every N minutes, 0 = never */
+    uint32_t burnInHeartbeatSeconds; /* Burn-in heartbeat every N seconds, 0 = never */
+    uint32_t scriptInterval;       /* Run the uploaded test script every N cycles, 0 = never */
 } MemoryTestConfig;
 
 /* Global configuration */
@@ -59,6 +95,10 @@ uint32_t GetSRAM1TestStart(void);
 uint32_t GetSRAM2TestStart(void);
 uint32_t GetCCMTestStart(void);
 void RotateTestParameters(void);
+void GetRegionTestBounds(uint32_t region, uint32_t* startAddr, uint32_t* endAddr);
+void GetRegionTestWindow(uint32_t region, uint32_t* startAddr, uint32_t* size);
+static void FitTestWindows(void);
+static void StepTestWindow(uint32_t region, uint32_t regionStart, uint32_t* offset, uint32_t size, uint32_t step);
 
 /**
  * @brief Initialize configuration with default values
@@ -71,7 +111,7 @@ void InitializeDefaultConfig(void)
     testConfig.sram2TestSize = 0x2000;     /* 8KB */
     testConfig.ccmTestSize = 0x2000;       /* 8KB */
 
-    /* Start with offsets that leave room for stack/variables */
+    /* Starting offsets, moved into the free memory found at boot */
     testConfig.flashTestOffset = 0x20000;  /* Start 128KB into flash */
     testConfig.sram1TestOffset = 0x2000;   /* Start 8KB into SRAM1 */
     testConfig.sram2TestOffset = 0x400;    /* Start 1KB into SRAM2 */
@@ -88,6 +128,40 @@ void InitializeDefaultConfig(void)
     /* Dynamic adjustment settings */
     testConfig.rotateStartingOffsets = 1;  /* Enabled by default */
     testConfig.rotateTestSizes = 1;        /* Enabled by default */
+
+    /* Persistent log settings */
+    testConfig.logFlushBudgetUs = 2000;    /* At most 2ms of flash programming per cycle */
+    testConfig.logCycleInterval = 100;     /* Heartbeat summary every 100 clean cycles */
+
+    /* Adaptive escalation settings */
+    testConfig.escalationCycles = 16;      /* Characterize a new fault for 16 cycles */
+    testConfig.decayCycles = 10;           /* Halve a clean region's sampling every 10 cycles */
+
+    /* Retention test settings */
+    testConfig.retentionDelayMs = 2000;    /* 2 second hold */
+    testConfig.retentionWindowSize = 0x400; /* 1KB windows */
+    testConfig.retentionWindows = 4;       /* Four background windows in flight */
+
+    /* Hammer test settings */
+    testConfig.hammerDurationMs = 20;      /* 20ms per target */
+    testConfig.hammerAggressorStride = 0x400; /* 1KB of victims between aggressors */
+
+    /* DMA stress settings */
+    testConfig.dmaStressDutyPercent = 50;  /* DMA streams busy half of each period */
+    testConfig.dmaStressControlInterval = 4; /* Every 4th stress cycle is a quiet control */
+
+    /* Relocated-stack March settings */
+    testConfig.relocatedMarchInterval = 50; /* SRAM1 and CCM in turn, every 50 cycles */
+
+    /* Burn-in settings */
+    testConfig.burnInSummaryMinutes = 15;  /* Summary and checkpoint every 15 minutes */
+    testConfig.burnInHeartbeatSeconds = 60; /* One heartbeat line a minute */
+
+    /* Test script settings */
+    testConfig.scriptInterval = 10;        /* Uploaded script every 10 cycles */
+
+    /* Move the starting windows inside the discovered free memory */
+    FitTestWindows();
 }
 
 /**
@@ -136,24 +210,11 @@ void RotateTestParameters(uint32_t cycleCounter)
     if (testConfig.rotateStartingOffsets) {
         /* Rotate starting offsets to ensure different memory areas are tested */
 
-        /* Flash rotation (ensure we stay within valid bounds) */
-        uint32_t maxFlashOffset = FLASH_SIZE - testConfig.flashTestSize - 0x1000; /* Keep 4KB safety margin */
-        testConfig.flashTestOffset = (testConfig.flashTestOffset + 0x10000) % maxFlashOffset;
-
-        /* SRAM1 rotation */
-        uint32_t maxSram1Offset = SRAM1_SIZE - testConfig.sram1TestSize - 0x1000; /* Keep 4KB safety margin */
-        testConfig.sram1TestOffset = (testConfig.sram1TestOffset + 0x4000) % maxSram1Offset;
-        if (testConfig.sram1TestOffset < 0x1000) testConfig.sram1TestOffset = 0x1000; /* Keep 4KB for stack */
-
-        /* SRAM2 rotation */
-        uint32_t maxSram2Offset = SRAM2_SIZE - testConfig.sram2TestSize - 0x400; /* Keep 1KB safety margin */
-        testConfig.sram2TestOffset = (testConfig.sram2TestOffset + 0x1000) % maxSram2Offset;
-        if (testConfig.sram2TestOffset < 0x400) testConfig.sram2TestOffset = 0x400; /* Keep 1KB safety margin */
-
-        /* CCM SRAM rotation */
-        uint32_t maxCcmOffset = CCM_SRAM_SIZE - testConfig.ccmTestSize - 0x400; /* Keep 1KB safety margin */
-        testConfig.ccmTestOffset = (testConfig.ccmTestOffset + 0x1000) % maxCcmOffset;
-        if (testConfig.ccmTestOffset < 0x400) testConfig.ccmTestOffset = 0x400; /* Keep 1KB safety margin */
+        /* Each window walks its region's test bounds, ending flush with the top */
+        StepTestWindow(REGION_FLASH, FLASH_START_ADDR, &testConfig.flashTestOffset, testConfig.flashTestSize, 0x10000);
+        StepTestWindow(REGION_SRAM1, SRAM1_START_ADDR, &testConfig.sram1TestOffset, testConfig.sram1TestSize, 0x4000);
+        StepTestWindow(REGION_SRAM2, SRAM2_START_ADDR, &testConfig.sram2TestOffset, testConfig.sram2TestSize, 0x1000);
+        StepTestWindow(REGION_CCM_SRAM, CCM_SRAM_START_ADDR, &testConfig.ccmTestOffset, testConfig.ccmTestSize, 0x1000);
     }
 
     /* Vary test sizes every 5 cycles if enabled */
@@ -182,9 +243,138 @@ void RotateTestParameters(uint32_t cycleCounter)
                 break;
         }
     }
+
+    /* Sizes and offsets must stay inside the bounds */
+    FitTestWindows();
+}
+
+/**
+ * @brief Get the address range tests may use within a region
+ * @param region Region identifier
+ * @param startAddr Receives the first testable address
+ * @param endAddr Receives the address just past the last testable byte
+ * @note SRAM bounds come from the linker layout when it is known; the
+ *       fixed guards are the fallback.
+ */
+void GetRegionTestBounds(uint32_t region, uint32_t* startAddr, uint32_t* endAddr)
+{
+    if (region != REGION_FLASH && GetRegionFreeRange(region, startAddr, endAddr)) return;
+
+    switch (region) {
+        case REGION_FLASH:
+            *startAddr = FLASH_START_ADDR;
+            *endAddr = FLASH_START_ADDR + FLASH_SIZE - FLASH_RESERVED_SIZE - FLASH_GUARD_HIGH;
+            break;
+
+        case REGION_SRAM1:
+            *startAddr = SRAM1_START_ADDR + SRAM1_GUARD_LOW;
+            *endAddr = SRAM1_START_ADDR + SRAM1_SIZE - SRAM1_GUARD_HIGH;
+            break;
+
+        case REGION_SRAM2:
+            *startAddr = SRAM2_START_ADDR + SRAM2_GUARD_LOW;
+            *endAddr = SRAM2_START_ADDR + SRAM2_SIZE - SRAM2_GUARD_HIGH;
+            break;
+
+        case REGION_CCM_SRAM:
+        default:
+            *startAddr = CCM_SRAM_START_ADDR + CCM_GUARD_LOW;
+            *endAddr = CCM_SRAM_START_ADDR + CCM_SRAM_SIZE - CCM_GUARD_HIGH;
+            break;
+    }
+}
+
+/**
+ * @brief Shrink a window to its region's test bounds and move it inside them
+ * @param region Region identifier
+ * @param regionStart Region start address, the base of the offset
+ * @param offset Window offset, updated
+ * @param size Window size, updated
+ */
+static void FitTestWindow(uint32_t region, uint32_t regionStart, uint32_t* offset, uint32_t* size)
+{
+    uint32_t boundsStart, boundsEnd;
+    GetRegionTestBounds(region, &boundsStart, &boundsEnd);
+
+    if (*size > boundsEnd - boundsStart) *size = (boundsEnd - boundsStart) & ~0x3U;
+
+    uint32_t minOffset = boundsStart - regionStart;
+    uint32_t maxOffset = boundsEnd - regionStart - *size;
+    if (*offset < minOffset) *offset = minOffset;
+    if (*offset > maxOffset) *offset = maxOffset;
+}
+
+/**
+ * @brief Fit every region's window to its test bounds
+ */
+static void FitTestWindows(void)
+{
+    FitTestWindow(REGION_FLASH, FLASH_START_ADDR, &testConfig.flashTestOffset, &testConfig.flashTestSize);
+    FitTestWindow(REGION_SRAM1, SRAM1_START_ADDR, &testConfig.sram1TestOffset, &testConfig.sram1TestSize);
+    FitTestWindow(REGION_SRAM2, SRAM2_START_ADDR, &testConfig.sram2TestOffset, &testConfig.sram2TestSize);
+    FitTestWindow(REGION_CCM_SRAM, CCM_SRAM_START_ADDR, &testConfig.ccmTestOffset, &testConfig.ccmTestSize);
+}
+
+/**
+ * @brief Advance a window's offset through its region's test bounds
+ * @param region Region identifier
+ * @param regionStart Region start address, the base of the offset
+ * @param offset Window offset, updated
+ * @param size Window size
+ * @param step Offset increment
+ * @note The last step lands exactly at the top of the bounds before
+ *       wrapping, so no part of the bounds is skipped.
+ */
+static void StepTestWindow(uint32_t region, uint32_t regionStart, uint32_t* offset, uint32_t size, uint32_t step)
+{
+    uint32_t boundsStart, boundsEnd;
+    GetRegionTestBounds(region, &boundsStart, &boundsEnd);
+
+    uint32_t minOffset = boundsStart - regionStart;
+    if (size > boundsEnd - boundsStart) {
+        *offset = minOffset;
+        return;
+    }
+    uint32_t maxOffset = boundsEnd - regionStart - size;
+
+    if (*offset < minOffset || *offset >= maxOffset) *offset = minOffset;
+    else if (*offset + step > maxOffset) *offset = maxOffset;
+    else *offset += step;
+}
+
+/**
+ * @brief Get the window the main tests cover in a region this cycle
+ * @param region Region identifier
+ * @param startAddr Receives the window start address
+ * @param size Receives the configured window size
+ */
+void GetRegionTestWindow(uint32_t region, uint32_t* startAddr, uint32_t* size)
+{
+    switch (region) {
+        case REGION_FLASH:
+            *startAddr = GetFlashTestStart();
+            *size = testConfig.flashTestSize;
+            break;
+
+        case REGION_SRAM1:
+            *startAddr = GetSRAM1TestStart();
+            *size = testConfig.sram1TestSize;
+            break;
+
+        case REGION_SRAM2:
+            *startAddr = GetSRAM2TestStart();
+            *size = testConfig.sram2TestSize;
+            break;
+
+        case REGION_CCM_SRAM:
+        default:
+            *startAddr = GetCCMTestStart();
+            *size = testConfig.ccmTestSize;
+            break;
+    }
 }
 
 /* Global configuration instance */
-MemoryTestConfig testConfig;
+FRAMEWORK_STATE MemoryTestConfig testConfig;
 
 #endif /* MEMORY_TEST_CONFIG_H */
@@ -16,12 +16,316 @@ extern UART_HandleTypeDef huart2;
 extern void SaveTestState(uint32_t operationCode, uint32_t errorCode);
 extern volatile uint32_t testCycleCounter;
 
+/* .ccmram load and run addresses, from the linker script */
+extern uint32_t _siccmram;
+extern uint32_t _sccmram;
+extern uint32_t _eccmram;
+
 /* Standard test patterns */
 #define PATTERN_CHECKERBOARD_1 0xAA55AA55
 #define PATTERN_CHECKERBOARD_2 0x55AA55AA
 
+/* Kernel names, indexed by kernel identifier */
+static const char* const kernelNames[NUM_KERNELS] = {
+    "Checkerboard", "Byte", "Halfword", "Word", "Doubleword",
+    "Halfword (unaligned)", "Word (unaligned)", "Random",
+    "March (up)", "March (down)", "March (Gray)", "March (LFSR)",
+    "Dual (interleaved)", "Dual (sequential)", "March (relocated)", "Script"
+};
+
+/* Throughput of each kernel */
+FRAMEWORK_STATE static KernelStats kernelStats[NUM_KERNELS];
+
+/* Set once the .ccmram code has been copied */
+static uint32_t ccmCodeReady = 0;
+
+/* Most recent error record */
+FRAMEWORK_STATE MemoryErrorRecord lastErrorRecord;
+
+/* Region names, indexed by region identifier */
+static const char* const regionNames[NUM_TEST_REGIONS] = {
+    "Flash", "SRAM1", "SRAM2", "CCM SRAM"
+};
+
+/**
+  * @brief  Report, log and quarantine an error once it has been classified
+  * @param  testName: Name of the test that detected the error
+  * @param  address: Failing address
+  * @param  readValue: Value read back
+  * @param  expectedValue: Value that should have been read
+  * @param  faultClass: Result of the re-check
+  * @note   Called with the framework state unlocked
+  */
+static void RecordClassifiedError(const char* testName, uint32_t address, uint32_t readValue,
+                                  uint32_t expectedValue, uint32_t faultClass)
+{
+    lastErrorRecord.cycle = testCycleCounter;
+    lastErrorRecord.address = address;
+    lastErrorRecord.readValue = readValue;
+    lastErrorRecord.expectedValue = expectedValue;
+    lastErrorRecord.region = (uint8_t)GetRegionForAddress(address);
+    lastErrorRecord.faultClass = (uint8_t)faultClass;
+    SampleEnvironment(&lastErrorRecord.environment);
+
+    /* Report the error - burn-in only counts it */
+    if (!IsBurnInActive()) {
+        char buffer[180];
+        snprintf(buffer, sizeof(buffer),
+                 "%s Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX, class=%s, T=%dC, VDDA=%umV\r\n",
+                 testName, address, readValue, expectedValue,
+                 GetFaultClassName(lastErrorRecord.faultClass),
+                 lastErrorRecord.environment.temperatureC,
+                 lastErrorRecord.environment.vddaMv);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+
+    /* Keep a copy that survives a disconnected UART or a reset */
+    LogErrorRecord(&lastErrorRecord);
+
+    /* An upset says nothing about the cell - only keep reproducible faults off limits */
+    if (lastErrorRecord.faultClass != FAULT_TRANSIENT) {
+        /* Stop later cycles from re-reporting this word */
+        QuarantineAddress(address);
+
+        /* Focus the next few cycles on this block and its neighbours,
+           unless it is the block already being characterized */
+        if (!IsQuarantineExempt(address)) NotifyBlockFailure(address);
+    }
+}
+
+/**
+  * @brief  Record a memory error tagged with cycle, region and environment
+  * @param  testName: Name of the test that detected the error
+  * @param  address: Failing address
+  * @param  readValue: Value read back
+  * @param  expectedValue: Value that should have been read
+  * @retval 1 if the error counts, 0 if the address is already quarantined
+  */
+uint32_t RecordMemoryError(const char* testName, uint32_t address, uint32_t readValue, uint32_t expectedValue)
+{
+    /* Known-bad words were reported when they were first found */
+    if (IsAddressQuarantined(address)) return 0;
+
+    /* Called from inside kernels, where the state pages are read-only */
+    UnlockFrameworkState();
+
+    /* Re-check the word before the test moves on */
+    RecordClassifiedError(testName, address, readValue, expectedValue,
+                          ClassifyMemoryError(address, readValue, expectedValue));
+
+    CommitFrameworkState();
+
+    return 1;
+}
+
+/**
+  * @brief  Record a memory error whose word was re-checked where it was found
+  * @param  testName: Name of the test that detected the error
+  * @param  address: Failing address
+  * @param  readValue: Value read back
+  * @param  expectedValue: Value that should have been read
+  * @param  failures: Re-checks that read back wrong
+  * @param  trials: Re-checks made
+  * @retval 1 if the error counts, 0 if the address is already quarantined
+  * @note   For words that no longer hold the test background, such as those
+  *         the relocated March has put back; the word is not touched here.
+  */
+uint32_t RecordRecheckedMemoryError(const char* testName, uint32_t address, uint32_t readValue,
+                                    uint32_t expectedValue, uint32_t failures, uint32_t trials)
+{
+    if (IsAddressQuarantined(address)) return 0;
+
+    UnlockFrameworkState();
+
+    RecordClassifiedError(testName, address, readValue, expectedValue,
+                          CountFaultClass(address, failures, trials));
+
+    CommitFrameworkState();
+
+    return 1;
+}
+
+/**
+  * @brief  Find the memory region containing an address
+  * @param  address: Address to look up
+  * @retval Region identifier, or REGION_NONE if outside all test regions
+  */
+uint32_t GetRegionForAddress(uint32_t address)
+{
+    if (address >= FLASH_START_ADDR && address < FLASH_START_ADDR + FLASH_SIZE) return REGION_FLASH;
+    if (address >= SRAM1_START_ADDR && address < SRAM1_START_ADDR + SRAM1_SIZE) return REGION_SRAM1;
+    if (address >= SRAM2_START_ADDR && address < SRAM2_START_ADDR + SRAM2_SIZE) return REGION_SRAM2;
+    if (address >= CCM_SRAM_START_ADDR && address < CCM_SRAM_START_ADDR + CCM_SRAM_SIZE) return REGION_CCM_SRAM;
+    return REGION_NONE;
+}
+
+/**
+  * @brief  Get the status structure for a region
+  * @param  region: Region identifier
+  * @retval Pointer to the region status structure
+  */
+MemoryTestStatus* GetRegionStatus(uint32_t region)
+{
+    switch (region) {
+        case REGION_FLASH:    return &flashStatus;
+        case REGION_SRAM1:    return &sram1Status;
+        case REGION_SRAM2:    return &sram2Status;
+        case REGION_CCM_SRAM:
+        default:              return &ccmStatus;
+    }
+}
+
+/**
+  * @brief  Get the printable name of a region
+  * @param  region: Region identifier
+  * @retval Region name
+  */
+const char* GetRegionName(uint32_t region)
+{
+    return (region < NUM_TEST_REGIONS) ? regionNames[region] : "Unknown";
+}
+
 /**
-  * @brief  Run checkerboard test on memory region
+  * @brief  Copy the .ccmram code from flash into CCM SRAM
+  * @retval 1 if the code is in place, 0 if it doesn't fit the reserved area
+  * @note   Must run before any CCM_RAMFUNC is called
+  */
+uint32_t InitializeCCMCode(void)
+{
+    uint32_t codeSize = (uint32_t)&_eccmram - (uint32_t)&_sccmram;
+
+    /* CCM tests start right after the reserved area */
+    if ((uint32_t)&_sccmram != CCM_SRAM_START_ADDR || codeSize > CCM_CODE_RESERVED) {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer),
+                 "CCM Code Error: %lu bytes at 0x%08lX don't fit the reserved area\r\n",
+                 codeSize, (uint32_t)&_sccmram);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return 0;
+    }
+
+    uint32_t* src = &_siccmram;
+    uint32_t* dst = &_sccmram;
+    while (dst < &_eccmram) {
+        *dst++ = *src++;
+    }
+
+    /* Make sure the copy is complete before fetching from it */
+    __DSB();
+    __ISB();
+
+    ccmCodeReady = 1;
+    return 1;
+}
+
+/**
+  * @brief  Check whether CCM_RAMFUNC kernels can be called
+  * @retval 1 if InitializeCCMCode() succeeded
+  */
+uint32_t IsCCMCodeReady(void)
+{
+    return ccmCodeReady;
+}
+
+/**
+  * @brief  Add one kernel run to the throughput accounting
+  * @param  kernel: Kernel identifier
+  * @param  bytes: Bytes read plus bytes written
+  * @param  cycles: CPU cycles the run took
+  * @note   A run is counted as quiet or contended only if the DMA gate
+  *         stayed closed or open for all of it; runs that straddle a gate
+  *         edge count towards the totals alone.
+  */
+void RecordKernelRun(uint32_t kernel, uint32_t bytes, uint32_t cycles)
+{
+    if (kernel >= NUM_KERNELS) return;
+
+    uint32_t endTick = HAL_GetTick();
+    uint32_t startTick = endTick - cycles / (SystemCoreClock / 1000U);
+    uint32_t gate = GetDmaGateState(startTick, endTick);
+
+    UnlockFrameworkState();
+
+    kernelStats[kernel].runs++;
+    kernelStats[kernel].bytes += bytes;
+    kernelStats[kernel].cycles += cycles;
+
+    if (gate == DMA_GATE_OPEN) {
+        kernelStats[kernel].contendedBytes += bytes;
+        kernelStats[kernel].contendedCycles += cycles;
+    }
+    else if (gate == DMA_GATE_CLOSED) {
+        kernelStats[kernel].quietBytes += bytes;
+        kernelStats[kernel].quietCycles += cycles;
+    }
+
+    CommitFrameworkState();
+}
+
+/**
+  * @brief  Get the bytes moved by all kernels since boot
+  * @retval Bytes read plus bytes written
+  */
+uint64_t GetKernelBytes(void)
+{
+    uint64_t bytes = 0;
+
+    for (uint32_t kernel = 0; kernel < NUM_KERNELS; kernel++) {
+        bytes += kernelStats[kernel].bytes;
+    }
+    return bytes;
+}
+
+/**
+  * @brief  Convert a byte count and the cycles it took to MB/s
+  * @param  bytes: Bytes moved
+  * @param  cycles: CPU cycles taken
+  * @retval Throughput in MB/s (10^6 bytes)
+  * @note   Bytes per microsecond is MB/s, so the cycles are scaled down
+  *         first and nothing is multiplied by the core clock.
+  */
+static uint32_t GetThroughputMBps(uint64_t bytes, uint64_t cycles)
+{
+    uint64_t us = CYCLES_TO_US(cycles);
+    return us ? (uint32_t)(bytes / us) : 0;
+}
+
+/**
+  * @brief  Report runs, volume and throughput of each kernel that has run
+  * @note   Kernels that also ran under DMA stress get their quiet and
+  *         contended throughput and the slowdown between them
+  */
+void ReportKernelStatus(void)
+{
+    char buffer[160];
+
+    for (uint32_t kernel = 0; kernel < NUM_KERNELS; kernel++) {
+        KernelStats* stats = &kernelStats[kernel];
+        if (stats->runs == 0 || stats->cycles == 0) continue;
+
+        int length = snprintf(buffer, sizeof(buffer),
+                              "Kernel %s: runs=%lu, %lu MB moved, %lu MB/s",
+                              kernelNames[kernel], stats->runs,
+                              (uint32_t)(stats->bytes / 1000000U),
+                              GetThroughputMBps(stats->bytes, stats->cycles));
+
+        if (stats->contendedCycles > 0 && stats->quietCycles > 0 && length < (int)sizeof(buffer)) {
+            uint32_t quietRate = GetThroughputMBps(stats->quietBytes, stats->quietCycles);
+            uint32_t contendedRate = GetThroughputMBps(stats->contendedBytes, stats->contendedCycles);
+            int32_t slowdown = quietRate ? 100 - (int32_t)((uint64_t)contendedRate * 100 / quietRate) : 0;
+            length += snprintf(buffer + length, sizeof(buffer) - length,
+                               " (quiet %lu, under DMA %lu, %ld%% slower)",
+                               quietRate, contendedRate, slowdown);
+        }
+        if (length < (int)sizeof(buffer) - 2) {
+            strcpy(buffer + length, "\r\n");
+        }
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+}
+
+/**
+  * @brief  Run checkerboard test on memory region in ascending order
   * @param  startAddr: Start address of memory region to test
   * @param  size: Size of memory region to test
   * @param  pattern: Checkerboard pattern to use
@@ -29,33 +333,51 @@ extern volatile uint32_t testCycleCounter;
   * @retval Number of errors detected
   */
 uint32_t RunCheckerboardTest(uint32_t startAddr, uint32_t size, uint32_t pattern, MemoryTestStatus* status)
+{
+    return RunCheckerboardTestOrdered(startAddr, size, pattern, ADDRESS_ORDER_UP, status);
+}
+
+/**
+  * @brief  Run checkerboard test on memory region in a given address order
+  * @param  startAddr: Start address of memory region to test
+  * @param  size: Size of memory region to test
+  * @param  pattern: Checkerboard pattern to use
+  * @param  addressOrder: ADDRESS_ORDER_x followed by the read phases
+  * @param  status: Pointer to status structure to update
+  * @retval Number of errors detected
+  * @note   Every word is written with the same value, so the fills stay
+  *         linear bursts; only the read phases follow the order.
+  */
+uint32_t RunCheckerboardTestOrdered(uint32_t startAddr, uint32_t size, uint32_t pattern,
+                                    uint32_t addressOrder, MemoryTestStatus* status)
 {
     uint32_t errors = 0;
     uint32_t* addr;
+    uint32_t numWords = size / 4;
+    uint32_t start = GET_CYCLE_COUNT();
+    QuarantineCursor cursor;
+    AddressSequence sequence;
     status->dataTestTotal++;
 
-    /* Write phase - write checkerboard pattern */
-    for (uint32_t offset = 0; offset < size; offset += 4) {
-        addr = (uint32_t*)(startAddr + offset);
+    /* Ascending order skips the iterator, as in the random-data kernel */
+    uint32_t linear = (addressOrder == ADDRESS_ORDER_UP);
 
-        /* Attempt to write pattern */
-        *addr = pattern;
-    }
+    /* Write phase - write checkerboard pattern */
+    FillBackground(startAddr, size, pattern);
 
     /* Read phase - verify checkerboard pattern */
-    for (uint32_t offset = 0; offset < size; offset += 4) {
-        addr = (uint32_t*)(startAddr + offset);
+    StartAddressSequence(&sequence, addressOrder, numWords, 0);
+    StartQuarantineCursor(&cursor);
+    for (uint32_t i = 0; i < numWords; i++) {
+        addr = (uint32_t*)startAddr + (linear ? i : NextAddressIndex(&sequence));
 
-        /* Read and verify */
-        if (*addr != pattern) {
-            errors++;
+        /* Known-bad words were reported when they were quarantined */
+        if (SkipQuarantinedWord(&cursor, (uint32_t)addr)) continue;
 
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Checkerboard Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     (uint32_t)addr, *addr, pattern);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        /* Read and verify */
+        uint32_t readValue = *addr;
+        if (readValue != pattern) {
+            errors += RecordMemoryError("Checkerboard", (uint32_t)addr, readValue, pattern);
         }
     }
 
@@ -63,30 +385,26 @@ uint32_t RunCheckerboardTest(uint32_t startAddr, uint32_t size, uint32_t pattern
     uint32_t invPattern = ~pattern;
 
     /* Write phase - write inverse pattern */
-    for (uint32_t offset = 0; offset < size; offset += 4) {
-        addr = (uint32_t*)(startAddr + offset);
-
-        /* Attempt to write inverse pattern */
-        *addr = invPattern;
-    }
+    FillBackground(startAddr, size, invPattern);
 
     /* Read phase - verify inverse pattern */
-    for (uint32_t offset = 0; offset < size; offset += 4) {
-        addr = (uint32_t*)(startAddr + offset);
+    StartAddressSequence(&sequence, addressOrder, numWords, 0);
+    StartQuarantineCursor(&cursor);
+    for (uint32_t i = 0; i < numWords; i++) {
+        addr = (uint32_t*)startAddr + (linear ? i : NextAddressIndex(&sequence));
 
-        /* Read and verify */
-        if (*addr != invPattern) {
-            errors++;
+        if (SkipQuarantinedWord(&cursor, (uint32_t)addr)) continue;
 
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Checkerboard Error (inv): addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     (uint32_t)addr, *addr, invPattern);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        /* Read and verify */
+        uint32_t readValue = *addr;
+        if (readValue != invPattern) {
+            errors += RecordMemoryError("Checkerboard (inv)", (uint32_t)addr, readValue, invPattern);
         }
     }
 
+    /* Two write and two read passes */
+    RecordKernelRun(KERNEL_CHECKERBOARD, size * 4, GET_CYCLE_COUNT() - start);
+
     if (errors == 0) {
         status->dataTestSuccess++;
     }
@@ -111,8 +429,8 @@ void RunCacheTest(MemoryTestStatus* status)
     __HAL_FLASH_ART_ENABLE();
     __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
 
-    /* Unlock flash */
-    HAL_FLASH_Unlock();
+    /* Unlock flash, finishing any background log erase first */
+    UnlockFlashForWrite(1);
 
     /* Erase flash sector */
     FLASH_EraseInitTypeDef eraseInit;
@@ -130,7 +448,7 @@ void RunCacheTest(MemoryTestStatus* status)
         snprintf(buffer, sizeof(buffer),
                  "Cache Test Error: Flash erase failed, page=0x%08lX\r\n",
                  pageError);
-        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
     }
     else {
         /* Program flash with test pattern */
@@ -142,7 +460,7 @@ void RunCacheTest(MemoryTestStatus* status)
             snprintf(buffer, sizeof(buffer),
                      "Cache Test Error: Flash program failed at addr=0x%08lX\r\n",
                      testAddr);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+            if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
         }
         else {
             /* Read back value (should read from cache) */
@@ -150,14 +468,7 @@ void RunCacheTest(MemoryTestStatus* status)
             uint32_t readValue = *addr;
 
             if (readValue != testPattern) {
-                errors++;
-
-                /* Report error */
-                char buffer[128];
-                snprintf(buffer, sizeof(buffer),
-                         "Cache Test Error: Cached read addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                         (uint32_t)addr, readValue, testPattern);
-                HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+                errors += RecordMemoryError("Cache Test (cached read)", (uint32_t)addr, readValue, testPattern);
             }
 
             /* Force cache invalidation */
@@ -169,14 +480,7 @@ void RunCacheTest(MemoryTestStatus* status)
             readValue = *addr;
 
             if (readValue != testPattern) {
-                errors++;
-
-                /* Report error */
-                char buffer[128];
-                snprintf(buffer, sizeof(buffer),
-                         "Cache Test Error: Direct read addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                         (uint32_t)addr, readValue, testPattern);
-                HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+                errors += RecordMemoryError("Cache Test (direct read)", (uint32_t)addr, readValue, testPattern);
             }
         }
     }
@@ -219,15 +523,9 @@ uint32_t RunAddressTest(uint32_t startAddr, uint32_t size, MemoryTestStatus* sta
         expectedValue = (uint32_t)addr ^ (testCycleCounter * 0x1234567B);
 
         /* Read and verify */
-        if (*addr != expectedValue) {
-            errors++;
-
-            /* Report the error */
-            char buffer[128];
-            snprintf(buffer, sizeof(buffer),
-                     "Address Test Error: addr=0x%08lX, read=0x%08lX, expected=0x%08lX\r\n",
-                     (uint32_t)addr, *addr, expectedValue);
-            HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        uint32_t readValue = *addr;
+        if (readValue != expectedValue) {
+            errors += RecordMemoryError("Address Test", (uint32_t)addr, readValue, expectedValue);
         }
     }
 
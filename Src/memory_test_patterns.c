@@ -6,3 +6,221 @@
  */
 
 
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern IWDG_HandleTypeDef hiwdg;
+extern volatile uint32_t testCycleCounter;
+
+/* March C: {(w0); up(r0,w1); up(r1,w0); (r0); down(r0,w1); down(r1,w0); (r0)} */
+static const MarchElement marchCElements[] = {
+    { MARCH_UP,   1, { MARCH_W0 } },
+    { MARCH_UP,   2, { MARCH_R0, MARCH_W1 } },
+    { MARCH_UP,   2, { MARCH_R1, MARCH_W0 } },
+    { MARCH_UP,   1, { MARCH_R0 } },
+    { MARCH_DOWN, 2, { MARCH_R0, MARCH_W1 } },
+    { MARCH_DOWN, 2, { MARCH_R1, MARCH_W0 } },
+    { MARCH_UP,   1, { MARCH_R0 } },
+};
+
+/* March B: {(w0); up(r0,w1,r1,w0,r0,w1); up(r1,w0,w1); down(r1,w0,w1,w0); down(r0,w1,w0)} */
+static const MarchElement marchBElements[] = {
+    { MARCH_UP,   1, { MARCH_W0 } },
+    { MARCH_UP,   6, { MARCH_R0, MARCH_W1, MARCH_R1, MARCH_W0, MARCH_R0, MARCH_W1 } },
+    { MARCH_UP,   3, { MARCH_R1, MARCH_W0, MARCH_W1 } },
+    { MARCH_DOWN, 4, { MARCH_R1, MARCH_W0, MARCH_W1, MARCH_W0 } },
+    { MARCH_DOWN, 3, { MARCH_R0, MARCH_W1, MARCH_W0 } },
+};
+
+const MarchAlgorithm marchCAlgorithm = {
+    "March C", marchCElements, sizeof(marchCElements) / sizeof(marchCElements[0])
+};
+
+const MarchAlgorithm marchBAlgorithm = {
+    "March B", marchBElements, sizeof(marchBElements) / sizeof(marchBElements[0])
+};
+
+/* Data backgrounds that make every pair of bits in a word differ at least once */
+const uint32_t marchDataBackgrounds[MARCH_NUM_BACKGROUNDS] = {
+    0x00000000, 0x55555555, 0x33333333, 0x0F0F0F0F, 0x00FF00FF, 0x0000FFFF
+};
+
+/**
+  * @brief  Run a March algorithm over a memory region in ascending order
+  * @param  algorithm: March algorithm to run
+  * @param  startAddr: Start address of memory region to test (word aligned)
+  * @param  size: Size of memory region to test
+  * @param  background: Data background; "1" operations use its inverse
+  * @retval Number of errors detected
+  */
+uint32_t RunMarchTest(const MarchAlgorithm* algorithm, uint32_t startAddr, uint32_t size, uint32_t background)
+{
+    return RunMarchTestOrdered(algorithm, startAddr, size, background, ADDRESS_ORDER_UP);
+}
+
+/**
+  * @brief  Run a March algorithm over a memory region in a given address order
+  * @param  algorithm: March algorithm to run
+  * @param  startAddr: Start address of memory region to test (word aligned)
+  * @param  size: Size of memory region to test
+  * @param  background: Data background; "1" operations use its inverse
+  * @param  addressOrder: ADDRESS_ORDER_x followed by "up" elements
+  * @retval Number of errors detected
+  */
+uint32_t RunMarchTestOrdered(const MarchAlgorithm* algorithm, uint32_t startAddr, uint32_t size,
+                             uint32_t background, uint32_t addressOrder)
+{
+    uint32_t errors = 0;
+    uint32_t numWords = size / 4;
+    uint32_t operations = 0;
+    uint32_t start = GET_CYCLE_COUNT();
+    volatile uint32_t* base = (volatile uint32_t*)startAddr;
+    const uint32_t values[2] = { background, ~background };
+    AddressSequence sequence;
+    QuarantineCursor cursor;
+
+    if (addressOrder >= NUM_ADDRESS_ORDERS) addressOrder = ADDRESS_ORDER_UP;
+
+    for (uint32_t e = 0; e < algorithm->numElements; e++) {
+        const MarchElement* element = &algorithm->elements[e];
+        StartAddressSequence(&sequence, addressOrder, numWords, element->order == MARCH_DOWN);
+        StartQuarantineCursor(&cursor);
+        operations += element->numOps;
+
+        /* A lone write in either order is a plain background fill */
+        if (element->numOps == 1 && element->order == MARCH_UP && !(element->ops[0] & MARCH_OP_READ)) {
+            FillBackground(startAddr, numWords * 4, values[element->ops[0] & MARCH_OP_INVERSE]);
+            continue;
+        }
+
+        for (uint32_t n = 0; n < numWords; n++) {
+            uint32_t index = NextAddressIndex(&sequence);
+            volatile uint32_t* addr = &base[index];
+
+            /* Known-bad words were reported when they were quarantined */
+            if (SkipQuarantinedWord(&cursor, (uint32_t)addr)) continue;
+
+            for (uint32_t op = 0; op < element->numOps; op++) {
+                uint8_t code = element->ops[op];
+                uint32_t value = values[code & MARCH_OP_INVERSE];
+
+                if (code & MARCH_OP_READ) {
+                    uint32_t readValue = *addr;
+                    if (readValue != value) {
+                        errors += RecordMemoryError(algorithm->name, (uint32_t)addr, readValue, value);
+                    }
+                }
+                else {
+                    *addr = value;
+                }
+            }
+        }
+
+        /* Large windows can take a while per element */
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+
+    /* Throughput is tracked per address order */
+    RecordKernelRun(KERNEL_MARCH_UP + addressOrder, numWords * 4 * operations, GET_CYCLE_COUNT() - start);
+
+    return errors;
+}
+
+/**
+  * @brief  Run March C with an all-zero background
+  * @param  startAddr: Start address of memory region to test
+  * @param  size: Size of memory region to test
+  * @retval Number of errors detected
+  */
+uint32_t RunMarchCTest(uint32_t startAddr, uint32_t size)
+{
+    return RunMarchTest(&marchCAlgorithm, startAddr, size, 0x00000000);
+}
+
+/**
+  * @brief  Pick a seed for a random-data pass
+  * @param  startAddr: Window start address, mixed in so regions differ
+  * @retval Non-zero xorshift32 seed
+  * @note   Seeded from the free-running cycle counter; the RNG peripheral
+  *         would need the 48MHz clock, which this build leaves disabled.
+  */
+uint32_t GenerateRandomSeed(uint32_t startAddr)
+{
+    uint32_t seed = GET_CYCLE_COUNT() ^ (testCycleCounter * 0x9E3779B9U) ^ startAddr;
+
+    return (seed != 0) ? seed : 0x6D2B79F5U;
+}
+
+/**
+  * @brief  Fill a window from an xorshift32 stream and verify by regenerating it
+  * @param  startAddr: Start address of memory region to test
+  * @param  size: Size of memory region to test
+  * @param  seed: Non-zero seed; logged if the pass fails so it can be replayed
+  * @param  addressOrder: ADDRESS_ORDER_x in which the stream is laid down
+  * @param  status: Pointer to status structure to update
+  * @retval Number of errors detected
+  * @note   The second write/verify pair uses the inverted stream, so every
+  *         bit is tested at both values, like the checkerboard kernel.
+  */
+uint32_t RunRandomDataTest(uint32_t startAddr, uint32_t size, uint32_t seed, uint32_t addressOrder,
+                           MemoryTestStatus* status)
+{
+    uint32_t errors = 0;
+    uint32_t numWords = size / 4;
+    uint32_t start = GET_CYCLE_COUNT();
+    AddressSequence sequence;
+    status->dataTestTotal++;
+
+    /* Ascending order skips the iterator to keep pace with the checkerboard */
+    uint32_t linear = (addressOrder == ADDRESS_ORDER_UP);
+
+    for (uint32_t invert = 0; invert < 2; invert++) {
+        uint32_t mask = invert ? 0xFFFFFFFF : 0;
+        uint32_t* addr = (uint32_t*)startAddr;
+        uint32_t state = seed;
+
+        /* Write phase */
+        StartAddressSequence(&sequence, addressOrder, numWords, 0);
+        for (uint32_t i = 0; i < numWords; i++) {
+            uint32_t index = linear ? i : NextAddressIndex(&sequence);
+            XORSHIFT32_NEXT(state);
+            addr[index] = state ^ mask;
+        }
+
+        /* Read phase - regenerate the same stream in the same order */
+        state = seed;
+        StartAddressSequence(&sequence, addressOrder, numWords, 0);
+        for (uint32_t i = 0; i < numWords; i++) {
+            uint32_t index = linear ? i : NextAddressIndex(&sequence);
+            XORSHIFT32_NEXT(state);
+            uint32_t expected = state ^ mask;
+            uint32_t readValue = ((volatile uint32_t*)addr)[index];
+            if (readValue != expected) {
+                errors += RecordMemoryError("Random Data", (uint32_t)&addr[index], readValue, expected);
+            }
+        }
+    }
+
+    /* Two write and two read passes */
+    RecordKernelRun(KERNEL_RANDOM, size * 4, GET_CYCLE_COUNT() - start);
+
+    if (errors == 0) {
+        status->dataTestSuccess++;
+    }
+    else {
+        char buffer[96];
+        snprintf(buffer, sizeof(buffer),
+                 "Random Data: seed=0x%08lX order=%s window=0x%08lX+0x%lX\r\n",
+                 seed, GetAddressOrderName(addressOrder), startAddr, size);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+        LogRandomSeed(seed, addressOrder, startAddr, size, errors);
+    }
+
+    return errors;
+}
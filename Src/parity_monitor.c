@@ -0,0 +1,250 @@
+/**
+ * SRAM Parity Monitor for STM32G473CB Memory Test
+ *
+ * SRAM2 and CCM SRAM carry a parity bit per byte. A parity error sets
+ * SYSCFG_CFGR2.SPF and raises an NMI, so a bad word is caught on the read
+ * itself rather than when a compare happens to see a changed value.
+ * Parity checking is an option bit (SRAM_PE), so it is programmed once if
+ * found disabled, which reloads the option bytes and resets the part. The
+ * NMI handler only timestamps the event and pushes it into a
+ * single-producer ring; the main loop drains the ring. The hardware does
+ * not latch the failing address, so the main loop re-reads the
+ * parity-checked windows with the handler in probe mode to find the word
+ * that trips it. Words never written since reset have random parity, so
+ * both regions are filled once at start-up.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* Events held between NMI and main loop, a power of two */
+#define PARITY_EVENT_QUEUE    16
+
+/* Regions with parity, searched in this order */
+static const uint32_t parityRegions[] = { REGION_SRAM2, REGION_CCM_SRAM };
+#define NUM_PARITY_REGIONS    (sizeof(parityRegions) / sizeof(parityRegions[0]))
+
+/* One parity NMI */
+typedef struct {
+    uint32_t tick;                 /* HAL tick at the NMI */
+    uint32_t cycle;                /* Test cycle at the NMI */
+    char operation[24];            /* Test operation that was running */
+} ParityEvent;
+
+/* Function prototypes */
+void InitializeParityMonitor(void);
+uint32_t HandleParityNMI(void);
+void ServiceParityEvents(void);
+void ReportParityStatus(void);
+
+/* Ring buffer - head written only by the NMI, tail only by the main loop.
+   Kept in the framework state pages, out of reach of stray kernel writes. */
+FRAMEWORK_STATE static ParityEvent parityEvents[PARITY_EVENT_QUEUE];
+FRAMEWORK_STATE static volatile uint32_t parityEventHead;
+FRAMEWORK_STATE static volatile uint32_t parityEventTail;
+FRAMEWORK_STATE static volatile uint32_t parityEventsDropped;
+
+/* Set while the main loop searches for the failing word */
+static volatile uint32_t parityProbeActive = 0;
+static volatile uint32_t parityProbeHits = 0;
+
+/* Statistics */
+static uint32_t parityEnabled = 0;
+static uint32_t parityEventsTotal = 0;
+static uint32_t parityUnlocated = 0;
+static uint32_t lastParityAddress = 0;
+static uint32_t lastParityTick = 0;
+
+/**
+  * @brief  Turn on parity checking and initialize the checked memory
+  * @note   Does not return if the SRAM_PE option bit has to be changed
+  */
+void InitializeParityMonitor(void)
+{
+    /* SRAM_PE set means parity checking is off */
+    if (FLASH->OPTR & FLASH_OPTR_SRAM_PE) {
+        FLASH_OBProgramInitTypeDef obConfig = {0};
+        char buffer[] = "Parity Monitor: enabling SRAM parity, option bytes reload and reset\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+        obConfig.OptionType = OPTIONBYTE_USER;
+        obConfig.USERType = OB_USER_SRAM_PE;
+        obConfig.USERConfig = OB_SRAM_PARITY_ENABLE;
+
+        UnlockFlashForWrite(1);
+        HAL_FLASH_OB_Unlock();
+        if (HAL_FLASHEx_OBProgram(&obConfig) == HAL_OK) {
+            HAL_FLASH_OB_Launch();
+        }
+
+        /* Still here - the option bytes could not be changed */
+        HAL_FLASH_OB_Lock();
+        HAL_FLASH_Lock();
+        char failed[] = "Parity Monitor Error: option byte programming failed\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)failed, strlen(failed), 1000);
+        return;
+    }
+
+    /* Give every checked word valid parity before anything reads it */
+    for (uint32_t i = 0; i < NUM_PARITY_REGIONS; i++) {
+        uint32_t boundsStart, boundsEnd;
+        GetRegionTestBounds(parityRegions[i], &boundsStart, &boundsEnd);
+        FillBackground(boundsStart, boundsEnd - boundsStart, 0);
+    }
+
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+
+    /* Clear any stale flag (write 1), and route parity errors to the
+       timer break inputs as well as the NMI */
+    SYSCFG->CFGR2 |= SYSCFG_CFGR2_SPF;
+    SYSCFG->CFGR2 |= SYSCFG_CFGR2_SPL;
+
+    parityEventHead = 0;
+    parityEventTail = 0;
+    parityEnabled = 1;
+}
+
+/**
+  * @brief  Capture a parity error from the NMI handler
+  * @retval 1 if the NMI was a parity error and has been cleared
+  */
+uint32_t HandleParityNMI(void)
+{
+    if (!(SYSCFG->CFGR2 & SYSCFG_CFGR2_SPF)) return 0;
+
+    SYSCFG->CFGR2 |= SYSCFG_CFGR2_SPF;
+
+    if (parityProbeActive) {
+        parityProbeHits++;
+        return 1;
+    }
+
+    /* The NMI can land inside a kernel, with the state pages locked */
+    uint32_t stateAccess = UnlockFrameworkStateNMI();
+
+    uint32_t head = parityEventHead;
+    if (head - parityEventTail >= PARITY_EVENT_QUEUE) {
+        parityEventsDropped++;
+        CommitFrameworkStateNMI(stateAccess);
+        return 1;
+    }
+
+    ParityEvent* event = &parityEvents[head % PARITY_EVENT_QUEUE];
+    event->tick = HAL_GetTick();
+    event->cycle = testCycleCounter;
+    for (uint32_t i = 0; i < sizeof(event->operation) - 1; i++) {
+        event->operation[i] = currentTestOperation[i];
+        if (event->operation[i] == '\0') break;
+    }
+    event->operation[sizeof(event->operation) - 1] = '\0';
+
+    /* Publish the entry only once it is complete */
+    __DMB();
+    parityEventHead = head + 1;
+
+    CommitFrameworkStateNMI(stateAccess);
+    return 1;
+}
+
+/**
+  * @brief  Re-read the parity-checked windows to find a word with bad parity
+  * @param  address: Set to the failing word if one is found
+  * @retval Region of the failing word, or REGION_NONE
+  */
+static uint32_t LocateParityFault(uint32_t* address)
+{
+    uint32_t region = REGION_NONE;
+
+    /* The probe reads the guarded test windows as well */
+    OpenTestWindows(GUARD_ALL_WINDOWS);
+    parityProbeActive = 1;
+
+    for (uint32_t i = 0; i < NUM_PARITY_REGIONS && region == REGION_NONE; i++) {
+        uint32_t boundsStart, boundsEnd;
+        GetRegionTestBounds(parityRegions[i], &boundsStart, &boundsEnd);
+
+        for (uint32_t addr = boundsStart; addr < boundsEnd; addr += 4) {
+            uint32_t hitsBefore = parityProbeHits;
+            (void)*(volatile uint32_t*)addr;
+            __DSB();
+
+            if (parityProbeHits != hitsBefore) {
+                *address = addr;
+                region = parityRegions[i];
+                break;
+            }
+        }
+    }
+
+    parityProbeActive = 0;
+    CloseTestWindows(GUARD_ALL_WINDOWS);
+    HAL_IWDG_Refresh(&hiwdg);
+
+    return region;
+}
+
+/**
+  * @brief  Drain parity events, locate the failing words and count them per region
+  */
+void ServiceParityEvents(void)
+{
+    char buffer[128];
+
+    while (parityEventTail != parityEventHead) {
+        ParityEvent event = parityEvents[parityEventTail % PARITY_EVENT_QUEUE];
+        __DMB();
+        UnlockFrameworkState();
+        parityEventTail++;
+        CommitFrameworkState();
+        parityEventsTotal++;
+
+        /* A word that has since been rewritten can't be found again */
+        uint32_t address = 0;
+        uint32_t region = LocateParityFault(&address);
+
+        if (region == REGION_NONE) {
+            parityUnlocated++;
+            snprintf(buffer, sizeof(buffer),
+                     "Parity Error: cycle %lu at %lums during %s, word not found on re-read\r\n",
+                     event.cycle, event.tick, event.operation);
+            if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+            continue;
+        }
+
+        GetRegionStatus(region)->parityErrors++;
+        lastParityAddress = address;
+        lastParityTick = event.tick;
+
+        snprintf(buffer, sizeof(buffer),
+                 "Parity Error: %s 0x%08lX, cycle %lu at %lums during %s\r\n",
+                 GetRegionName(region), address, event.cycle, event.tick, event.operation);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+        /* Found on a plain read - keep the tests off it */
+        if (!IsAddressQuarantined(address)) {
+            QuarantineAddress(address);
+        }
+    }
+}
+
+/**
+  * @brief  Report parity events per region
+  */
+void ReportParityStatus(void)
+{
+    char buffer[192];
+
+    snprintf(buffer, sizeof(buffer),
+             "Parity: %s events=%lu SRAM2=%lu CCM=%lu unlocated=%lu dropped=%lu last=0x%08lX at %lums\r\n",
+             parityEnabled ? "enabled" : "disabled",
+             parityEventsTotal, sram2Status.parityErrors, ccmStatus.parityErrors,
+             parityUnlocated, parityEventsDropped, lastParityAddress, lastParityTick);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
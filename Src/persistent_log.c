@@ -0,0 +1,589 @@
+/**
+ * Persistent Result Log for STM32G473CB Memory Test
+ *
+ * Appends compact binary records to reserved flash pages at the top of bank 2.
+ * Records are queued in RAM (from thread or interrupt context) and programmed
+ * a doubleword at a time by ServicePersistentLog(), within a configured time
+ * budget per cycle. Pages are used round-robin for wear levelling; each page
+ * starts with a header holding a sequence number, so the active page is found
+ * at boot by reading one doubleword per page. The next page is erased in the
+ * background, which leaves PER set in FLASH->CR until the erase is finished
+ * off; every other flash writer unlocks through UnlockFlashForWrite(), which
+ * finishes it first.
+ *
+ * Record layout (little endian, doubleword aligned):
+ *   word 0: type | length (doublewords, header included) << 8 | info << 16 | check << 24
+ *   word 1: test cycle
+ *   word 2..: payload, zero padded to a doubleword
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+extern MemoryTestConfig testConfig;
+
+/* Log geometry */
+#define LOG_PAGE_MAGIC          0x474C544DU   /* "MTLG" */
+#define LOG_QUEUE_DEPTH         32
+#define LOG_MAX_RECORD_DWORDS   4
+#define LOG_MAX_PAYLOAD_WORDS   ((LOG_MAX_RECORD_DWORDS - 1) * 2)
+#define LOG_ERASED_WORD         0xFFFFFFFFU
+#define LOG_CHECK_SEED          0xA5U
+#define LOG_PREERASE_OFFSET     (FLASH_PAGE_SIZE * 3 / 4)  /* Start erasing the next page here */
+#define LOG_DEFAULT_PROGRAM_US  90                        /* Initial doubleword program estimate */
+
+/* State of the page after the active one */
+#define LOG_PAGE_UNKNOWN        0
+#define LOG_PAGE_ERASING        1
+#define LOG_PAGE_READY          2
+
+/* Queued record, ready to program */
+typedef union {
+    uint64_t dwords[LOG_MAX_RECORD_DWORDS];
+    uint32_t words[LOG_MAX_RECORD_DWORDS * 2];
+} LogQueueEntry;
+
+/* Function prototypes */
+void InitializePersistentLog(void);
+void LogErrorRecord(const MemoryErrorRecord* record);
+void LogCycleSummary(const CycleSummaryRecord* summary);
+void LogResetEvent(uint32_t resetCause, uint32_t resetCount, uint32_t lastCycle);
+void LogECCEvent(uint32_t address, uint32_t uncorrectable);
+void LogRandomSeed(uint32_t seed, uint32_t addressOrder, uint32_t startAddr, uint32_t size, uint32_t errors);
+void LogBurnInCheckpoint(const BurnInCheckpoint* checkpoint);
+uint32_t FindLastBurnInCheckpoint(BurnInCheckpoint* checkpoint);
+void ServicePersistentLog(void);
+void ReportPersistentLogStatus(void);
+void GetFlashBankPage(uint32_t address, uint32_t* bank, uint32_t* page);
+uint32_t UnlockFlashForWrite(uint32_t wait);
+
+/* RAM queue - filled from any context, drained by ServicePersistentLog().
+   Kept in the framework state pages so a stray kernel write can't lose
+   a queued error. */
+FRAMEWORK_STATE static LogQueueEntry logQueue[LOG_QUEUE_DEPTH];
+FRAMEWORK_STATE static volatile uint32_t queueHead;
+FRAMEWORK_STATE static volatile uint32_t queueTail;
+FRAMEWORK_STATE static volatile uint32_t droppedRecords;
+
+/* Flash state */
+static uint8_t logReady = 0;
+static uint8_t nextPageState = LOG_PAGE_UNKNOWN;
+static uint32_t activePage = 0;
+static uint32_t activeSequence = 0;
+static uint32_t writeOffset = 0;
+static uint32_t programCyclesPerDword = 0;
+
+/* Statistics */
+static uint32_t recordsWritten = 0;
+static uint32_t pagesErased = 0;
+static uint32_t budgetDeferrals = 0;
+static uint32_t programFailures = 0;
+static uint32_t tornRecords = 0;
+
+/**
+  * @brief  Get the address of a log page
+  * @param  page: Log page index
+  * @retval Page start address
+  */
+static uint32_t GetLogPageAddress(uint32_t page)
+{
+    return FLASH_LOG_START_ADDR + page * FLASH_PAGE_SIZE;
+}
+
+/**
+  * @brief  Compute the check byte of a record payload
+  * @param  words: Record words, header included
+  * @param  lengthDwords: Record length in doublewords
+  * @retval Check byte
+  */
+static uint8_t ComputeRecordCheck(const uint32_t* words, uint32_t lengthDwords)
+{
+    uint32_t fold = words[1];
+    for (uint32_t i = 2; i < lengthDwords * 2; i++) {
+        fold ^= words[i];
+    }
+    fold ^= fold >> 16;
+    fold ^= fold >> 8;
+    return (uint8_t)(fold ^ LOG_CHECK_SEED ^ (words[0] & 0xFF));
+}
+
+/**
+  * @brief  Check whether a log page is fully erased
+  * @param  page: Log page index
+  * @retval 1 if erased, 0 otherwise
+  */
+static uint32_t IsLogPageErased(uint32_t page)
+{
+    const uint32_t* words = (const uint32_t*)GetLogPageAddress(page);
+    for (uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++) {
+        if (words[i] != LOG_ERASED_WORD) return 0;
+    }
+    return 1;
+}
+
+/**
+  * @brief  Queue a record for programming
+  * @param  type: Record type (LOG_RECORD_x)
+  * @param  info: Record-specific flags
+  * @param  cycle: Test cycle the record belongs to
+  * @param  payload: Payload words
+  * @param  payloadWords: Number of payload words
+  */
+static void AppendLogRecord(uint8_t type, uint8_t info, uint32_t cycle,
+                            const uint32_t* payload, uint32_t payloadWords)
+{
+    LogQueueEntry entry;
+    uint32_t lengthDwords = 1 + (payloadWords + 1) / 2;
+
+    memset(&entry, 0, sizeof(entry));
+    memcpy(&entry.words[2], payload, payloadWords * 4);
+    entry.words[0] = type | (lengthDwords << 8) | ((uint32_t)info << 16);
+    entry.words[1] = cycle;
+    entry.words[0] |= (uint32_t)ComputeRecordCheck(entry.words, lengthDwords) << 24;
+
+    /* Interrupt handlers log too, so the queue is updated with IRQs masked */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    UnlockFrameworkState();
+
+    uint32_t next = (queueHead + 1) % LOG_QUEUE_DEPTH;
+    if (next == queueTail) {
+        droppedRecords++;
+    }
+    else {
+        logQueue[queueHead] = entry;
+        queueHead = next;
+    }
+
+    CommitFrameworkState();
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Get the flash bank and bank-relative page of an address
+  * @param  address: Flash address
+  * @param  bank: Receives FLASH_BANK_1 or FLASH_BANK_2
+  * @param  page: Receives the page number within the bank
+  */
+void GetFlashBankPage(uint32_t address, uint32_t* bank, uint32_t* page)
+{
+    if (address >= FLASH_BANK2_START_ADDR) {
+        *bank = FLASH_BANK_2;
+        *page = (address - FLASH_BANK2_START_ADDR) / FLASH_PAGE_SIZE;
+    }
+    else {
+        *bank = FLASH_BANK_1;
+        *page = (address - FLASH_START_ADDR) / FLASH_PAGE_SIZE;
+    }
+}
+
+/**
+  * @brief  Start erasing the page after the active one without waiting
+  * @note   The log lives in bank 2, so code running from bank 1 is not stalled
+  */
+static void StartNextPageErase(void)
+{
+    uint32_t bank, page;
+
+    if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY)) return;
+
+    GetFlashBankPage(GetLogPageAddress((activePage + 1) % FLASH_LOG_PAGES), &bank, &page);
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+    FLASH_PageErase(page, bank);
+
+    nextPageState = LOG_PAGE_ERASING;
+    pagesErased++;
+}
+
+/**
+  * @brief  Close a background erase once the controller is idle
+  * @note   Flash must be unlocked; PER stays set until this runs, and any
+  *         program or erase started meanwhile fails with PGSERR.
+  */
+static void FinishNextPageErase(void)
+{
+    CLEAR_BIT(FLASH->CR, (FLASH_CR_PER | FLASH_CR_PNB | FLASH_CR_BKER));
+    FLASH_FlushCaches();
+    nextPageState = LOG_PAGE_READY;
+}
+
+/**
+  * @brief  Unlock the flash for a writer other than the log
+  * @param  wait: Non-zero to wait out a background log page erase
+  * @retval 1 if unlocked and idle, 0 (still locked) if an erase is running
+  *         and wait is zero
+  * @note   Every program or erase outside this file unlocks through here
+  *         instead of HAL_FLASH_Unlock(), and locks with HAL_FLASH_Lock().
+  */
+uint32_t UnlockFlashForWrite(uint32_t wait)
+{
+    if (!wait && __HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY)) return 0;
+
+    while (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY)) {
+    }
+
+    HAL_FLASH_Unlock();
+    if (nextPageState == LOG_PAGE_ERASING) {
+        FinishNextPageErase();
+    }
+    return 1;
+}
+
+/**
+  * @brief  Program a doubleword and track the measured programming time
+  * @param  address: Destination address (doubleword aligned)
+  * @param  data: Doubleword to program
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef ProgramLogDword(uint32_t address, uint64_t data)
+{
+    uint32_t start = GET_CYCLE_COUNT();
+    HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address, data);
+    uint32_t elapsed = GET_CYCLE_COUNT() - start;
+
+    /* Running average keeps the budget check honest across temperature */
+    programCyclesPerDword = (programCyclesPerDword * 7 + elapsed) / 8;
+
+    return status;
+}
+
+/**
+  * @brief  Move to the (erased) next page and write its header
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef ActivateNextPage(void)
+{
+    uint32_t page = (activePage + 1) % FLASH_LOG_PAGES;
+    uint64_t header = LOG_PAGE_MAGIC | ((uint64_t)(activeSequence + 1) << 32);
+
+    HAL_StatusTypeDef status = ProgramLogDword(GetLogPageAddress(page), header);
+
+    /* Even on failure, move on - the page will be skipped at boot */
+    activePage = page;
+    activeSequence++;
+    writeOffset = 8;
+    nextPageState = LOG_PAGE_UNKNOWN;
+
+    return status;
+}
+
+/**
+  * @brief  Find the active page and write position after a reset
+  */
+void InitializePersistentLog(void)
+{
+    uint32_t found = 0;
+
+    programCyclesPerDword = US_TO_CYCLES(LOG_DEFAULT_PROGRAM_US);
+
+    /* O(pages): only the header doubleword of each page is read */
+    for (uint32_t page = 0; page < FLASH_LOG_PAGES; page++) {
+        const uint32_t* header = (const uint32_t*)GetLogPageAddress(page);
+        if (header[0] != LOG_PAGE_MAGIC || header[1] == LOG_ERASED_WORD) continue;
+
+        if (!found || header[1] > activeSequence) {
+            activePage = page;
+            activeSequence = header[1];
+            found = 1;
+        }
+    }
+
+    HAL_FLASH_Unlock();
+
+    if (!found) {
+        /* Blank or foreign contents - start a fresh log in the first page */
+        FLASH_EraseInitTypeDef eraseInit;
+        uint32_t pageError = 0;
+        GetFlashBankPage(GetLogPageAddress(0), &eraseInit.Banks, &eraseInit.Page);
+        eraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+        eraseInit.NbPages = 1;
+        HAL_FLASHEx_Erase(&eraseInit, &pageError);
+
+        activePage = FLASH_LOG_PAGES - 1;
+        activeSequence = 0;
+        ActivateNextPage();
+    }
+    else {
+        /* Walk the records of the active page to find the first free slot */
+        uint32_t pageAddr = GetLogPageAddress(activePage);
+        writeOffset = 8;
+
+        while (writeOffset + 8 <= FLASH_PAGE_SIZE) {
+            const uint32_t* words = (const uint32_t*)(pageAddr + writeOffset);
+            if (words[0] == LOG_ERASED_WORD && words[1] == LOG_ERASED_WORD) break;
+
+            uint32_t lengthDwords = (words[0] >> 8) & 0xFF;
+            if (lengthDwords == 0 || lengthDwords > LOG_MAX_RECORD_DWORDS ||
+                writeOffset + lengthDwords * 8 > FLASH_PAGE_SIZE) {
+                /* Unparseable - abandon the rest of this page */
+                tornRecords++;
+                writeOffset = FLASH_PAGE_SIZE;
+                break;
+            }
+
+            if ((words[0] >> 24) != ComputeRecordCheck(words, lengthDwords)) {
+                tornRecords++;
+            }
+            writeOffset += lengthDwords * 8;
+        }
+    }
+
+    HAL_FLASH_Lock();
+
+    nextPageState = IsLogPageErased((activePage + 1) % FLASH_LOG_PAGES) ?
+                    LOG_PAGE_READY : LOG_PAGE_UNKNOWN;
+    logReady = 1;
+}
+
+/**
+  * @brief  Queue a memory error record
+  * @param  record: Error record to log
+  */
+void LogErrorRecord(const MemoryErrorRecord* record)
+{
+    uint32_t payload[4];
+    payload[0] = record->address;
+    payload[1] = record->readValue;
+    payload[2] = record->expectedValue;
+    payload[3] = (uint16_t)record->environment.temperatureC | ((uint32_t)record->environment.vddaMv << 16);
+
+    /* Region in the low nibble of info, fault class in the high nibble */
+    AppendLogRecord(LOG_RECORD_ERROR, (record->region & 0x0F) | (record->faultClass << 4), record->cycle, payload, 4);
+}
+
+/**
+  * @brief  Queue a cycle summary record
+  * @param  summary: Cycle summary to log
+  */
+void LogCycleSummary(const CycleSummaryRecord* summary)
+{
+    uint32_t errors[NUM_TEST_REGIONS];
+    uint32_t payload[5];
+
+    /* Per-region counts are saturated to 16 bits */
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        errors[region] = (summary->regionErrors[region] > 0xFFFF) ? 0xFFFF : summary->regionErrors[region];
+    }
+
+    payload[0] = summary->tick;
+    payload[1] = errors[REGION_FLASH] | (errors[REGION_SRAM1] << 16);
+    payload[2] = errors[REGION_SRAM2] | (errors[REGION_CCM_SRAM] << 16);
+    payload[3] = (uint16_t)summary->environment.temperatureC | ((uint32_t)summary->environment.vddaMv << 16);
+    payload[4] = summary->quarantined;
+
+    AppendLogRecord(LOG_RECORD_CYCLE, 0, summary->cycle, payload, 5);
+}
+
+/**
+  * @brief  Queue a reset record
+  * @param  resetCause: RCC->CSR value at boot
+  * @param  resetCount: Watchdog reset counter
+  * @param  lastCycle: Test cycle running when the reset occurred
+  */
+void LogResetEvent(uint32_t resetCause, uint32_t resetCount, uint32_t lastCycle)
+{
+    uint32_t payload[2];
+    payload[0] = resetCause;
+    payload[1] = resetCount;
+
+    AppendLogRecord(LOG_RECORD_RESET, 0, lastCycle, payload, 2);
+}
+
+/**
+  * @brief  Queue a flash ECC event record (safe from interrupt context)
+  * @param  address: Failing address reported by FLASH->ECCR
+  * @param  uncorrectable: Non-zero for a double error
+  */
+void LogECCEvent(uint32_t address, uint32_t uncorrectable)
+{
+    uint32_t payload[2];
+    payload[0] = address;
+    payload[1] = HAL_GetTick();
+
+    AppendLogRecord(LOG_RECORD_ECC, uncorrectable ? 1 : 0, testCycleCounter, payload, 2);
+}
+
+/**
+  * @brief  Queue the seed and window of a random-data pass that failed
+  * @param  seed: xorshift32 seed the pass started from
+  * @param  addressOrder: Address order the stream was laid down in
+  * @param  startAddr: Window start address
+  * @param  size: Window size in bytes
+  * @param  errors: Errors the pass found
+  */
+void LogRandomSeed(uint32_t seed, uint32_t addressOrder, uint32_t startAddr, uint32_t size, uint32_t errors)
+{
+    uint32_t payload[4];
+    payload[0] = seed;
+    payload[1] = startAddr;
+    payload[2] = size;
+    payload[3] = errors;
+
+    /* Region in the low nibble of info, address order in the high nibble */
+    AppendLogRecord(LOG_RECORD_SEED, (GetRegionForAddress(startAddr) & 0x0F) | (addressOrder << 4),
+                    testCycleCounter, payload, 4);
+}
+
+/**
+  * @brief  Queue a burn-in checkpoint record
+  * @param  checkpoint: Burn-in totals
+  */
+void LogBurnInCheckpoint(const BurnInCheckpoint* checkpoint)
+{
+    uint32_t payload[6];
+    payload[0] = checkpoint->elapsedSeconds;
+    payload[1] = (uint32_t)checkpoint->cycles;
+    payload[2] = (uint32_t)(checkpoint->cycles >> 32);
+    payload[3] = (uint32_t)checkpoint->errors;
+    payload[4] = (uint32_t)(checkpoint->errors >> 32);
+    payload[5] = checkpoint->megabytes;
+
+    AppendLogRecord(LOG_RECORD_CHECKPOINT, checkpoint->active ? 1 : 0, testCycleCounter, payload, 6);
+}
+
+/**
+  * @brief  Find the newest burn-in checkpoint in the log
+  * @param  checkpoint: Filled from the record if one is found
+  * @retval 1 if a checkpoint was found
+  * @note   Walks every record of every page - call once at boot
+  */
+uint32_t FindLastBurnInCheckpoint(BurnInCheckpoint* checkpoint)
+{
+    const uint32_t* newest = NULL;
+    uint32_t newestSequence = 0;
+
+    for (uint32_t page = 0; page < FLASH_LOG_PAGES; page++) {
+        uint32_t pageAddr = GetLogPageAddress(page);
+        const uint32_t* header = (const uint32_t*)pageAddr;
+        if (header[0] != LOG_PAGE_MAGIC || header[1] == LOG_ERASED_WORD) continue;
+
+        /* Only a page at least as new as the best so far can hold a newer record */
+        if (newest != NULL && header[1] < newestSequence) continue;
+
+        for (uint32_t offset = 8; offset + 8 <= FLASH_PAGE_SIZE; ) {
+            const uint32_t* words = (const uint32_t*)(pageAddr + offset);
+            if (words[0] == LOG_ERASED_WORD && words[1] == LOG_ERASED_WORD) break;
+
+            uint32_t lengthDwords = (words[0] >> 8) & 0xFF;
+            if (lengthDwords == 0 || lengthDwords > LOG_MAX_RECORD_DWORDS ||
+                offset + lengthDwords * 8 > FLASH_PAGE_SIZE) break;
+
+            if ((words[0] & 0xFF) == LOG_RECORD_CHECKPOINT && lengthDwords == 4 &&
+                (words[0] >> 24) == ComputeRecordCheck(words, lengthDwords)) {
+                newest = words;
+                newestSequence = header[1];
+            }
+            offset += lengthDwords * 8;
+        }
+    }
+
+    if (newest == NULL) return 0;
+
+    checkpoint->active = (newest[0] >> 16) & 0x01;
+    checkpoint->elapsedSeconds = newest[2];
+    checkpoint->cycles = newest[3] | ((uint64_t)newest[4] << 32);
+    checkpoint->errors = newest[5] | ((uint64_t)newest[6] << 32);
+    checkpoint->megabytes = newest[7];
+    return 1;
+}
+
+/**
+  * @brief  Program queued records into flash within the configured time budget
+  */
+void ServicePersistentLog(void)
+{
+    if (!logReady) return;
+
+    uint32_t start = GET_CYCLE_COUNT();
+    uint32_t budget = US_TO_CYCLES(testConfig.logFlushBudgetUs);
+
+    HAL_FLASH_Unlock();
+
+    /* Finish a background erase of the next page */
+    if (nextPageState == LOG_PAGE_ERASING) {
+        if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY)) {
+            HAL_FLASH_Lock();
+            return;
+        }
+        FinishNextPageErase();
+    }
+
+    /* Account for records lost while the queue was full */
+    if (droppedRecords > 0) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t payload[2] = { droppedRecords, HAL_GetTick() };
+        UnlockFrameworkState();
+        droppedRecords = 0;
+        CommitFrameworkState();
+        __set_PRIMASK(primask);
+
+        AppendLogRecord(LOG_RECORD_DROPPED, 0, testCycleCounter, payload, 2);
+    }
+
+    while (queueTail != queueHead) {
+        LogQueueEntry* entry = &logQueue[queueTail];
+        uint32_t lengthDwords = (entry->words[0] >> 8) & 0xFF;
+
+        /* Roll over to the next page once it has been erased */
+        if (writeOffset + lengthDwords * 8 > FLASH_PAGE_SIZE) {
+            if (nextPageState != LOG_PAGE_READY) {
+                StartNextPageErase();
+                break;
+            }
+            ActivateNextPage();
+            continue;
+        }
+
+        /* Stop when the next record would overrun this cycle's budget */
+        if ((GET_CYCLE_COUNT() - start) + lengthDwords * programCyclesPerDword > budget) {
+            budgetDeferrals++;
+            break;
+        }
+
+        uint32_t address = GetLogPageAddress(activePage) + writeOffset;
+        for (uint32_t i = 0; i < lengthDwords; i++) {
+            if (ProgramLogDword(address + i * 8, entry->dwords[i]) != HAL_OK) {
+                programFailures++;
+                break;
+            }
+        }
+
+        /* A failed record is left torn and skipped when read back */
+        writeOffset += lengthDwords * 8;
+        recordsWritten++;
+        UnlockFrameworkState();
+        queueTail = (queueTail + 1) % LOG_QUEUE_DEPTH;
+        CommitFrameworkState();
+    }
+
+    /* Erase ahead so rollover never waits for a 20+ ms page erase */
+    if (nextPageState == LOG_PAGE_UNKNOWN && writeOffset >= LOG_PREERASE_OFFSET) {
+        StartNextPageErase();
+    }
+
+    HAL_FLASH_Lock();
+}
+
+/**
+  * @brief  Report persistent log position and statistics
+  */
+void ReportPersistentLogStatus(void)
+{
+    char buffer[200];
+
+    snprintf(buffer, sizeof(buffer),
+             "Log: page=%lu seq=%lu offset=%lu written=%lu queued=%lu dropped=%lu "
+             "deferred=%lu erases=%lu fails=%lu torn=%lu program=%luus/dword\r\n",
+             activePage, activeSequence, writeOffset, recordsWritten,
+             (queueHead + LOG_QUEUE_DEPTH - queueTail) % LOG_QUEUE_DEPTH,
+             droppedRecords, budgetDeferrals, pagesErased, programFailures,
+             tornRecords, CYCLES_TO_US(programCyclesPerDword));
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,460 @@
+/**
+ * Power-On Self-Test for STM32G473CB Memory Test
+ *
+ * Runs from SystemInit(), which Reset_Handler calls before .data is copied
+ * and .bss is cleared, so memory health is known before main() brings up
+ * anything that drives the outside world. Nothing here may rely on
+ * initialized RAM: the only state is on the stack and in the result block,
+ * which lives in .noinit and is handed to main() as-is.
+ *
+ * The test raises SYSCLK to 170MHz on the PLL, then runs a data-bus test
+ * and an address-bus test on each SRAM region, a CRC of the flash image
+ * against the reference a post-build step stores after it, and a reduced
+ * March C- over all SRAM apart from the running stack and the result
+ * block. The budget is checked between steps and between March chunks;
+ * whatever has not run when it expires is left out of completedSteps.
+ * The clocks are handed back as reset left them, for SystemClock_Config().
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Linker script symbols */
+extern uint8_t _estack;
+extern uint32_t _snoinit;
+extern uint32_t _enoinit;
+
+/* Clocks: HSI16 out of reset, PLL = 16MHz / 4 * 85 / 2 = 170MHz */
+#define POST_HSI_MHZ          16
+#define POST_PLL_MHZ          170
+#define POST_PLL_M            4
+#define POST_PLL_N            85
+
+/* Stack below the entry SP left out of the test */
+#define POST_STACK_RESERVE    0x200
+
+/* SRAM marched between budget checks */
+#define POST_MARCH_CHUNK      0x800
+
+/* Result block is valid when it carries this */
+#define POST_RESULT_MAGIC     0x504F5354U
+
+/* Bus test patterns */
+#define POST_PATTERN          0xAAAAAAAAU
+#define POST_ANTIPATTERN      0x55555555U
+
+/* Handed to main() through .noinit */
+typedef struct {
+    uint32_t magic;
+    uint32_t completedSteps;        /* POST_STEP_* bits that ran to the end */
+    uint32_t failedSteps;           /* POST_STEP_* bits that found an error */
+    uint32_t errorCount;
+    uint32_t firstErrorAddress;
+    uint32_t firstErrorRead;
+    uint32_t firstErrorExpected;
+    uint32_t flashCrc;
+    uint32_t flashReference;
+    uint32_t marchBytes;            /* SRAM covered by the March */
+    uint32_t elapsedUs;
+    uint32_t budgetUs;
+} PostResult;
+
+/* Range left out of every SRAM step */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} PostExclusion;
+
+#define POST_NUM_EXCLUSIONS   2
+
+/* Working state, on the stack */
+typedef struct {
+    PostResult* result;
+    PostExclusion exclusions[POST_NUM_EXCLUSIONS];
+    uint32_t startCycles;
+    uint32_t budgetCycles;
+    uint32_t expired;
+} PostContext;
+
+/* Function prototypes */
+void PowerOnSelfTest(void);
+uint32_t IsPostPassed(void);
+void GetPostSteps(uint32_t* completedSteps, uint32_t* failedSteps);
+void ReportPostResult(void);
+
+/* Written before .data and .bss exist, read by main() */
+__attribute__((section(".noinit"))) static PostResult postResult;
+
+/* Post-build step writes the image CRC here; the linker places it last */
+__attribute__((section(".postcrc"), used)) const uint32_t postFlashReference = 0xFFFFFFFFU;
+
+/* SRAM regions, in the order the March covers them */
+static const uint32_t postRegionStart[] = { SRAM1_START_ADDR, SRAM2_START_ADDR, CCM_SRAM_START_ADDR };
+static const uint32_t postRegionSize[] = { SRAM1_SIZE, SRAM2_SIZE, CCM_SRAM_SIZE };
+static const uint32_t postMarchStep[] = { POST_STEP_MARCH_SRAM1, POST_STEP_MARCH_SRAM2, POST_STEP_MARCH_CCM };
+#define POST_NUM_REGIONS      (sizeof(postRegionStart) / sizeof(postRegionStart[0]))
+
+/**
+  * @brief  Move SYSCLK from HSI16 to the PLL at 170MHz
+  */
+static void PostClockUp(void)
+{
+    /* Range 1 boost mode and four wait states for 170MHz */
+    RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+    (void)RCC->APB1ENR1;
+    PWR->CR5 &= ~PWR_CR5_R1MODE;
+    FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | FLASH_ACR_LATENCY_4WS;
+    while ((FLASH->ACR & FLASH_ACR_LATENCY) != FLASH_ACR_LATENCY_4WS) {
+    }
+
+    RCC->PLLCFGR = RCC_PLLCFGR_PLLSRC_HSI | ((POST_PLL_M - 1) << RCC_PLLCFGR_PLLM_Pos) |
+                   (POST_PLL_N << RCC_PLLCFGR_PLLN_Pos) | RCC_PLLCFGR_PLLREN;
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY)) {
+    }
+
+    /* Step through AHB/2 for 1us, as the reference manual asks above 80MHz */
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_HPRE | RCC_CFGR_SW)) | RCC_CFGR_HPRE_DIV2 | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {
+    }
+    uint32_t start = DWT->CYCCNT;
+    while (DWT->CYCCNT - start < POST_PLL_MHZ / 2) {
+    }
+    RCC->CFGR &= ~RCC_CFGR_HPRE;
+}
+
+/**
+  * @brief  Put the clocks back as reset left them
+  */
+static void PostClockDown(void)
+{
+    RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_HPRE | RCC_CFGR_SW)) | RCC_CFGR_HPRE_DIV2 | RCC_CFGR_SW_HSI;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI) {
+    }
+    RCC->CFGR &= ~RCC_CFGR_HPRE;
+
+    RCC->CR &= ~RCC_CR_PLLON;
+    while (RCC->CR & RCC_CR_PLLRDY) {
+    }
+    RCC->PLLCFGR = RCC_PLLCFGR_PLLN_4;
+
+    FLASH->ACR &= ~FLASH_ACR_LATENCY;
+    PWR->CR5 |= PWR_CR5_R1MODE;
+    RCC->APB1ENR1 &= ~RCC_APB1ENR1_PWREN;
+}
+
+/**
+  * @brief  Check the budget
+  * @retval 1 once the budget has run out; stays set
+  */
+static uint32_t PostExpired(PostContext* ctx)
+{
+    if (!ctx->expired && DWT->CYCCNT - ctx->startCycles >= ctx->budgetCycles) {
+        ctx->expired = 1;
+    }
+    IWDG->KR = IWDG_KEY_RELOAD;
+    return ctx->expired;
+}
+
+/**
+  * @brief  Check whether a word is left out of the test
+  */
+static uint32_t PostExcluded(PostContext* ctx, uint32_t addr)
+{
+    for (uint32_t i = 0; i < POST_NUM_EXCLUSIONS; i++) {
+        if (addr >= ctx->exclusions[i].start && addr < ctx->exclusions[i].end) return 1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Note a failing word against a step
+  */
+static void PostError(PostContext* ctx, uint32_t step, uint32_t addr, uint32_t readValue, uint32_t expected)
+{
+    PostResult* result = ctx->result;
+
+    if (result->errorCount == 0) {
+        result->firstErrorAddress = addr;
+        result->firstErrorRead = readValue;
+        result->firstErrorExpected = expected;
+    }
+    result->errorCount++;
+    result->failedSteps |= step;
+}
+
+/**
+  * @brief  Walk a one and a zero through every data line of one word
+  * @param  addr: Word to test
+  */
+static void PostDataBusTest(PostContext* ctx, volatile uint32_t* addr)
+{
+    for (uint32_t bit = 0; bit < 32; bit++) {
+        uint32_t value = 1U << bit;
+        uint32_t readValue;
+
+        *addr = value;
+        if ((readValue = *addr) != value) PostError(ctx, POST_STEP_DATA_BUS, (uint32_t)addr, readValue, value);
+        *addr = ~value;
+        if ((readValue = *addr) != ~value) PostError(ctx, POST_STEP_DATA_BUS, (uint32_t)addr, readValue, ~value);
+    }
+    *addr = 0;
+}
+
+/**
+  * @brief  Check each address line of a region for stuck and shorted bits
+  * @param  base: Region start
+  * @param  size: Region size; offsets run through the powers of two below it
+  * @note   Offsets that fall in an excluded range are left out.
+  */
+static void PostAddressBusTest(PostContext* ctx, uint32_t base, uint32_t size)
+{
+    volatile uint32_t* baseWord = (volatile uint32_t*)base;
+    uint32_t readValue;
+
+    /* Every address line, one offset each */
+    for (uint32_t offset = 4; offset < size; offset <<= 1) {
+        if (PostExcluded(ctx, base + offset)) continue;
+        *(volatile uint32_t*)(base + offset) = POST_PATTERN;
+    }
+
+    /* Stuck high: the base write must not reach any other offset */
+    *baseWord = POST_ANTIPATTERN;
+    for (uint32_t offset = 4; offset < size; offset <<= 1) {
+        if (PostExcluded(ctx, base + offset)) continue;
+        if ((readValue = *(volatile uint32_t*)(base + offset)) != POST_PATTERN) {
+            PostError(ctx, POST_STEP_ADDRESS_BUS, base + offset, readValue, POST_PATTERN);
+        }
+    }
+    *baseWord = POST_PATTERN;
+
+    /* Stuck low and shorted: each offset's write must reach only itself */
+    for (uint32_t test = 4; test < size; test <<= 1) {
+        if (PostExcluded(ctx, base + test)) continue;
+        *(volatile uint32_t*)(base + test) = POST_ANTIPATTERN;
+
+        if ((readValue = *baseWord) != POST_PATTERN) {
+            PostError(ctx, POST_STEP_ADDRESS_BUS, base, readValue, POST_PATTERN);
+        }
+        for (uint32_t offset = 4; offset < size; offset <<= 1) {
+            if (offset == test || PostExcluded(ctx, base + offset)) continue;
+            if ((readValue = *(volatile uint32_t*)(base + offset)) != POST_PATTERN) {
+                PostError(ctx, POST_STEP_ADDRESS_BUS, base + offset, readValue, POST_PATTERN);
+            }
+        }
+
+        *(volatile uint32_t*)(base + test) = POST_PATTERN;
+    }
+}
+
+/**
+  * @brief  Reduced March C- over a range: up(w0); up(r0,w1); down(r1,w0); up(r0)
+  * @param  start: First word
+  * @param  end: Address just past the last word
+  * @param  step: POST_STEP_* bit to charge errors to
+  * @note   Leaves the range zeroed, which also gives parity-checked words
+  *         valid parity before anything reads them.
+  */
+static void PostMarchWords(PostContext* ctx, uint32_t start, uint32_t end, uint32_t step)
+{
+    volatile uint32_t* words = (volatile uint32_t*)start;
+    uint32_t count = (end - start) / 4;
+    uint32_t value;
+
+    for (uint32_t i = 0; i < count; i++) {
+        words[i] = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if ((value = words[i]) != 0) PostError(ctx, step, (uint32_t)&words[i], value, 0);
+        words[i] = 0xFFFFFFFF;
+    }
+    for (uint32_t i = count; i-- > 0; ) {
+        if ((value = words[i]) != 0xFFFFFFFF) PostError(ctx, step, (uint32_t)&words[i], value, 0xFFFFFFFF);
+        words[i] = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if ((value = words[i]) != 0) PostError(ctx, step, (uint32_t)&words[i], value, 0);
+    }
+
+    ctx->result->marchBytes += end - start;
+}
+
+/**
+  * @brief  March a range, stepping around the excluded ranges
+  */
+static void PostMarchRange(PostContext* ctx, uint32_t start, uint32_t end, uint32_t step)
+{
+    for (uint32_t i = 0; i < POST_NUM_EXCLUSIONS; i++) {
+        PostExclusion* exclusion = &ctx->exclusions[i];
+        if (exclusion->start >= end || exclusion->end <= start) continue;
+
+        if (exclusion->start > start) PostMarchRange(ctx, start, exclusion->start, step);
+        if (exclusion->end < end) PostMarchRange(ctx, exclusion->end, end, step);
+        return;
+    }
+
+    if (end > start) PostMarchWords(ctx, start, end, step);
+}
+
+/**
+  * @brief  CRC the flash image with the CRC unit and compare with the reference
+  */
+static void PostFlashCrc(PostContext* ctx)
+{
+    const volatile uint32_t* word = (const volatile uint32_t*)FLASH_START_ADDR;
+    const volatile uint32_t* end = (const volatile uint32_t*)&postFlashReference;
+    uint32_t reference = *end;
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    (void)RCC->AHB1ENR;
+    CRC->CR |= CRC_CR_RESET;
+
+    while (word < end) {
+        CRC->DR = *word++;
+        if (((uint32_t)word & 0x3FFF) == 0 && PostExpired(ctx)) break;
+    }
+
+    ctx->result->flashCrc = CRC->DR;
+    ctx->result->flashReference = reference;
+    RCC->AHB1ENR &= ~RCC_AHB1ENR_CRCEN;
+
+    if (word < end) return;
+
+    /* An image that was never stamped has nothing to compare against */
+    if (reference != 0xFFFFFFFFU && ctx->result->flashCrc != reference) {
+        ctx->result->failedSteps |= POST_STEP_FLASH_CRC;
+    }
+    ctx->result->completedSteps |= POST_STEP_FLASH_CRC;
+}
+
+/**
+  * @brief  Test memory before main(); called at the end of SystemInit()
+  * @note   Must not touch .data or .bss, which are not set up yet.
+  */
+void PowerOnSelfTest(void)
+{
+    PostContext ctx;
+    PostResult* result = &postResult;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    memset(result, 0, sizeof(PostResult));
+    result->budgetUs = POST_BUDGET_MS * 1000;
+
+    PostClockUp();
+    uint32_t clockUpUs = DWT->CYCCNT / POST_HSI_MHZ;
+
+    ctx.result = result;
+    ctx.startCycles = DWT->CYCCNT;
+    ctx.budgetCycles = (result->budgetUs > clockUpUs) ? (result->budgetUs - clockUpUs) * POST_PLL_MHZ : 0;
+    ctx.expired = 0;
+    ctx.exclusions[0].start = (__get_MSP() - POST_STACK_RESERVE) & ~0x1FU;
+    ctx.exclusions[0].end = (uint32_t)&_estack;
+    ctx.exclusions[1].start = (uint32_t)&_snoinit & ~0x3U;
+    ctx.exclusions[1].end = ((uint32_t)&_enoinit + 3) & ~0x3U;
+
+    /* Bus tests first - a bus fault makes everything after it meaningless */
+    for (uint32_t region = 0; region < POST_NUM_REGIONS; region++) {
+        uint32_t addr = postRegionStart[region];
+        while (addr < postRegionStart[region] + postRegionSize[region] && PostExcluded(&ctx, addr)) addr += 4;
+        PostDataBusTest(&ctx, (volatile uint32_t*)addr);
+    }
+    result->completedSteps |= POST_STEP_DATA_BUS;
+
+    for (uint32_t region = 0; region < POST_NUM_REGIONS && !PostExpired(&ctx); region++) {
+        if (PostExcluded(&ctx, postRegionStart[region])) continue;
+        PostAddressBusTest(&ctx, postRegionStart[region], postRegionSize[region]);
+    }
+    if (!ctx.expired) result->completedSteps |= POST_STEP_ADDRESS_BUS;
+
+    if (!PostExpired(&ctx)) PostFlashCrc(&ctx);
+
+    for (uint32_t region = 0; region < POST_NUM_REGIONS && !ctx.expired; region++) {
+        uint32_t end = postRegionStart[region] + postRegionSize[region];
+
+        for (uint32_t chunk = postRegionStart[region]; chunk < end; chunk += POST_MARCH_CHUNK) {
+            if (PostExpired(&ctx)) break;
+            PostMarchRange(&ctx, chunk, chunk + POST_MARCH_CHUNK, postMarchStep[region]);
+        }
+        if (!ctx.expired) result->completedSteps |= postMarchStep[region];
+    }
+
+    result->elapsedUs = clockUpUs + (DWT->CYCCNT - ctx.startCycles) / POST_PLL_MHZ;
+    PostClockDown();
+    result->magic = POST_RESULT_MAGIC;
+}
+
+/**
+  * @brief  Check the POST verdict, for code that gates outputs on it
+  * @retval 1 if every step ran and none failed
+  */
+uint32_t IsPostPassed(void)
+{
+    return postResult.magic == POST_RESULT_MAGIC &&
+           postResult.completedSteps == POST_STEP_ALL &&
+           postResult.failedSteps == 0;
+}
+
+/**
+  * @brief  Get the POST steps that ran and the ones that failed
+  * @param  completedSteps: Receives the POST_STEP_* bits that ran to the end
+  * @param  failedSteps: Receives the POST_STEP_* bits that found an error
+  */
+void GetPostSteps(uint32_t* completedSteps, uint32_t* failedSteps)
+{
+    if (postResult.magic != POST_RESULT_MAGIC) {
+        *completedSteps = 0;
+        *failedSteps = 0;
+        return;
+    }
+
+    *completedSteps = postResult.completedSteps;
+    *failedSteps = postResult.failedSteps;
+}
+
+/**
+  * @brief  Report the POST result, and charge its errors to the failing region
+  * @note   Call once quarantine is set up.
+  */
+void ReportPostResult(void)
+{
+    char buffer[256];
+
+    if (postResult.magic != POST_RESULT_MAGIC) {
+        char missing[] = "POST: no result - the self-test did not run before main\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)missing, strlen(missing), 1000);
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "POST: %s in %luus of %luus budget, steps done=0x%02lX failed=0x%02lX, March %luKB, "
+             "flash CRC=0x%08lX ref=0x%08lX\r\n",
+             IsPostPassed() ? "PASS" : "FAIL", postResult.elapsedUs, postResult.budgetUs,
+             postResult.completedSteps, postResult.failedSteps, postResult.marchBytes / 1024,
+             postResult.flashCrc, postResult.flashReference);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    if (postResult.errorCount == 0) return;
+
+    snprintf(buffer, sizeof(buffer),
+             "POST: %lu errors, first at 0x%08lX read 0x%08lX expected 0x%08lX\r\n",
+             postResult.errorCount, postResult.firstErrorAddress,
+             postResult.firstErrorRead, postResult.firstErrorExpected);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    uint32_t region = GetRegionForAddress(postResult.firstErrorAddress);
+    if (region != REGION_NONE) {
+        GetRegionStatus(region)->totalErrors += postResult.errorCount;
+        if (!IsAddressQuarantined(postResult.firstErrorAddress)) {
+            QuarantineAddress(postResult.firstErrorAddress);
+        }
+    }
+}
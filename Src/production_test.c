@@ -0,0 +1,287 @@
+/**
+ * Production Go/No-Go Pass for STM32G473CB Memory Test
+ *
+ * The end-of-line tester needs a yes/no answer per board, not a stream of
+ * logs. Production mode is selected by the boot pin, sampled during
+ * InitializeTests(), or by the PROD command. It makes one pass at the
+ * fastest clock: every SRAM region's free memory gets an address-in-data
+ * pattern and its inverse, written and verified in four-word bursts, and
+ * the flash below the reserved pages goes through the CRC unit. Every
+ * word read back in the SRAM verify passes is also fed to the CRC unit,
+ * so each region gets a signature that only a board reading back exactly
+ * what was written can match. The POST verdict from before main() is
+ * folded in. The result goes out as one framed line, checksummed so the
+ * tester can reject a garbled frame, and the firmware then halts with the
+ * watchdog fed until power is removed.
+ *
+ * Frame: $GONOGO,<PASS|FAIL>,post=<steps>/<failed>,clk=<MHz>,
+ *        <region>=<errors>:<signature>:<us>,...,first=<addr>,total=<us>*<crc>
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Fastest clock: HSI16 / 4 * 85 / 2 = 170MHz in range 1 boost mode */
+#define PRODUCTION_SYSCLK_HZ  170000000U
+
+/* Address-in-data pattern; the second pass stores its inverse */
+#define PRODUCTION_PATTERN    0xA5C3F00FU
+
+/* Field names in the frame, indexed by region */
+static const char* const productionTags[NUM_TEST_REGIONS] = { "FLASH", "SRAM1", "SRAM2", "CCM" };
+
+/* Per region */
+typedef struct {
+    uint32_t errors;
+    uint32_t signature;
+    uint32_t cycles;
+    uint32_t bytes;
+} ProductionRegionResult;
+
+/* Function prototypes */
+uint32_t IsProductionPinAsserted(void);
+void RunProductionTest(void);
+
+/**
+  * @brief  Sample the production boot pin
+  * @retval 1 if the pin selects production mode
+  */
+uint32_t IsProductionPinAsserted(void)
+{
+    GPIO_InitTypeDef gpioInit = {0};
+
+    PRODUCTION_PIN_CLK_ENABLE();
+    gpioInit.Pin = PRODUCTION_PIN;
+    gpioInit.Mode = GPIO_MODE_INPUT;
+    gpioInit.Pull = GPIO_PULLDOWN;
+    HAL_GPIO_Init(PRODUCTION_PIN_PORT, &gpioInit);
+
+    /* Let the pull-down settle before sampling */
+    HAL_Delay(1);
+
+    return HAL_GPIO_ReadPin(PRODUCTION_PIN_PORT, PRODUCTION_PIN) == GPIO_PIN_SET;
+}
+
+/**
+  * @brief  Move SYSCLK to 170MHz if it is not there already
+  * @note   USART2 is re-initialized so its baud rate follows PCLK1.
+  */
+static void SelectProductionClock(void)
+{
+    RCC_OscInitTypeDef oscInit = {0};
+    RCC_ClkInitTypeDef clkInit = {0};
+
+    if (SystemCoreClock >= PRODUCTION_SYSCLK_HZ) return;
+
+    HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1_BOOST);
+
+    oscInit.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    oscInit.HSIState = RCC_HSI_ON;
+    oscInit.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    oscInit.PLL.PLLState = RCC_PLL_ON;
+    oscInit.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+    oscInit.PLL.PLLM = RCC_PLLM_DIV4;
+    oscInit.PLL.PLLN = 85;
+    oscInit.PLL.PLLP = RCC_PLLP_DIV2;
+    oscInit.PLL.PLLQ = RCC_PLLQ_DIV2;
+    oscInit.PLL.PLLR = RCC_PLLR_DIV2;
+
+    /* A PLL already driving SYSCLK can't be reprogrammed - run as we are */
+    if (HAL_RCC_OscConfig(&oscInit) != HAL_OK) return;
+
+    clkInit.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clkInit.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+    clkInit.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clkInit.APB1CLKDivider = RCC_HCLK_DIV1;
+    clkInit.APB2CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&clkInit, FLASH_LATENCY_4) != HAL_OK) return;
+
+    HAL_UART_Init(&huart2);
+}
+
+/**
+  * @brief  Write one pass of the address-in-data pattern over a range
+  * @param  start: First word, 16-byte aligned
+  * @param  end: Address just past the last word, 16-byte aligned
+  * @param  mask: XORed into every value, 0 or all ones
+  */
+static void WriteProductionPass(uint32_t start, uint32_t end, uint32_t mask)
+{
+    for (uint32_t addr = start; addr < end; addr += 16) {
+        volatile uint32_t* words = (volatile uint32_t*)addr;
+        uint32_t value = (addr ^ PRODUCTION_PATTERN) ^ mask;
+        words[0] = value;
+        words[1] = value ^ 0x4;
+        words[2] = value ^ 0x8;
+        words[3] = value ^ 0xC;
+    }
+}
+
+/**
+  * @brief  Verify one pass, feeding every word read into the CRC unit
+  * @param  start: First word, 16-byte aligned
+  * @param  end: Address just past the last word, 16-byte aligned
+  * @param  mask: XORed into every value, 0 or all ones
+  * @param  result: Region result; errors are counted here
+  * @param  firstError: Set to the first failing word if still 0
+  */
+static void VerifyProductionPass(uint32_t start, uint32_t end, uint32_t mask,
+                                 ProductionRegionResult* result, uint32_t* firstError)
+{
+    for (uint32_t addr = start; addr < end; addr += 16) {
+        volatile uint32_t* words = (volatile uint32_t*)addr;
+        uint32_t value = (addr ^ PRODUCTION_PATTERN) ^ mask;
+        uint32_t read0 = words[0];
+        uint32_t read1 = words[1];
+        uint32_t read2 = words[2];
+        uint32_t read3 = words[3];
+
+        CRC->DR = read0;
+        CRC->DR = read1;
+        CRC->DR = read2;
+        CRC->DR = read3;
+
+        if (read0 != value || read1 != (value ^ 0x4) || read2 != (value ^ 0x8) || read3 != (value ^ 0xC)) {
+            for (uint32_t i = 0; i < 4; i++) {
+                if (words[i] == (value ^ (i * 4))) continue;
+                result->errors++;
+                if (*firstError == 0) *firstError = addr + i * 4;
+            }
+        }
+    }
+}
+
+/**
+  * @brief  Test one SRAM region's free memory at full speed
+  * @param  region: Region identifier
+  * @param  result: Filled with the region's errors, signature and time
+  * @param  firstError: Set to the first failing word if still 0
+  */
+static void RunProductionRegion(uint32_t region, ProductionRegionResult* result, uint32_t* firstError)
+{
+    uint32_t boundsStart, boundsEnd;
+    GetRegionTestBounds(region, &boundsStart, &boundsEnd);
+
+    uint32_t start = (boundsStart + 15) & ~0xFU;
+    uint32_t end = boundsEnd & ~0xFU;
+    if (end <= start) return;
+
+    uint32_t cycles = GET_CYCLE_COUNT();
+
+    CRC->CR |= CRC_CR_RESET;
+    WriteProductionPass(start, end, 0);
+    VerifyProductionPass(start, end, 0, result, firstError);
+    WriteProductionPass(start, end, 0xFFFFFFFF);
+    VerifyProductionPass(start, end, 0xFFFFFFFF, result, firstError);
+    result->signature = CRC->DR;
+
+    result->cycles = GET_CYCLE_COUNT() - cycles;
+    result->bytes = end - start;
+}
+
+/**
+  * @brief  Signature of the flash below the reserved pages
+  * @param  result: Filled with the signature and time
+  */
+static void RunProductionFlash(ProductionRegionResult* result)
+{
+    const uint32_t* word = (const uint32_t*)FLASH_START_ADDR;
+    const uint32_t* end = (const uint32_t*)FLASH_RESERVED_START;
+    uint32_t cycles = GET_CYCLE_COUNT();
+
+    CRC->CR |= CRC_CR_RESET;
+    while (word < end) {
+        CRC->DR = word[0];
+        CRC->DR = word[1];
+        CRC->DR = word[2];
+        CRC->DR = word[3];
+        word += 4;
+    }
+    result->signature = CRC->DR;
+
+    result->cycles = GET_CYCLE_COUNT() - cycles;
+    result->bytes = FLASH_RESERVED_START - FLASH_START_ADDR;
+}
+
+/**
+  * @brief  Checksum of a frame, between the '$' and the '*'
+  * @param  frame: Frame text, starting with '$'
+  * @param  length: Characters before the '*'
+  * @retval XOR of the characters
+  */
+static uint8_t FrameChecksum(const char* frame, int length)
+{
+    uint8_t checksum = 0;
+
+    for (int i = 1; i < length; i++) {
+        checksum ^= (uint8_t)frame[i];
+    }
+    return checksum;
+}
+
+/**
+  * @brief  Run the production pass, send the summary frame and halt
+  * @note   Does not return. Test windows are left open and nothing else
+  *         runs, so the pass owns every region's free memory.
+  */
+void RunProductionTest(void)
+{
+    ProductionRegionResult results[NUM_TEST_REGIONS];
+    uint32_t firstError = 0;
+    uint32_t totalErrors = 0;
+    char frame[256];
+
+    memset(results, 0, sizeof(results));
+
+    SelectProductionClock();
+    ENABLE_CYCLE_COUNTER();
+    __HAL_RCC_CRC_CLK_ENABLE();
+    PauseEnvironmentMonitor();
+    OpenTestWindows(GUARD_ALL_WINDOWS);
+
+    uint32_t start = GET_CYCLE_COUNT();
+
+    for (uint32_t region = REGION_SRAM1; region < NUM_TEST_REGIONS; region++) {
+        RunProductionRegion(region, &results[region], &firstError);
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+    RunProductionFlash(&results[REGION_FLASH]);
+
+    uint32_t totalCycles = GET_CYCLE_COUNT() - start;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS; region++) {
+        totalErrors += results[region].errors;
+    }
+    uint32_t pass = (totalErrors == 0) && IsPostPassed();
+    uint32_t postSteps = 0, postFailed = 0;
+    GetPostSteps(&postSteps, &postFailed);
+
+    /* One line: verdict, POST steps, clock, then each region */
+    int length = snprintf(frame, sizeof(frame), "$GONOGO,%s,post=%02lX/%02lX,clk=%lu",
+                          pass ? "PASS" : "FAIL", postSteps, postFailed, SystemCoreClock / 1000000);
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(frame); region++) {
+        length += snprintf(frame + length, sizeof(frame) - length, ",%s=%lu:%08lX:%lu",
+                           productionTags[region], results[region].errors, results[region].signature,
+                           CYCLES_TO_US(results[region].cycles));
+    }
+    if (length < (int)sizeof(frame)) {
+        length += snprintf(frame + length, sizeof(frame) - length, ",first=%08lX,total=%lu",
+                           firstError, CYCLES_TO_US(totalCycles));
+    }
+    if (length < (int)sizeof(frame) - 6) {
+        snprintf(frame + length, sizeof(frame) - length, "*%02X\r\n", FrameChecksum(frame, length));
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)frame, strlen(frame), 1000);
+
+    /* Halt - keep the watchdog from restarting the pass */
+    __disable_irq();
+    for (;;) {
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+}
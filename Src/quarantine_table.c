@@ -0,0 +1,448 @@
+/**
+ * Bad-Address Quarantine Table for STM32G473CB Memory Test
+ *
+ * Keeps a fixed-capacity, hash-indexed table of failing SRAM words and blocks.
+ * A per-block bitmap answers "is anything in this block quarantined" with one
+ * bit test, so verify loops only touch the hash table for suspect blocks.
+ * Entries are appended to a reserved flash page so the table survives resets,
+ * and the application can query it to keep its allocator off bad memory.
+ * When the page fills, it is erased and the live table rewritten into it.
+ * One range at a time can be exempted from the lookups, so a block that is
+ * being characterized is tested in full, known-bad words included.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+
+/* Table geometry */
+#define QUARANTINE_HASH_SIZE     256       /* Power of two, twice the capacity */
+#define QUARANTINE_HASH_MASK     (QUARANTINE_HASH_SIZE - 1)
+#define QUARANTINE_BLOCK_FLAG    0x1U      /* Set in bit 0 for whole-block entries */
+#define QUARANTINE_ENTRY_MAGIC   0x51544E45U  /* "QTNE", upper word of a flash entry */
+#define QUARANTINE_FLASH_SLOTS   (FLASH_PAGE_SIZE / 8)
+#define QUARANTINE_PERSIST_BATCH 8         /* Max entries programmed per service call */
+
+/* Bitmap layout - SRAM regions only, flash is tracked by ECC instead */
+#define QBLOCKS_SRAM1            (SRAM1_SIZE / QUARANTINE_BLOCK_SIZE)
+#define QBLOCKS_SRAM2            (SRAM2_SIZE / QUARANTINE_BLOCK_SIZE)
+#define QBLOCKS_CCM              (CCM_SRAM_SIZE / QUARANTINE_BLOCK_SIZE)
+#define QBLOCKS_TOTAL            (QBLOCKS_SRAM1 + QBLOCKS_SRAM2 + QBLOCKS_CCM)
+#define QBLOCK_NONE              0xFFFFFFFFU
+
+/* Function prototypes */
+void InitializeQuarantine(void);
+void QuarantineAddress(uint32_t address);
+uint32_t IsAddressQuarantined(uint32_t address);
+uint32_t IsRangeQuarantined(uint32_t startAddr, uint32_t size);
+void SetQuarantineExemption(uint32_t startAddr, uint32_t size);
+uint32_t IsQuarantineExempt(uint32_t address);
+void StartQuarantineCursor(QuarantineCursor* cursor);
+uint32_t SkipQuarantinedWord(QuarantineCursor* cursor, uint32_t address);
+uint32_t GetQuarantineCount(void);
+uint32_t GetQuarantineEntry(uint32_t index, uint32_t* address, uint32_t* isBlock);
+void ClearQuarantine(void);
+void ServiceQuarantine(void);
+void ReportQuarantineStatus(void);
+
+/* The table lives in the framework state pages, so a stray kernel write
+   can't unquarantine a word. Init and clear run outside any window. */
+
+/* Entries in insertion order (word address, or block address | QUARANTINE_BLOCK_FLAG) */
+FRAMEWORK_STATE static uint32_t quarantineList[QUARANTINE_CAPACITY];
+FRAMEWORK_STATE static uint32_t quarantineCount;
+
+/* Open-addressed hash of list index + 1, 0 = empty slot */
+FRAMEWORK_STATE static uint8_t quarantineHash[QUARANTINE_HASH_SIZE];
+
+/* One bit per block: something in the block is quarantined */
+FRAMEWORK_STATE static uint32_t quarantineBitmap[(QBLOCKS_TOTAL + 31) / 32];
+
+/* Persistence state */
+static uint32_t persistedCount = 0;
+static uint32_t flashSlotsUsed = 0;
+static uint32_t overflowCount = 0;
+static uint32_t programFailures = 0;
+static uint32_t compactions = 0;
+
+/* Range the lookups ignore, size 0 for none */
+static uint32_t exemptStart = 0;
+static uint32_t exemptSize = 0;
+
+/**
+  * @brief  Map an address to its bit in the quarantine bitmap
+  * @param  address: SRAM address
+  * @retval Block index, or QBLOCK_NONE outside the SRAM regions
+  */
+static uint32_t GetQuarantineBlockIndex(uint32_t address)
+{
+    if (address - SRAM1_START_ADDR < SRAM1_SIZE) {
+        return (address - SRAM1_START_ADDR) / QUARANTINE_BLOCK_SIZE;
+    }
+    if (address - SRAM2_START_ADDR < SRAM2_SIZE) {
+        return QBLOCKS_SRAM1 + (address - SRAM2_START_ADDR) / QUARANTINE_BLOCK_SIZE;
+    }
+    if (address - CCM_SRAM_START_ADDR < CCM_SRAM_SIZE) {
+        return QBLOCKS_SRAM1 + QBLOCKS_SRAM2 + (address - CCM_SRAM_START_ADDR) / QUARANTINE_BLOCK_SIZE;
+    }
+    return QBLOCK_NONE;
+}
+
+/**
+  * @brief  Hash a table key
+  * @param  key: Word address or flagged block address
+  * @retval Starting hash slot
+  */
+static uint32_t HashQuarantineKey(uint32_t key)
+{
+    /* Fibonacci hashing on the word index */
+    return ((key >> 2) * 2654435761U) >> 24;
+}
+
+/**
+  * @brief  Look up a key in the hash table
+  * @param  key: Word address or flagged block address
+  * @retval 1 if present, 0 otherwise
+  */
+static uint32_t FindQuarantineKey(uint32_t key)
+{
+    uint32_t slot = HashQuarantineKey(key);
+
+    for (uint32_t probe = 0; probe < QUARANTINE_HASH_SIZE; probe++) {
+        uint8_t entry = quarantineHash[slot];
+        if (entry == 0) return 0;
+        if (quarantineList[entry - 1] == key) return 1;
+        slot = (slot + 1) & QUARANTINE_HASH_MASK;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Insert a key into the list, hash table and bitmap
+  * @param  key: Word address or flagged block address
+  * @retval 1 if added, 0 if the table is full
+  */
+static uint32_t AddQuarantineKey(uint32_t key)
+{
+    if (quarantineCount >= QUARANTINE_CAPACITY) {
+        overflowCount++;
+        return 0;
+    }
+
+    uint32_t block = GetQuarantineBlockIndex(key & ~QUARANTINE_BLOCK_FLAG);
+    if (block == QBLOCK_NONE) return 0;
+
+    uint32_t slot = HashQuarantineKey(key);
+    while (quarantineHash[slot] != 0) {
+        slot = (slot + 1) & QUARANTINE_HASH_MASK;
+    }
+
+    UnlockFrameworkState();
+    quarantineList[quarantineCount] = key;
+    quarantineCount++;
+    quarantineHash[slot] = (uint8_t)quarantineCount;
+    quarantineBitmap[block / 32] |= 1U << (block % 32);
+    CommitFrameworkState();
+
+    return 1;
+}
+
+/**
+  * @brief  Rebuild the table from its flash page after a reset
+  */
+void InitializeQuarantine(void)
+{
+    const uint32_t* words = (const uint32_t*)FLASH_QUARANTINE_ADDR;
+
+    memset(quarantineHash, 0, sizeof(quarantineHash));
+    memset(quarantineBitmap, 0, sizeof(quarantineBitmap));
+    quarantineCount = 0;
+    overflowCount = 0;
+
+    for (flashSlotsUsed = 0; flashSlotsUsed < QUARANTINE_FLASH_SLOTS; flashSlotsUsed++) {
+        uint32_t key = words[flashSlotsUsed * 2];
+        uint32_t magic = words[flashSlotsUsed * 2 + 1];
+
+        if (key == 0xFFFFFFFFU && magic == 0xFFFFFFFFU) break;
+
+        /* Torn or foreign slots are skipped but stay used */
+        if (magic == QUARANTINE_ENTRY_MAGIC && !FindQuarantineKey(key)) {
+            AddQuarantineKey(key);
+        }
+    }
+
+    persistedCount = quarantineCount;
+}
+
+/**
+  * @brief  Look an address up in the table, ignoring any exemption
+  * @param  address: Address to check
+  * @retval 1 if the word or its block is in the table, 0 otherwise
+  */
+static uint32_t FindQuarantinedAddress(uint32_t address)
+{
+    uint32_t block = GetQuarantineBlockIndex(address);
+    if (block == QBLOCK_NONE) return 0;
+
+    /* Common case: clean block, one bit test */
+    if (!(quarantineBitmap[block / 32] & (1U << (block % 32)))) return 0;
+
+    uint32_t blockBase = address & ~(QUARANTINE_BLOCK_SIZE - 1);
+    return FindQuarantineKey(blockBase | QUARANTINE_BLOCK_FLAG) ||
+           FindQuarantineKey(address & ~0x3U);
+}
+
+/**
+  * @brief  Quarantine a failing word, promoting its block after repeated failures
+  * @param  address: Failing SRAM address
+  */
+void QuarantineAddress(uint32_t address)
+{
+    uint32_t word = address & ~0x3U;
+    uint32_t blockBase = address & ~(QUARANTINE_BLOCK_SIZE - 1);
+
+    if (GetQuarantineBlockIndex(word) == QBLOCK_NONE) return;
+    if (FindQuarantinedAddress(word)) return;
+    if (!AddQuarantineKey(word)) return;
+
+    /* Several bad words in one block - stop testing the block word by word */
+    uint32_t wordsInBlock = 0;
+    for (uint32_t i = 0; i < quarantineCount; i++) {
+        if ((quarantineList[i] & ~(QUARANTINE_BLOCK_SIZE - 1)) == blockBase &&
+            !(quarantineList[i] & QUARANTINE_BLOCK_FLAG)) {
+            wordsInBlock++;
+        }
+    }
+
+    if (wordsInBlock >= QUARANTINE_PROMOTE_WORDS) {
+        AddQuarantineKey(blockBase | QUARANTINE_BLOCK_FLAG);
+    }
+}
+
+/**
+  * @brief  Check whether an address is quarantined
+  * @param  address: Address to check
+  * @retval 1 if the word or its block is quarantined and not exempt, 0 otherwise
+  */
+uint32_t IsAddressQuarantined(uint32_t address)
+{
+    if (IsQuarantineExempt(address)) return 0;
+
+    return FindQuarantinedAddress(address);
+}
+
+/**
+  * @brief  Let a range through the quarantine lookups while it is characterized
+  * @param  startAddr: Range start
+  * @param  size: Range size in bytes, 0 to end the exemption
+  * @note   Errors in the range are then recorded again, but new failures in
+  *         it don't restart escalation (see RecordMemoryError).
+  */
+void SetQuarantineExemption(uint32_t startAddr, uint32_t size)
+{
+    exemptStart = startAddr;
+    exemptSize = size;
+}
+
+/**
+  * @brief  Check whether an address is in the exempt range
+  * @param  address: Address to check
+  * @retval 1 if exempt, 0 otherwise
+  */
+uint32_t IsQuarantineExempt(uint32_t address)
+{
+    return (address - exemptStart) < exemptSize;
+}
+
+/**
+  * @brief  Reset a cursor before a verify loop
+  * @param  cursor: Cursor to reset
+  */
+void StartQuarantineCursor(QuarantineCursor* cursor)
+{
+    cursor->blockBase = QBLOCK_NONE;
+    cursor->suspect = 0;
+}
+
+/**
+  * @brief  Check whether a verify loop should skip a word
+  * @param  cursor: Cursor carried through the loop
+  * @param  address: Word about to be verified
+  * @retval 1 if the word or its block is quarantined, 0 otherwise
+  * @note   The bitmap is only read when the loop enters a new block, and the
+  *         hash table only for blocks that hold quarantined entries.
+  */
+uint32_t SkipQuarantinedWord(QuarantineCursor* cursor, uint32_t address)
+{
+    uint32_t blockBase = address & ~(QUARANTINE_BLOCK_SIZE - 1);
+
+    if (blockBase != cursor->blockBase) {
+        uint32_t block = GetQuarantineBlockIndex(address);
+        cursor->blockBase = blockBase;
+        cursor->suspect = (block != QBLOCK_NONE) && (quarantineBitmap[block / 32] & (1U << (block % 32)));
+    }
+
+    return cursor->suspect && IsAddressQuarantined(address);
+}
+
+/**
+  * @brief  Check whether any part of a range is quarantined (for allocators)
+  * @param  startAddr: Start of the range
+  * @param  size: Size of the range in bytes
+  * @retval 1 if any quarantined word or block overlaps the range, 0 otherwise
+  */
+uint32_t IsRangeQuarantined(uint32_t startAddr, uint32_t size)
+{
+    uint32_t endAddr = startAddr + size;
+    uint32_t suspect = 0;
+
+    if (size == 0) return 0;
+
+    /* Bitmap pass - most ranges stop here */
+    for (uint32_t addr = startAddr & ~(QUARANTINE_BLOCK_SIZE - 1); addr < endAddr; addr += QUARANTINE_BLOCK_SIZE) {
+        uint32_t block = GetQuarantineBlockIndex(addr);
+        if (block != QBLOCK_NONE && (quarantineBitmap[block / 32] & (1U << (block % 32)))) {
+            suspect = 1;
+            break;
+        }
+    }
+    if (!suspect) return 0;
+
+    for (uint32_t i = 0; i < quarantineCount; i++) {
+        uint32_t entryStart = quarantineList[i] & ~QUARANTINE_BLOCK_FLAG;
+        uint32_t entrySize = (quarantineList[i] & QUARANTINE_BLOCK_FLAG) ? QUARANTINE_BLOCK_SIZE : 4;
+
+        if (entryStart < endAddr && entryStart + entrySize > startAddr) return 1;
+    }
+    return 0;
+}
+
+/**
+  * @brief  Get the number of quarantine entries
+  * @retval Entry count
+  */
+uint32_t GetQuarantineCount(void)
+{
+    return quarantineCount;
+}
+
+/**
+  * @brief  Get a quarantine entry
+  * @param  index: Entry index, 0 to GetQuarantineCount() - 1
+  * @param  address: Receives the word or block start address
+  * @param  isBlock: Receives 1 for a QUARANTINE_BLOCK_SIZE block, 0 for a word
+  * @retval 1 if the entry exists, 0 otherwise
+  */
+uint32_t GetQuarantineEntry(uint32_t index, uint32_t* address, uint32_t* isBlock)
+{
+    if (index >= quarantineCount) return 0;
+
+    *address = quarantineList[index] & ~QUARANTINE_BLOCK_FLAG;
+    *isBlock = quarantineList[index] & QUARANTINE_BLOCK_FLAG;
+    return 1;
+}
+
+/**
+  * @brief  Empty the table and erase its flash page
+  */
+void ClearQuarantine(void)
+{
+    FLASH_EraseInitTypeDef eraseInit;
+    uint32_t pageError = 0;
+
+    UnlockFlashForWrite(1);
+    GetFlashBankPage(FLASH_QUARANTINE_ADDR, &eraseInit.Banks, &eraseInit.Page);
+    eraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+    eraseInit.NbPages = 1;
+    HAL_FLASHEx_Erase(&eraseInit, &pageError);
+    HAL_FLASH_Lock();
+
+    memset(quarantineHash, 0, sizeof(quarantineHash));
+    memset(quarantineBitmap, 0, sizeof(quarantineBitmap));
+    quarantineCount = 0;
+    persistedCount = 0;
+    flashSlotsUsed = 0;
+    overflowCount = 0;
+}
+
+/**
+  * @brief  Erase the full flash page so the live table can be rewritten
+  * @note   Flash must be unlocked. The table holds at most half a page of
+  *         entries, so the rewrite always fits.
+  */
+static void CompactQuarantinePage(void)
+{
+    FLASH_EraseInitTypeDef eraseInit;
+    uint32_t pageError = 0;
+
+    GetFlashBankPage(FLASH_QUARANTINE_ADDR, &eraseInit.Banks, &eraseInit.Page);
+    eraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+    eraseInit.NbPages = 1;
+    if (HAL_FLASHEx_Erase(&eraseInit, &pageError) != HAL_OK) return;
+
+    /* Every entry is written again, oldest first, over the next calls */
+    flashSlotsUsed = 0;
+    persistedCount = 0;
+    compactions++;
+}
+
+/**
+  * @brief  Append new entries to the flash page
+  */
+void ServiceQuarantine(void)
+{
+    if (persistedCount == quarantineCount) return;
+
+    /* Don't stall behind a background log page erase */
+    if (!UnlockFlashForWrite(0)) return;
+
+    if (flashSlotsUsed >= QUARANTINE_FLASH_SLOTS) {
+        CompactQuarantinePage();
+    }
+
+    for (uint32_t batch = 0; batch < QUARANTINE_PERSIST_BATCH && persistedCount < quarantineCount; batch++) {
+        if (flashSlotsUsed >= QUARANTINE_FLASH_SLOTS) break;
+
+        uint64_t entry = quarantineList[persistedCount] | ((uint64_t)QUARANTINE_ENTRY_MAGIC << 32);
+        HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD,
+                                                     FLASH_QUARANTINE_ADDR + flashSlotsUsed * 8, entry);
+
+        /* A failed slot is torn and skipped at boot; the entry goes in the next one */
+        flashSlotsUsed++;
+        if (status != HAL_OK) {
+            programFailures++;
+            continue;
+        }
+        persistedCount++;
+    }
+
+    HAL_FLASH_Lock();
+}
+
+/**
+  * @brief  Report quarantine table occupancy
+  */
+void ReportQuarantineStatus(void)
+{
+    char buffer[160];
+    uint32_t blocks = 0;
+
+    for (uint32_t i = 0; i < quarantineCount; i++) {
+        if (quarantineList[i] & QUARANTINE_BLOCK_FLAG) blocks++;
+    }
+
+    /* Known-bad words no longer count as errors, so say so here */
+    snprintf(buffer, sizeof(buffer),
+             "Quarantine: %s %lu/%u entries (%lu blocks), unsaved=%lu, overflow=%lu, "
+             "slots=%lu/%u, compactions=%lu, fails=%lu\r\n",
+             quarantineCount ? "DEGRADED" : "clean",
+             quarantineCount, QUARANTINE_CAPACITY, blocks,
+             quarantineCount - persistedCount, overflowCount,
+             flashSlotsUsed, QUARANTINE_FLASH_SLOTS, compactions, programFailures);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,362 @@
+/**
+ * Pipelined Data-Retention Test for STM32G473CB Memory Test
+ *
+ * A retention window is written with a pattern and given a deadline; the
+ * CPU then goes on with the other tests and the window is verified on the
+ * first service call after the deadline. Several windows are in flight at
+ * once, spread over the SRAM regions, so retention coverage costs only the
+ * write and verify passes. A main test window that overlaps an in-flight
+ * retention window is clipped to its largest part clear of it for that
+ * cycle, rather than overwriting the pattern or skipping the region.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern MemoryTestConfig testConfig;
+
+/* Placement attempts per region before giving up for this cycle */
+#define RETENTION_PLACE_ATTEMPTS  4
+
+/* Clipped test windows keep a size the kernels can split in eighths */
+#define RETENTION_CLIP_ALIGN      32U
+
+/* One window holding a pattern */
+typedef struct {
+    uint32_t startAddr;            /* Window start, 0 if the slot is free */
+    uint32_t size;                 /* Window size in bytes */
+    uint32_t pattern;              /* Even words hold pattern, odd words its inverse */
+    uint32_t startTick;            /* HAL tick when the pattern was written */
+    uint32_t delayMs;              /* Hold time before verification */
+    uint8_t background;            /* Started by the background scheduler */
+} RetentionWindow;
+
+/* Function prototypes */
+void InitializeRetentionTests(void);
+uint32_t StartRetentionWindow(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t delayMs);
+void ServiceRetentionTests(void);
+uint32_t IsRetentionPending(uint32_t startAddr, uint32_t size);
+void CancelRetentionWindows(uint32_t startAddr, uint32_t size);
+uint32_t ClipWindowForRetention(uint32_t region, uint32_t* startAddr, uint32_t* size);
+void ReportRetentionStatus(void);
+
+static RetentionWindow retentionWindows[RETENTION_MAX_WINDOWS];
+
+/* Background placement state */
+static uint32_t placementCursor[NUM_TEST_REGIONS];
+static uint32_t nextRegion = REGION_SRAM1;
+static uint32_t nextBackground = 0;
+
+/* Statistics */
+static uint32_t windowsStarted = 0;
+static uint32_t windowsVerified = 0;
+static uint32_t windowsCancelled = 0;
+static uint32_t retentionErrors = 0;
+static uint32_t longestHoldMs = 0;
+static uint32_t regionClips[NUM_TEST_REGIONS];
+static uint32_t regionDeferrals[NUM_TEST_REGIONS];
+
+/**
+  * @brief  Release all retention windows and reset statistics
+  */
+void InitializeRetentionTests(void)
+{
+    memset(retentionWindows, 0, sizeof(retentionWindows));
+    memset(placementCursor, 0, sizeof(placementCursor));
+    memset(regionClips, 0, sizeof(regionClips));
+    memset(regionDeferrals, 0, sizeof(regionDeferrals));
+
+    nextRegion = REGION_SRAM1;
+    nextBackground = 0;
+    windowsStarted = 0;
+    windowsVerified = 0;
+    windowsCancelled = 0;
+    retentionErrors = 0;
+    longestHoldMs = 0;
+}
+
+/**
+  * @brief  Check whether two address ranges overlap
+  */
+static uint32_t RangesOverlap(uint32_t startA, uint32_t sizeA, uint32_t startB, uint32_t sizeB)
+{
+    return (startA < startB + sizeB) && (startB < startA + sizeA);
+}
+
+/**
+  * @brief  Check whether a range overlaps a window that is holding a pattern
+  * @param  startAddr: Range start address
+  * @param  size: Range size in bytes
+  * @retval 1 if any part of the range must not be written
+  */
+uint32_t IsRetentionPending(uint32_t startAddr, uint32_t size)
+{
+    for (uint32_t i = 0; i < RETENTION_MAX_WINDOWS; i++) {
+        RetentionWindow* window = &retentionWindows[i];
+        if (window->startAddr == 0) continue;
+
+        if (RangesOverlap(startAddr, size, window->startAddr, window->size)) return 1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Drop the windows in a range without verifying them
+  * @param  startAddr: Range start address
+  * @param  size: Range size in bytes
+  * @note   For memory that must be taken back before the hold time ends
+  */
+void CancelRetentionWindows(uint32_t startAddr, uint32_t size)
+{
+    for (uint32_t i = 0; i < RETENTION_MAX_WINDOWS; i++) {
+        RetentionWindow* window = &retentionWindows[i];
+        if (window->startAddr == 0) continue;
+
+        if (RangesOverlap(startAddr, size, window->startAddr, window->size)) {
+            window->startAddr = 0;
+            windowsCancelled++;
+        }
+    }
+}
+
+/**
+  * @brief  Shrink a region's test window so it clears the held windows
+  * @param  region: Region identifier
+  * @param  startAddr: Test window start address, updated
+  * @param  size: Test window size in bytes, updated
+  * @retval 1 if nothing is left to test this cycle, 0 otherwise
+  * @note   Each held window splits the test window in two; the larger
+  *         part is kept. Repeats until no held window overlaps.
+  */
+uint32_t ClipWindowForRetention(uint32_t region, uint32_t* startAddr, uint32_t* size)
+{
+    uint32_t start = *startAddr;
+    uint32_t end = start + *size;
+    uint32_t clipped = 0;
+    uint32_t i = 0;
+
+    while (i < RETENTION_MAX_WINDOWS && start < end) {
+        RetentionWindow* window = &retentionWindows[i];
+        uint32_t windowEnd = window->startAddr + window->size;
+
+        if (window->startAddr == 0 ||
+            !RangesOverlap(start, end - start, window->startAddr, window->size)) {
+            i++;
+            continue;
+        }
+
+        uint32_t before = (window->startAddr > start) ? window->startAddr - start : 0;
+        uint32_t after = (windowEnd < end) ? end - windowEnd : 0;
+
+        if (before >= after) {
+            end = start + before;
+        }
+        else {
+            start = windowEnd;
+        }
+        end = start + ((end - start) & ~(RETENTION_CLIP_ALIGN - 1));
+        clipped = 1;
+
+        /* A shifted window may now overlap one already checked */
+        i = 0;
+    }
+
+    if (!clipped) return 0;
+
+    *startAddr = start;
+    *size = end - start;
+
+    if (region < NUM_TEST_REGIONS) {
+        if (*size == 0) regionDeferrals[region]++;
+        else regionClips[region]++;
+    }
+
+    return (*size == 0);
+}
+
+/**
+  * @brief  Claim a free slot, write the pattern and start the hold time
+  * @retval Window, or NULL if no slot is free or the range is already held
+  */
+static RetentionWindow* OpenRetentionWindow(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t delayMs)
+{
+    RetentionWindow* window = NULL;
+
+    if (IsRetentionPending(startAddr, size)) return NULL;
+
+    for (uint32_t i = 0; i < RETENTION_MAX_WINDOWS; i++) {
+        if (retentionWindows[i].startAddr == 0) {
+            window = &retentionWindows[i];
+            break;
+        }
+    }
+    if (window == NULL) return NULL;
+
+    volatile uint32_t* base = (volatile uint32_t*)startAddr;
+    uint32_t numWords = size / 4;
+
+    for (uint32_t i = 0; i < numWords; i++) {
+        base[i] = (i & 1) ? ~pattern : pattern;
+    }
+
+    window->startAddr = startAddr;
+    window->size = size;
+    window->pattern = pattern;
+    window->delayMs = delayMs;
+    window->background = 0;
+    window->startTick = HAL_GetTick();
+    windowsStarted++;
+
+    return window;
+}
+
+/**
+  * @brief  Write a pattern to a window and schedule its verification
+  * @param  startAddr: Window start address, word aligned
+  * @param  size: Window size in bytes
+  * @param  pattern: Pattern for even words, odd words get its inverse
+  * @param  delayMs: Hold time before verification
+  * @retval 1 if started, 0 if no slot is free or the window is already held
+  */
+uint32_t StartRetentionWindow(uint32_t startAddr, uint32_t size, uint32_t pattern, uint32_t delayMs)
+{
+    return (OpenRetentionWindow(startAddr, size, pattern, delayMs) != NULL);
+}
+
+/**
+  * @brief  Verify a window whose hold time has expired and release it
+  * @param  window: Retention window
+  */
+static void VerifyRetentionWindow(RetentionWindow* window)
+{
+    uint32_t errors = 0;
+    volatile uint32_t* base = (volatile uint32_t*)window->startAddr;
+    uint32_t numWords = window->size / 4;
+    uint32_t heldMs = HAL_GetTick() - window->startTick;
+
+    UpdateTestOperation("Retention Verify");
+
+    for (uint32_t i = 0; i < numWords; i++) {
+        uint32_t expected = (i & 1) ? ~window->pattern : window->pattern;
+        uint32_t readValue = base[i];
+        if (readValue != expected) {
+            errors += RecordMemoryError("Retention", (uint32_t)&base[i], readValue, expected);
+        }
+    }
+
+    if (errors > 0) {
+        GetRegionStatus(GetRegionForAddress(window->startAddr))->totalErrors += errors;
+        retentionErrors += errors;
+    }
+
+    if (heldMs > longestHoldMs) longestHoldMs = heldMs;
+    windowsVerified++;
+    window->startAddr = 0;
+}
+
+/**
+  * @brief  Find a place for a background window in a region
+  * @param  region: SRAM region identifier
+  * @param  size: Window size in bytes
+  * @retval Window start address, or 0 if nothing suitable is free
+  * @note   Skips this cycle's test window, held windows and quarantined memory
+  */
+static uint32_t PlaceBackgroundWindow(uint32_t region, uint32_t size)
+{
+    uint32_t boundsStart, boundsEnd, testStart, testSize;
+
+    GetRegionTestBounds(region, &boundsStart, &boundsEnd);
+    GetRegionTestWindow(region, &testStart, &testSize);
+
+    if (boundsEnd - boundsStart < size) return 0;
+
+    for (uint32_t attempt = 0; attempt < RETENTION_PLACE_ATTEMPTS; attempt++) {
+        uint32_t candidate = boundsStart + placementCursor[region];
+
+        if (candidate + size > boundsEnd) {
+            placementCursor[region] = 0;
+            candidate = boundsStart;
+        }
+        placementCursor[region] += size;
+
+        if (RangesOverlap(candidate, size, testStart, testSize)) continue;
+        if (IsRetentionPending(candidate, size)) continue;
+        if (IsRangeQuarantined(candidate, size)) continue;
+
+        return candidate;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  Verify expired windows, then refill the background windows
+  * @note   Called once per cycle, before the main tests
+  */
+void ServiceRetentionTests(void)
+{
+    uint32_t backgroundActive = 0;
+    uint32_t now = HAL_GetTick();
+
+    for (uint32_t i = 0; i < RETENTION_MAX_WINDOWS; i++) {
+        RetentionWindow* window = &retentionWindows[i];
+        if (window->startAddr == 0) continue;
+
+        if (now - window->startTick >= window->delayMs) {
+            VerifyRetentionWindow(window);
+        }
+        else if (window->background) {
+            backgroundActive++;
+        }
+    }
+
+    /* Keep the configured number of background windows in flight,
+       rotating over the SRAM regions */
+    uint32_t windowSize = testConfig.retentionWindowSize & ~0x3U;
+    if (windowSize == 0) return;
+
+    for (uint32_t tries = 0; backgroundActive < testConfig.retentionWindows && tries < NUM_TEST_REGIONS; tries++) {
+        uint32_t region = nextRegion;
+        nextRegion = (nextRegion + 1 < NUM_TEST_REGIONS) ? nextRegion + 1 : REGION_SRAM1;
+
+        uint32_t startAddr = PlaceBackgroundWindow(region, windowSize);
+        if (startAddr == 0) continue;
+
+        uint32_t pattern = marchDataBackgrounds[nextBackground];
+        RetentionWindow* window = OpenRetentionWindow(startAddr, windowSize, pattern, testConfig.retentionDelayMs);
+        if (window == NULL) break;
+
+        window->background = 1;
+        nextBackground = (nextBackground + 1) % MARCH_NUM_BACKGROUNDS;
+        backgroundActive++;
+        tries = 0;
+    }
+}
+
+/**
+  * @brief  Report retention windows and statistics
+  */
+void ReportRetentionStatus(void)
+{
+    char buffer[256];
+    uint32_t inFlight = 0;
+
+    for (uint32_t i = 0; i < RETENTION_MAX_WINDOWS; i++) {
+        if (retentionWindows[i].startAddr != 0) inFlight++;
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "Retention: in flight=%lu started=%lu verified=%lu cancelled=%lu errors=%lu longest hold=%lums | "
+             "Clipped SRAM1=%lu SRAM2=%lu CCM=%lu | Deferred SRAM1=%lu SRAM2=%lu CCM=%lu\r\n",
+             inFlight, windowsStarted, windowsVerified, windowsCancelled, retentionErrors, longestHoldMs,
+             regionClips[REGION_SRAM1], regionClips[REGION_SRAM2], regionClips[REGION_CCM_SRAM],
+             regionDeferrals[REGION_SRAM1], regionDeferrals[REGION_SRAM2],
+             regionDeferrals[REGION_CCM_SRAM]);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,204 @@
+/**
+ * Stack High-Water Monitor for STM32G473CB Memory Test
+ *
+ * The MSP stack reservation (_Min_Stack_Size) is a guess, and the large
+ * snprintf buffers in the report paths make the real depth hard to
+ * predict. The reservation below the running frame is painted at boot.
+ * The main loop scans a few words of it per cycle, from the floor up;
+ * the first word that no longer holds the paint is the deepest the stack
+ * has been. Every STACK_RESIZE_INTERVAL cycles the reservation is set to
+ * that depth plus a safety factor and a fixed margin for interrupts and
+ * the report paths, never more than the painted area, and the memory
+ * freed beside the stack joins the test bounds. Memory is only handed to
+ * the tests after a scan pass has covered the whole reservation since the
+ * floor last moved. Memory is taken back without disturbing a retention
+ * window held in it, unless the stack needs it at once: if the stack eats
+ * into the margin above a reduced floor, the full linker reservation is
+ * restored and any retention window there is dropped.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* Linker script symbols */
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+/* Paint, and the part of the running frame left unpainted */
+#define STACK_PAINT_VALUE     0xC5C5C5C5U
+#define STACK_PAINT_SKIP      64
+
+/* Words checked per cycle */
+#define STACK_SCAN_WORDS      32
+
+/* Reservation = depth * STACK_SAFETY_PERCENT / 100 + STACK_ISR_MARGIN */
+#define STACK_RESIZE_INTERVAL 100
+#define STACK_SAFETY_PERCENT  150
+#define STACK_RESERVE_ALIGN   256
+
+/* Kept below the high-water mark whatever depth was seen: nested
+   interrupt frames and a report buffer the scan may not have caught.
+   Deepest use inside this margin of a reduced floor is an overflow. */
+#define STACK_ISR_MARGIN      1024
+
+/* Function prototypes */
+void InitializeStackMonitor(void);
+void ServiceStackMonitor(void);
+void ReportStackStatus(void);
+
+/* Stack geometry */
+static uint32_t stackTop = 0;
+static uint32_t stackPaintFloor = 0;      /* Bottom of the linker reservation */
+static uint32_t stackFloor = 0;           /* Bottom of the current reservation */
+static uint32_t stackMonitorReady = 0;
+
+/* Incremental scan */
+static uint32_t scanCursor = 0;
+static uint32_t highWater = 0;            /* Lowest address the stack has used */
+static uint32_t scanPassDone = 0;         /* A pass covered the reservation since the floor moved */
+
+/* Statistics */
+static uint32_t stackResizes = 0;
+static uint32_t stackOverflows = 0;
+
+/**
+  * @brief  Fill part of the reservation with the paint
+  * @param  start: First address to paint
+  * @param  end: Address just past the last one
+  */
+static void PaintStack(uint32_t start, uint32_t end)
+{
+    for (uint32_t addr = start; addr < end; addr += 4) {
+        *(volatile uint32_t*)addr = STACK_PAINT_VALUE;
+    }
+}
+
+/**
+  * @brief  Paint the stack reservation below the running frame
+  * @note   Call early, while the stack is shallow
+  */
+void InitializeStackMonitor(void)
+{
+    uint32_t sp = __get_MSP();
+
+    stackTop = (uint32_t)&_estack;
+    stackPaintFloor = stackTop - (uint32_t)&_Min_Stack_Size;
+
+    /* Only a stack inside its own reservation can be measured */
+    if (sp <= stackPaintFloor + STACK_PAINT_SKIP || sp > stackTop) {
+        char buffer[] = "Stack Monitor Error: MSP outside the linker stack reservation\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+
+    PaintStack(stackPaintFloor, (sp - STACK_PAINT_SKIP) & ~0x3U);
+
+    stackFloor = stackPaintFloor;
+    scanCursor = stackFloor;
+    scanPassDone = 0;
+    highWater = (sp - STACK_PAINT_SKIP) & ~0x3U;
+    stackMonitorReady = 1;
+}
+
+/**
+  * @brief  Move the reservation floor and tell the layout
+  * @param  floor: New floor
+  * @note   Memory taken back may hold a retention window; the caller
+  *         either waits for it or cancels it first.
+  */
+static void SetStackFloor(uint32_t floor)
+{
+    /* Take the memory back from the tests before painting it */
+    if (floor < stackFloor) {
+        SetStackReservation(stackTop - floor);
+        PaintStack(floor, stackFloor);
+    }
+    else {
+        SetStackReservation(stackTop - floor);
+    }
+
+    stackFloor = floor;
+    scanCursor = floor;
+    scanPassDone = 0;
+    stackResizes++;
+}
+
+/**
+  * @brief  Scan a few words of the stack and resize the reservation when due
+  */
+void ServiceStackMonitor(void)
+{
+    char buffer[128];
+
+    if (!stackMonitorReady) return;
+
+    /* The first word above the floor without paint is the deepest use */
+    for (uint32_t i = 0; i < STACK_SCAN_WORDS; i++) {
+        if (scanCursor >= highWater) {
+            scanCursor = stackFloor;
+            scanPassDone = 1;
+            break;
+        }
+        if (*(volatile uint32_t*)scanCursor != STACK_PAINT_VALUE) {
+            highWater = scanCursor;
+            scanCursor = stackFloor;
+            scanPassDone = 1;
+            break;
+        }
+        scanCursor += 4;
+    }
+
+    /* Into the margin above a reduced floor - give the stack everything
+       back now, retention windows there included */
+    if (stackFloor > stackPaintFloor && highWater < stackFloor + STACK_ISR_MARGIN) {
+        stackOverflows++;
+        snprintf(buffer, sizeof(buffer),
+                 "Stack Monitor: depth %lu bytes reached the reduced floor, restoring %lu bytes\r\n",
+                 stackTop - highWater, stackTop - stackPaintFloor);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        CancelRetentionWindows(stackPaintFloor, stackFloor - stackPaintFloor);
+        SetStackFloor(stackPaintFloor);
+        return;
+    }
+
+    if (testCycleCounter % STACK_RESIZE_INTERVAL != 0) return;
+
+    uint32_t depth = stackTop - highWater;
+    uint32_t reserve = depth * STACK_SAFETY_PERCENT / 100 + STACK_ISR_MARGIN;
+    reserve = (reserve + STACK_RESERVE_ALIGN - 1) & ~(STACK_RESERVE_ALIGN - 1);
+    if (reserve > stackTop - stackPaintFloor) reserve = stackTop - stackPaintFloor;
+
+    uint32_t floor = stackTop - reserve;
+    if (floor == stackFloor) return;
+
+    /* Only a depth from a complete pass may give memory away */
+    if (floor > stackFloor && !scanPassDone) return;
+
+    /* Growing over a held retention window waits for it to be verified */
+    if (floor < stackFloor && IsRetentionPending(floor, stackFloor - floor)) return;
+
+    SetStackFloor(floor);
+}
+
+/**
+  * @brief  Report the stack high-water mark and the reservation derived from it
+  */
+void ReportStackStatus(void)
+{
+    char buffer[160];
+
+    if (!stackMonitorReady) return;
+
+    snprintf(buffer, sizeof(buffer),
+             "Stack: high water=%lu bytes, reserved=%lu of %lu (freed %lu for tests), resizes=%lu overflows=%lu\r\n",
+             stackTop - highWater, stackTop - stackFloor, stackTop - stackPaintFloor,
+             stackFloor - stackPaintFloor, stackResizes, stackOverflows);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -0,0 +1,431 @@
+/**
+ * Relocated-Stack March for STM32G473CB Memory Test
+ *
+ * The windowed kernels can never touch the memory the firmware itself is
+ * using: .data, .bss, the heap and the MSP stack in SRAM1, or the .ccmram
+ * code in CCM. This module tests all of SRAM1, or all of CCM, by moving
+ * everything it needs into the other region first. A scratch area in the
+ * host region holds a copy of the vector table, a small stack, a context
+ * block and a save buffer. For each chunk of the target region the MSP
+ * and VTOR are switched to the scratch area, and a self-contained March
+ * C- runs over the chunk from flash. The chunk is then restored from the
+ * save buffer and both registers are switched back.
+ *
+ * While switched, SysTick and NMI are handled by a stub that only counts
+ * in the context block, and any other interrupt is masked in the NVIC and
+ * re-enabled afterwards. The stub clears the parity and flash ECC flags
+ * so the NMI doesn't re-enter, and a flash ECC address is logged once the
+ * region is back. HAL ticks missed in the meantime are caught up.
+ * The time from switch to switch back is the downtime reported per switch.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+extern volatile uint32_t eccErrorsDetected;
+
+/* Vector table copy: 16 system vectors and up to 112 interrupts, so the
+   table needs 512-byte alignment for VTOR */
+#define RELOC_VECTOR_WORDS    128
+#define RELOC_VECTOR_BYTES    (RELOC_VECTOR_WORDS * 4)
+#define RELOC_IRQ_WORDS       ((RELOC_VECTOR_WORDS - 16 + 31) / 32)
+
+/* Scratch stack and the chunk tested per switch */
+#define RELOC_STACK_SIZE      0x800
+#define RELOC_CHUNK_SIZE      0x2000
+#define RELOC_MIN_CHUNK       0x400
+
+/* Errors kept per chunk; the rest are only counted */
+#define RELOC_MAX_ERRORS      8
+
+/* One failing word seen while switched */
+typedef struct {
+    uint32_t address;
+    uint32_t readValue;
+    uint32_t expectedValue;
+    uint32_t recheckFailures;          /* Re-checks failed before the chunk was put back */
+} RelocatedError;
+
+/* Everything the switched code touches, placed right after the vector table */
+typedef struct {
+    uint32_t chunkStart;
+    uint32_t chunkWords;
+    uint32_t* saveBuffer;
+    uint32_t errorCount;
+    uint32_t cyclesPerUs;              /* SystemCoreClock may live in the chunk */
+    RelocatedError errors[RELOC_MAX_ERRORS];
+    volatile uint32_t ticks;                       /* SysTick interrupts taken */
+    volatile uint32_t nmis;                        /* Parity and flash ECC NMIs taken */
+    volatile uint32_t eccFaults;                   /* Uncorrectable flash ECC NMIs */
+    volatile uint32_t eccAddress;                  /* FLASH->ECCR address of the last one */
+    volatile uint32_t maskedIrqs[RELOC_IRQ_WORDS]; /* Interrupts masked by the stub */
+} RelocationContext;
+
+/* Scratch layout in the host region */
+#define RELOC_CONTEXT_BYTES   ((sizeof(RelocationContext) + 31) & ~31U)
+#define RELOC_FIXED_BYTES     (RELOC_VECTOR_BYTES + RELOC_CONTEXT_BYTES + RELOC_STACK_SIZE)
+
+/* Per target region */
+typedef struct {
+    uint32_t passes;
+    uint32_t deferred;                 /* No room for the scratch area in the host */
+    uint32_t switches;
+    uint32_t errors;
+    uint64_t downtimeCycles;
+    uint32_t maxDowntimeCycles;
+    uint32_t lastPassCycles;           /* Downtime summed over the last full pass */
+} RelocationStats;
+
+/* Function prototypes */
+uint32_t RunRelocatedMarch(uint32_t region);
+void ReportRelocationStatus(void);
+
+static RelocationStats relocationStats[NUM_TEST_REGIONS];
+
+/* Statistics */
+static uint32_t relocatedTicks = 0;
+static uint32_t relocatedNmis = 0;
+static uint32_t relocatedIrqsMasked = 0;
+
+/**
+  * @brief  Handler for every relocated vector but the faults
+  * @note   Runs on the scratch stack; finds the context through VTOR and
+  *         touches nothing in the region under test.
+  */
+static void RelocatedVectorStub(void)
+{
+    RelocationContext* ctx = (RelocationContext*)(SCB->VTOR + RELOC_VECTOR_BYTES);
+    uint32_t exception = __get_IPSR();
+
+    if (exception == 16 + SysTick_IRQn) {
+        ctx->ticks++;
+        return;
+    }
+
+    if (exception == 16 + NonMaskableInt_IRQn) {
+        if (SYSCFG->CFGR2 & SYSCFG_CFGR2_SPF) {
+            SYSCFG->CFGR2 |= SYSCFG_CFGR2_SPF;
+        }
+        /* An uncorrectable flash ECC error raises the NMI too, and keeps
+           raising it until ECCD is cleared, as FLASH_IRQHandler does */
+        if (__HAL_FLASH_GET_FLAG(FLASH_FLAG_ECCD)) {
+            ctx->eccAddress = FLASH->ECCR & FLASH_ECCR_ADDR_ECC;
+            ctx->eccFaults++;
+            __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ECCD);
+        }
+        ctx->nmis++;
+        return;
+    }
+
+    /* A peripheral interrupt - its handler may use the region under test */
+    if (exception >= 16) {
+        uint32_t irq = exception - 16;
+        NVIC->ICER[irq >> 5] = 1U << (irq & 31);
+        ctx->maskedIrqs[irq >> 5] |= 1U << (irq & 31);
+    }
+}
+
+/**
+  * @brief  Note a failing word in the context
+  * @param  ctx: Context in the host region
+  * @param  addr: Failing word
+  * @param  readValue: Value read
+  * @param  expected: Value expected
+  */
+static void NoteRelocatedError(RelocationContext* ctx, volatile uint32_t* addr,
+                               uint32_t readValue, uint32_t expected)
+{
+    if (ctx->errorCount < RELOC_MAX_ERRORS) {
+        RelocatedError* error = &ctx->errors[ctx->errorCount];
+        error->address = (uint32_t)addr;
+        error->readValue = readValue;
+        error->expectedValue = expected;
+    }
+    ctx->errorCount++;
+}
+
+/**
+  * @brief  Save a chunk, run March C- over it and put it back
+  * @param  ctx: Context in the host region
+  * @note   Runs on the scratch stack with the relocated vector table, so
+  *         nothing here may use memory outside ctx, the chunk and the save
+  *         buffer.
+  */
+static void RelocatedMarchChunk(RelocationContext* ctx)
+{
+    volatile uint32_t* chunk = (volatile uint32_t*)ctx->chunkStart;
+    uint32_t* save = ctx->saveBuffer;
+    uint32_t words = ctx->chunkWords;
+    uint32_t value;
+
+    for (uint32_t i = 0; i < words; i++) {
+        save[i] = chunk[i];
+    }
+
+    /* March C-: up(w0); up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0); up(r0) */
+    for (uint32_t i = 0; i < words; i++) {
+        chunk[i] = 0;
+    }
+    for (uint32_t i = 0; i < words; i++) {
+        if ((value = chunk[i]) != 0) NoteRelocatedError(ctx, &chunk[i], value, 0);
+        chunk[i] = 0xFFFFFFFF;
+    }
+    for (uint32_t i = 0; i < words; i++) {
+        if ((value = chunk[i]) != 0xFFFFFFFF) NoteRelocatedError(ctx, &chunk[i], value, 0xFFFFFFFF);
+        chunk[i] = 0;
+    }
+    for (uint32_t i = words; i-- > 0; ) {
+        if ((value = chunk[i]) != 0) NoteRelocatedError(ctx, &chunk[i], value, 0);
+        chunk[i] = 0xFFFFFFFF;
+    }
+    for (uint32_t i = words; i-- > 0; ) {
+        if ((value = chunk[i]) != 0xFFFFFFFF) NoteRelocatedError(ctx, &chunk[i], value, 0xFFFFFFFF);
+        chunk[i] = 0;
+    }
+    for (uint32_t i = 0; i < words; i++) {
+        if ((value = chunk[i]) != 0) NoteRelocatedError(ctx, &chunk[i], value, 0);
+    }
+
+    /* Re-check failing words now - once restored they hold live data */
+    uint32_t kept = (ctx->errorCount < RELOC_MAX_ERRORS) ? ctx->errorCount : RELOC_MAX_ERRORS;
+    for (uint32_t i = 0; i < kept; i++) {
+        RelocatedError* error = &ctx->errors[i];
+        error->recheckFailures = RecheckSRAMWord((volatile uint32_t*)error->address,
+                                                 error->readValue ^ error->expectedValue,
+                                                 error->expectedValue, ctx->cyclesPerUs);
+    }
+
+    for (uint32_t i = 0; i < words; i++) {
+        chunk[i] = save[i];
+    }
+}
+
+/**
+  * @brief  Call a function with the MSP moved to another stack
+  * @param  stackTop: Top of the stack to run on, 8-byte aligned
+  * @param  function: Function to call
+  * @param  ctx: Its argument
+  */
+static void RunOnStack(uint32_t stackTop, void (*function)(RelocationContext*), RelocationContext* ctx)
+{
+    __asm volatile (
+        "mov  r4, sp        \n"
+        "mov  sp, %[stack]  \n"
+        "mov  r0, %[ctx]    \n"
+        "blx  %[fn]         \n"
+        "mov  sp, r4        \n"
+        :
+        : [stack] "r" (stackTop), [ctx] "r" (ctx), [fn] "r" (function)
+        : "r0", "r1", "r2", "r3", "r4", "r12", "lr", "cc", "memory");
+}
+
+/**
+  * @brief  Find room for the scratch area in the host region
+  * @param  host: Host region
+  * @param  scratchBytes: Size wanted, including the save buffer
+  * @retval Scratch start, 512-byte aligned, or 0 if no place is free
+  * @note   Tries the bottom and the top of the host's test bounds, away from
+  *         retention windows and quarantined words.
+  */
+static uint32_t PlaceScratchArea(uint32_t host, uint32_t scratchBytes)
+{
+    uint32_t boundsStart, boundsEnd;
+    GetRegionTestBounds(host, &boundsStart, &boundsEnd);
+
+    uint32_t candidates[2];
+    candidates[0] = (boundsStart + RELOC_VECTOR_BYTES - 1) & ~(RELOC_VECTOR_BYTES - 1);
+    candidates[1] = (boundsEnd - scratchBytes) & ~(RELOC_VECTOR_BYTES - 1);
+
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t candidate = candidates[i];
+        if (candidate < boundsStart || boundsEnd - candidate < scratchBytes) continue;
+        if (IsRetentionPending(candidate, scratchBytes)) continue;
+        if (IsRangeQuarantined(candidate, scratchBytes)) continue;
+        return candidate;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief  March all of SRAM1 or CCM with the stack and vectors in the other
+  * @param  region: REGION_SRAM1 or REGION_CCM_SRAM
+  * @retval Number of errors detected
+  * @note   Skipped while DMA stress traffic is running. Errors are added to
+  *         the region's status here.
+  */
+uint32_t RunRelocatedMarch(uint32_t region)
+{
+    uint32_t regionStart, regionSize, host;
+    uint32_t errors = 0;
+    uint32_t passCycles = 0;
+
+    if (region == REGION_SRAM1) {
+        regionStart = SRAM1_START_ADDR;
+        regionSize = SRAM1_SIZE;
+        host = REGION_CCM_SRAM;
+    }
+    else if (region == REGION_CCM_SRAM) {
+        regionStart = CCM_SRAM_START_ADDR;
+        regionSize = CCM_SRAM_SIZE;
+        host = REGION_SRAM1;
+    }
+    else {
+        return 0;
+    }
+
+    if (IsDmaStressActive()) return 0;
+
+    RelocationStats* stats = &relocationStats[region];
+
+    /* Biggest save buffer that fits the host, in whole chunks of the region */
+    uint32_t boundsStart, boundsEnd;
+    GetRegionTestBounds(host, &boundsStart, &boundsEnd);
+    uint32_t chunkSize = RELOC_CHUNK_SIZE;
+    while (chunkSize >= RELOC_MIN_CHUNK &&
+           boundsEnd - boundsStart < RELOC_FIXED_BYTES + chunkSize + RELOC_VECTOR_BYTES) {
+        chunkSize /= 2;
+    }
+
+    uint32_t scratch = (chunkSize >= RELOC_MIN_CHUNK) ? PlaceScratchArea(host, RELOC_FIXED_BYTES + chunkSize) : 0;
+    if (scratch == 0) {
+        stats->deferred++;
+        return 0;
+    }
+
+    UpdateTestOperation(region == REGION_SRAM1 ? "Relocated March SRAM1" : "Relocated March CCM");
+
+    uint32_t* vectors = (uint32_t*)scratch;
+    RelocationContext* ctx = (RelocationContext*)(scratch + RELOC_VECTOR_BYTES);
+    uint32_t stackTop = scratch + RELOC_VECTOR_BYTES + RELOC_CONTEXT_BYTES + RELOC_STACK_SIZE;
+
+    /* Faults, SVC and PendSV keep their handlers; the rest go to the stub */
+    const uint32_t* activeVectors = (const uint32_t*)SCB->VTOR;
+    for (uint32_t i = 0; i < RELOC_VECTOR_WORDS; i++) {
+        vectors[i] = activeVectors[i];
+    }
+    vectors[16 + NonMaskableInt_IRQn] = (uint32_t)RelocatedVectorStub;
+    vectors[16 + SysTick_IRQn] = (uint32_t)RelocatedVectorStub;
+    for (uint32_t i = 16; i < RELOC_VECTOR_WORDS; i++) {
+        vectors[i] = (uint32_t)RelocatedVectorStub;
+    }
+
+    /* Nothing may write into the target behind the switched code's back */
+    PauseEnvironmentMonitor();
+    OpenTestWindows(GUARD_ALL_WINDOWS);
+
+    for (uint32_t offset = 0; offset < regionSize; offset += chunkSize) {
+        memset(ctx, 0, sizeof(RelocationContext));
+        ctx->chunkStart = regionStart + offset;
+        ctx->chunkWords = ((regionSize - offset < chunkSize) ? regionSize - offset : chunkSize) / 4;
+        ctx->saveBuffer = (uint32_t*)stackTop;
+        ctx->cyclesPerUs = SystemCoreClock / 1000000U;
+
+        uint32_t activeVtor = SCB->VTOR;
+        uint32_t start = GET_CYCLE_COUNT();
+
+        __disable_irq();
+        SCB->VTOR = scratch;
+        __DSB();
+        __ISB();
+        __enable_irq();
+
+        RunOnStack(stackTop, RelocatedMarchChunk, ctx);
+
+        __disable_irq();
+        SCB->VTOR = activeVtor;
+        __DSB();
+        __ISB();
+        __enable_irq();
+
+        uint32_t downtime = GET_CYCLE_COUNT() - start;
+
+        /* Catch up on what the stub held back */
+        for (uint32_t i = 0; i < ctx->ticks; i++) {
+            HAL_IncTick();
+        }
+        for (uint32_t i = 0; i < RELOC_IRQ_WORDS; i++) {
+            if (ctx->maskedIrqs[i] == 0) continue;
+            relocatedIrqsMasked++;
+            NVIC->ISER[i] = ctx->maskedIrqs[i];
+        }
+        relocatedTicks += ctx->ticks;
+        relocatedNmis += ctx->nmis;
+        if (ctx->eccFaults > 0) {
+            eccErrorsDetected += ctx->eccFaults;
+            LogECCEvent(ctx->eccAddress, 1);
+            SaveTestState(0, ERROR_ECC_DETECTED);
+        }
+
+        stats->switches++;
+        stats->downtimeCycles += downtime;
+        if (downtime > stats->maxDowntimeCycles) stats->maxDowntimeCycles = downtime;
+        passCycles += downtime;
+
+        /* The region is back in place; record without touching the words again */
+        uint32_t kept = (ctx->errorCount < RELOC_MAX_ERRORS) ? ctx->errorCount : RELOC_MAX_ERRORS;
+        for (uint32_t i = 0; i < kept; i++) {
+            RelocatedError* error = &ctx->errors[i];
+            errors += RecordRecheckedMemoryError("Relocated March", error->address,
+                                                 error->readValue, error->expectedValue,
+                                                 error->recheckFailures, RECHECK_SRAM_TRIALS);
+        }
+        errors += ctx->errorCount - kept;
+
+        RecordKernelRun(KERNEL_MARCH_RELOCATED, ctx->chunkWords * 4 * 10, downtime);
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+
+    CloseTestWindows(GUARD_ALL_WINDOWS);
+    ResumeEnvironmentMonitor();
+
+    stats->passes++;
+    stats->lastPassCycles = passCycles;
+    stats->errors += errors;
+    if (errors > 0) GetRegionStatus(region)->totalErrors += errors;
+
+    return errors;
+}
+
+/**
+  * @brief  Report passes and downtime per switch for each target region
+  */
+void ReportRelocationStatus(void)
+{
+    char buffer[256];
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+    int length = snprintf(buffer, sizeof(buffer), "Relocated March:");
+    uint32_t reported = 0;
+
+    if (cyclesPerUs == 0) cyclesPerUs = 1;
+
+    for (uint32_t region = 0; region < NUM_TEST_REGIONS && length < (int)sizeof(buffer); region++) {
+        RelocationStats* stats = &relocationStats[region];
+        if (stats->passes == 0 && stats->deferred == 0) continue;
+
+        uint32_t average = stats->switches ? (uint32_t)(stats->downtimeCycles / stats->switches) : 0;
+        length += snprintf(buffer + length, sizeof(buffer) - length,
+                           " %s passes=%lu deferred=%lu errors=%lu downtime/switch avg=%luus max=%luus pass=%luus",
+                           GetRegionName(region), stats->passes, stats->deferred, stats->errors,
+                           average / cyclesPerUs, stats->maxDowntimeCycles / cyclesPerUs,
+                           stats->lastPassCycles / cyclesPerUs);
+        reported++;
+    }
+
+    if (reported == 0) return;
+
+    if (length < (int)sizeof(buffer)) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, " | ticks=%lu nmis=%lu irqs masked=%lu",
+                           relocatedTicks, relocatedNmis, relocatedIrqsMasked);
+    }
+    if (length < (int)sizeof(buffer) - 2) {
+        strcpy(buffer + length, "\r\n");
+    }
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
@@ -22,6 +22,7 @@
 #include "stm32g4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "memory_test.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -46,12 +47,31 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
-
+void MemManage_Fault(uint32_t* frame);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 
+/**
+  * @brief Memory management fault, with the frame MemManage_Handler stacked
+  * @param frame: Exception frame, which the window guard may step past
+  */
+void MemManage_Fault(uint32_t* frame)
+{
+  /* Stray accesses to a guarded test window are recorded and retried,
+     stray writes to the framework state pages are dropped */
+  if (HandleWindowGuardFault(frame))
+  {
+    return;
+  }
+
+  SaveTestState(0, ERROR_MEMMANAGE);
+  while (1)
+  {
+  }
+}
+
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
@@ -69,6 +89,11 @@
 void NMI_Handler(void)
 {
   /* USER CODE BEGIN NonMaskableInt_IRQn 0 */
+  /* SRAM parity errors are recorded and the interrupted code resumes */
+  if (HandleParityNMI())
+  {
+    return;
+  }
 
   /* USER CODE END NonMaskableInt_IRQn 0 */
   /* USER CODE BEGIN NonMaskableInt_IRQn 1 */
@@ -95,17 +120,19 @@ void HardFault_Handler(void)
 
 /**
   * @brief This function handles Memory management fault.
+  * @note  Naked so the stacked frame can be found and handed on
   */
-void MemManage_Handler(void)
+__attribute__((naked)) void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  __asm volatile (
+      "tst   lr, #4          \n"
+      "ite   eq              \n"
+      "mrseq r0, msp         \n"
+      "mrsne r0, psp         \n"
+      "b     MemManage_Fault \n"
+  );
   /* USER CODE END MemoryManagement_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_MemoryManagement_IRQn 0 */
-    /* USER CODE END W1_MemoryManagement_IRQn 0 */
-  }
 }
 
 /**
@@ -187,6 +214,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  DmaStressTick();
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -76,6 +76,7 @@
   */
 
 #include "stm32g4xx.h"
+#include "memory_test.h"
 
 #if !defined  (HSE_VALUE)
   #define HSE_VALUE     24000000U /*!< Value of the External oscillator in Hz */
@@ -187,6 +188,9 @@ void SystemInit(void)
 #if defined(USER_VECT_TAB_ADDRESS)
   SCB->VTOR = VECT_TAB_BASE_ADDRESS | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM */
 #endif /* USER_VECT_TAB_ADDRESS */
+
+  /* Memory self-test, before Reset_Handler sets up .data and .bss -----------*/
+  PowerOnSelfTest();
 }
 
 /**
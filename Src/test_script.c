@@ -0,0 +1,603 @@
+/**
+ * Uploadable Test Scripts for STM32G473CB Memory Test
+ *
+ * Fielded units can't be reflashed, so new March-style algorithms are
+ * uploaded as bytecode over the command interface and kept in a reserved
+ * flash page. A script picks a region's test window, sets pattern registers
+ * and runs March elements over the window in any address order, with
+ * counted loops and delays between them. The script is checked once, when
+ * it is uploaded and again at boot, so the interpreter itself runs without
+ * checks. The check also bounds a run: loops multiplied out, the script
+ * may make at most SCRIPT_MAX_OP_PASSES operation passes over a window and
+ * wait at most SCRIPT_MAX_TOTAL_DELAY_MS in all.
+ *
+ * A MARCH instruction is decoded once into the same per-word form as the
+ * native engine: every operation becomes an expected value and an address
+ * mask, so a word's value is value ^ (address & mask) and the per-word loop
+ * is the native loop. Interpretation costs a few microseconds per element,
+ * not per word. Quarantined words are skipped as in the native engine, and
+ * elements over a region whose bus tier found a fault are skipped like
+ * those over a held retention window. Script throughput is tracked as its
+ * own kernel, next to the native March.
+ *
+ * Bytecode (multi-byte operands little endian):
+ *   0x00 END                          end of script
+ *   0x01 REGION r                     select a region's test window (1-3)
+ *   0x02 SET reg imm32                load a pattern register (0-3)
+ *   0x03 INV reg                      invert a pattern register
+ *   0x04 ROL reg n                    rotate a pattern register left by n
+ *   0x05 MARCH order n op...          n operations (1-6) per word, where
+ *                                     order is ADDRESS_ORDER_x, bit 7 = down
+ *   0x06 DELAY ms16                   wait, at most SCRIPT_MAX_DELAY_MS
+ *   0x07 LOOP count                   repeat up to ENDLOOP count times
+ *   0x08 ENDLOOP
+ *
+ * March operation byte: bit 7 = read and verify (else write), bits 4-5 =
+ * expression (0 reg, 1 ~reg, 2 address ^ reg, 3 ~(address ^ reg)), bits
+ * 0-1 = register.
+ *
+ * Upload: "SCRIPT LOAD n", wait for the ready line, then send the n bytes
+ * of bytecode followed by their Fletcher-32 checksum, little endian.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern IWDG_HandleTypeDef hiwdg;
+
+/* Stored script: header doublewords, then the bytecode */
+#define SCRIPT_MAGIC          0x4353544DU   /* "MTSC" */
+#define SCRIPT_HEADER_SIZE    16
+#define SCRIPT_MAX_LENGTH     (FLASH_SCRIPT_PAGES * FLASH_PAGE_SIZE - SCRIPT_HEADER_SIZE)
+#define SCRIPT_UPLOAD_TIMEOUT 5000          /* ms allowed for each doubleword to arrive */
+
+/* Interpreter limits */
+#define SCRIPT_NUM_REGISTERS  4
+#define SCRIPT_MAX_LOOP_DEPTH 4
+#define SCRIPT_MAX_DELAY_MS   1000
+
+/* Worst case for one run, loops multiplied out */
+#define SCRIPT_MAX_OP_PASSES       256     /* Operations times window passes */
+#define SCRIPT_MAX_TOTAL_DELAY_MS  3000
+
+/* Opcodes */
+#define SCRIPT_END            0x00
+#define SCRIPT_REGION         0x01
+#define SCRIPT_SET            0x02
+#define SCRIPT_INV            0x03
+#define SCRIPT_ROL            0x04
+#define SCRIPT_MARCH          0x05
+#define SCRIPT_DELAY          0x06
+#define SCRIPT_LOOP           0x07
+#define SCRIPT_ENDLOOP        0x08
+
+/* March operation fields */
+#define SCRIPT_OP_READ        0x80
+#define SCRIPT_OP_INVERSE     0x10
+#define SCRIPT_OP_ADDRESS     0x20
+#define SCRIPT_OP_REGISTER    0x03
+#define SCRIPT_OP_RESERVED    0x4C
+#define SCRIPT_ORDER_DOWN     0x80
+
+/* Stored header */
+typedef struct {
+    uint32_t magic;
+    uint32_t length;
+    uint32_t checksum;
+    uint32_t reserved;
+} ScriptHeader;
+
+/* One decoded March operation */
+typedef struct {
+    uint32_t value;                /* Expected value with the address bits clear */
+    uint32_t addressMask;          /* All ones to XOR the word address in */
+    uint32_t read;
+} ScriptOp;
+
+/* Open LOOP */
+typedef struct {
+    uint32_t body;                 /* Offset of the first instruction in the loop */
+    uint32_t remaining;
+} ScriptLoop;
+
+/* Function prototypes */
+void InitializeTestScript(void);
+uint32_t LoadTestScript(uint32_t length);
+void EraseTestScript(void);
+void RunTestScript(void);
+void ReportTestScriptStatus(void);
+
+/* Set when the stored script passed its checks */
+static uint32_t scriptValid = 0;
+
+/* Statistics */
+static uint32_t scriptRuns = 0;
+static uint32_t scriptElements = 0;
+static uint32_t scriptSkips = 0;
+static uint32_t scriptErrors = 0;
+static uint32_t scriptLastCycles = 0;
+static uint32_t scriptUploads = 0;
+static uint32_t scriptRejects = 0;
+
+/**
+  * @brief  Fletcher-32 over a byte string
+  * @param  data: Bytes to check
+  * @param  length: Number of bytes
+  * @retval Checksum
+  */
+static uint32_t ComputeScriptChecksum(const uint8_t* data, uint32_t length)
+{
+    uint32_t sum1 = 0xFFFF, sum2 = 0xFFFF;
+
+    for (uint32_t i = 0; i < length; i++) {
+        sum1 = (sum1 + data[i]) % 0xFFFF;
+        sum2 = (sum2 + sum1) % 0xFFFF;
+    }
+    return (sum2 << 16) | sum1;
+}
+
+/**
+  * @brief  Get the bytes an instruction takes
+  * @param  code: Bytecode
+  * @param  offset: Offset of the opcode
+  * @retval Instruction length
+  */
+static uint32_t GetInstructionLength(const uint8_t* code, uint32_t offset)
+{
+    switch (code[offset]) {
+        case SCRIPT_REGION:  return 2;
+        case SCRIPT_SET:     return 6;
+        case SCRIPT_INV:     return 2;
+        case SCRIPT_ROL:     return 3;
+        case SCRIPT_MARCH:   return 3 + code[offset + 2];
+        case SCRIPT_DELAY:   return 3;
+        case SCRIPT_LOOP:    return 2;
+        default:             return 1;
+    }
+}
+
+/**
+  * @brief  Check a script before it is stored or run
+  * @param  code: Bytecode
+  * @param  length: Bytecode length
+  * @param  failOffset: Receives the offset of the first bad instruction
+  * @retval NULL if the script is good, else the reason it is not
+  */
+static const char* ValidateScript(const uint8_t* code, uint32_t length, uint32_t* failOffset)
+{
+    uint32_t depth = 0;
+    uint32_t regionSelected = 0;
+    uint32_t offset = 0;
+
+    /* Times an instruction at each loop depth runs; loops have no exits,
+       so this is exact, not only an upper bound */
+    uint32_t repeats[SCRIPT_MAX_LOOP_DEPTH + 1] = { 1 };
+    uint32_t opPasses = 0;
+    uint32_t delayMs = 0;
+
+    while (offset < length) {
+        uint8_t opcode = code[offset];
+        *failOffset = offset;
+
+        if (opcode == SCRIPT_END) {
+            return (depth == 0) ? NULL : "LOOP without ENDLOOP";
+        }
+        if (opcode > SCRIPT_ENDLOOP) return "unknown opcode";
+
+        /* The operand count of MARCH is itself an operand */
+        if (opcode == SCRIPT_MARCH && offset + 2 >= length) return "truncated";
+        uint32_t size = GetInstructionLength(code, offset);
+        if (offset + size > length) return "truncated";
+
+        switch (opcode) {
+            case SCRIPT_REGION:
+                if (code[offset + 1] < REGION_SRAM1 || code[offset + 1] >= NUM_TEST_REGIONS) return "bad region";
+                regionSelected = 1;
+                break;
+
+            case SCRIPT_SET:
+            case SCRIPT_INV:
+                if (code[offset + 1] >= SCRIPT_NUM_REGISTERS) return "bad register";
+                break;
+
+            case SCRIPT_ROL:
+                if (code[offset + 1] >= SCRIPT_NUM_REGISTERS) return "bad register";
+                if (code[offset + 2] == 0 || code[offset + 2] > 31) return "bad rotate";
+                break;
+
+            case SCRIPT_MARCH:
+                if (!regionSelected) return "MARCH before REGION";
+                if ((code[offset + 1] & ~SCRIPT_ORDER_DOWN) >= NUM_ADDRESS_ORDERS) return "bad order";
+                if (code[offset + 2] == 0 || code[offset + 2] > MARCH_MAX_OPS) return "bad operation count";
+                for (uint32_t op = 0; op < code[offset + 2]; op++) {
+                    if (code[offset + 3 + op] & SCRIPT_OP_RESERVED) return "bad operation";
+                }
+                opPasses += repeats[depth] * code[offset + 2];
+                if (opPasses > SCRIPT_MAX_OP_PASSES) return "too many operation passes";
+                break;
+
+            case SCRIPT_DELAY: {
+                uint32_t ms = code[offset + 1] | (code[offset + 2] << 8);
+                if (ms > SCRIPT_MAX_DELAY_MS) return "delay too long";
+                delayMs += repeats[depth] * ms;
+                if (delayMs > SCRIPT_MAX_TOTAL_DELAY_MS) return "total delay too long";
+                break;
+            }
+
+            case SCRIPT_LOOP:
+                if (code[offset + 1] == 0) return "zero loop count";
+                if (++depth > SCRIPT_MAX_LOOP_DEPTH) return "loops nested too deep";
+                /* Capped so the product can't overflow; past the cap any
+                   element or delay in the loop fails its own limit */
+                repeats[depth] = repeats[depth - 1] * code[offset + 1];
+                if (repeats[depth] > SCRIPT_MAX_TOTAL_DELAY_MS) repeats[depth] = SCRIPT_MAX_TOTAL_DELAY_MS + 1;
+                break;
+
+            case SCRIPT_ENDLOOP:
+                if (depth == 0) return "ENDLOOP without LOOP";
+                depth--;
+                break;
+        }
+
+        offset += size;
+    }
+
+    *failOffset = length;
+    return "no END";
+}
+
+/**
+  * @brief  Check the stored script
+  * @retval 1 if the flash page holds a good script
+  */
+static uint32_t CheckStoredScript(void)
+{
+    const ScriptHeader* header = (const ScriptHeader*)FLASH_SCRIPT_ADDR;
+    const uint8_t* code = (const uint8_t*)(FLASH_SCRIPT_ADDR + SCRIPT_HEADER_SIZE);
+    uint32_t failOffset;
+
+    if (header->magic != SCRIPT_MAGIC || header->length == 0 || header->length > SCRIPT_MAX_LENGTH) return 0;
+    if (ComputeScriptChecksum(code, header->length) != header->checksum) return 0;
+    return ValidateScript(code, header->length, &failOffset) == NULL;
+}
+
+/**
+  * @brief  Pick up the stored script at boot
+  */
+void InitializeTestScript(void)
+{
+    scriptValid = CheckStoredScript();
+}
+
+/**
+  * @brief  Erase the script page
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef EraseScriptPage(void)
+{
+    FLASH_EraseInitTypeDef eraseInit;
+    uint32_t pageError = 0;
+
+    scriptValid = 0;
+
+    GetFlashBankPage(FLASH_SCRIPT_ADDR, &eraseInit.Banks, &eraseInit.Page);
+    eraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+    eraseInit.NbPages = FLASH_SCRIPT_PAGES;
+
+    UnlockFlashForWrite(1);
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&eraseInit, &pageError);
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/**
+  * @brief  Remove the stored script
+  */
+void EraseTestScript(void)
+{
+    EraseScriptPage();
+}
+
+/**
+  * @brief  Receive a script over USART2 and store it if it checks out
+  * @param  length: Bytecode length the host will send
+  * @retval 1 if the script was stored
+  * @note   Blocks the test loop while the bytes arrive. The bytecode goes
+  *         straight into flash a doubleword at a time; the header is
+  *         programmed last, so an upload that fails leaves no script.
+  */
+uint32_t LoadTestScript(uint32_t length)
+{
+    char buffer[96];
+    const char* reason = NULL;
+    uint32_t failOffset = 0;
+    uint32_t address = FLASH_SCRIPT_ADDR + SCRIPT_HEADER_SIZE;
+    uint64_t dword;
+    uint32_t received[2];
+
+    scriptUploads++;
+
+    if (length == 0 || length > SCRIPT_MAX_LENGTH) {
+        reason = "bad length";
+    }
+    else if (EraseScriptPage() != HAL_OK) {
+        reason = "erase failed";
+    }
+    else {
+        /* Take the UART from the command reader, then ask for the bytes */
+        SuspendCommandInput();
+        snprintf(buffer, sizeof(buffer), "Script: ready for %lu bytes and checksum\r\n", length);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+        UnlockFlashForWrite(1);
+        for (uint32_t done = 0; done < length && reason == NULL; done += 8) {
+            uint32_t chunk = (length - done < 8) ? length - done : 8;
+
+            dword = UINT64_MAX;
+            if (HAL_UART_Receive(&huart2, (uint8_t*)&dword, chunk, SCRIPT_UPLOAD_TIMEOUT) != HAL_OK) {
+                reason = "timed out";
+            }
+            else if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address + done, dword) != HAL_OK) {
+                reason = "program failed";
+            }
+            HAL_IWDG_Refresh(&hiwdg);
+        }
+
+        if (reason == NULL &&
+            HAL_UART_Receive(&huart2, (uint8_t*)&received[0], 4, SCRIPT_UPLOAD_TIMEOUT) != HAL_OK) {
+            reason = "timed out";
+        }
+
+        /* Check what is in flash, not what was meant to be sent */
+        if (reason == NULL) {
+            const uint8_t* code = (const uint8_t*)address;
+            if (ComputeScriptChecksum(code, length) != received[0]) {
+                reason = "checksum mismatch";
+            }
+            else {
+                reason = ValidateScript(code, length, &failOffset);
+            }
+        }
+
+        if (reason == NULL) {
+            received[0] = SCRIPT_MAGIC;
+            received[1] = length;
+            memcpy(&dword, received, sizeof(dword));
+            if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, FLASH_SCRIPT_ADDR + 8,
+                                  (uint64_t)ComputeScriptChecksum((const uint8_t*)address, length)) != HAL_OK ||
+                HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, FLASH_SCRIPT_ADDR, dword) != HAL_OK) {
+                reason = "program failed";
+            }
+        }
+        HAL_FLASH_Lock();
+        ResumeCommandInput();
+    }
+
+    if (reason != NULL) {
+        scriptRejects++;
+        snprintf(buffer, sizeof(buffer), "Script: rejected at byte %lu, %s\r\n", failOffset, reason);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return 0;
+    }
+
+    scriptValid = CheckStoredScript();
+    snprintf(buffer, sizeof(buffer), "Script: stored %lu bytes\r\n", length);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    return scriptValid;
+}
+
+/**
+  * @brief  Get a region's current test window
+  * @param  region: REGION_SRAM1, REGION_SRAM2 or REGION_CCM_SRAM
+  * @param  startAddr: Receives the window start
+  * @param  size: Receives the window size, rounded down to whole words
+  */
+static void GetScriptWindow(uint32_t region, uint32_t* startAddr, uint32_t* size)
+{
+    switch (region) {
+        case REGION_SRAM1:
+            *startAddr = GetSRAM1TestStart();
+            *size = testConfig.sram1TestSize;
+            break;
+        case REGION_SRAM2:
+            *startAddr = GetSRAM2TestStart();
+            *size = testConfig.sram2TestSize;
+            break;
+        case REGION_CCM_SRAM:
+        default:
+            *startAddr = GetCCMTestStart();
+            *size = testConfig.ccmTestSize;
+            break;
+    }
+    *size &= ~0x3U;
+}
+
+/**
+  * @brief  Run one decoded March element over a window
+  * @param  ops: Decoded operations
+  * @param  numOps: Number of operations
+  * @param  order: ADDRESS_ORDER_x
+  * @param  down: Non-zero to run the order backwards
+  * @param  startAddr: Window start, word aligned
+  * @param  size: Window size in bytes
+  * @retval Number of errors detected
+  */
+static uint32_t RunScriptElement(const ScriptOp* ops, uint32_t numOps, uint32_t order, uint32_t down,
+                                 uint32_t startAddr, uint32_t size)
+{
+    uint32_t errors = 0;
+    uint32_t numWords = size / 4;
+    volatile uint32_t* base = (volatile uint32_t*)startAddr;
+    AddressSequence sequence;
+    QuarantineCursor cursor;
+
+    /* A lone constant write in ascending order is a plain background fill */
+    if (numOps == 1 && !down && order == ADDRESS_ORDER_UP && !ops[0].read && ops[0].addressMask == 0) {
+        FillBackground(startAddr, numWords * 4, ops[0].value);
+        return 0;
+    }
+
+    StartAddressSequence(&sequence, order, numWords, down);
+    StartQuarantineCursor(&cursor);
+
+    for (uint32_t n = 0; n < numWords; n++) {
+        volatile uint32_t* addr = &base[NextAddressIndex(&sequence)];
+        uint32_t addressBits = (uint32_t)addr;
+
+        /* Known-bad words were reported when they were quarantined */
+        if (SkipQuarantinedWord(&cursor, addressBits)) continue;
+
+        for (uint32_t op = 0; op < numOps; op++) {
+            uint32_t value = ops[op].value ^ (addressBits & ops[op].addressMask);
+
+            if (ops[op].read) {
+                uint32_t readValue = *addr;
+                if (readValue != value) {
+                    errors += RecordMemoryError("Script", (uint32_t)addr, readValue, value);
+                }
+            }
+            else {
+                *addr = value;
+            }
+        }
+    }
+
+    return errors;
+}
+
+/**
+  * @brief  Run the stored script once
+  * @note   Call with the SRAM test windows open. Elements over a window
+  *         that holds a retention pattern, or in a region whose bus tier
+  *         found a fault, are skipped.
+  */
+void RunTestScript(void)
+{
+    if (!scriptValid) return;
+
+    const ScriptHeader* header = (const ScriptHeader*)FLASH_SCRIPT_ADDR;
+    const uint8_t* code = (const uint8_t*)(FLASH_SCRIPT_ADDR + SCRIPT_HEADER_SIZE);
+    uint32_t registers[SCRIPT_NUM_REGISTERS] = { 0 };
+    ScriptLoop loops[SCRIPT_MAX_LOOP_DEPTH];
+    uint32_t depth = 0;
+    uint32_t region = REGION_SRAM1;
+    uint32_t windowStart = 0, windowSize = 0;
+    uint32_t bytes = 0;
+    uint32_t start = GET_CYCLE_COUNT();
+    uint32_t offset = 0;
+
+    scriptRuns++;
+
+    while (offset < header->length && code[offset] != SCRIPT_END) {
+        const uint8_t* instruction = &code[offset];
+        uint32_t next = offset + GetInstructionLength(code, offset);
+
+        switch (instruction[0]) {
+            case SCRIPT_REGION:
+                region = instruction[1];
+                GetScriptWindow(region, &windowStart, &windowSize);
+                break;
+
+            case SCRIPT_SET:
+                registers[instruction[1]] = instruction[2] | (instruction[3] << 8) |
+                                            (instruction[4] << 16) | ((uint32_t)instruction[5] << 24);
+                break;
+
+            case SCRIPT_INV:
+                registers[instruction[1]] = ~registers[instruction[1]];
+                break;
+
+            case SCRIPT_ROL: {
+                uint32_t value = registers[instruction[1]];
+                registers[instruction[1]] = (value << instruction[2]) | (value >> (32 - instruction[2]));
+                break;
+            }
+
+            case SCRIPT_MARCH: {
+                ScriptOp ops[MARCH_MAX_OPS];
+                uint32_t numOps = instruction[2];
+
+                /* Decode once per element so the per-word loop matches the native engine */
+                for (uint32_t op = 0; op < numOps; op++) {
+                    uint8_t operation = instruction[3 + op];
+                    ops[op].value = registers[operation & SCRIPT_OP_REGISTER];
+                    if (operation & SCRIPT_OP_INVERSE) ops[op].value = ~ops[op].value;
+                    ops[op].addressMask = (operation & SCRIPT_OP_ADDRESS) ? 0xFFFFFFFFU : 0;
+                    ops[op].read = operation & SCRIPT_OP_READ;
+                }
+
+                if (windowSize == 0 || IsBusTierFaulty(region) ||
+                    IsRetentionPending(windowStart, windowSize)) {
+                    scriptSkips++;
+                    break;
+                }
+
+                uint32_t errors = RunScriptElement(ops, numOps, instruction[1] & ~SCRIPT_ORDER_DOWN,
+                                                   instruction[1] & SCRIPT_ORDER_DOWN, windowStart, windowSize);
+                scriptErrors += errors;
+                GetRegionStatus(region)->totalErrors += errors;
+                scriptElements++;
+                bytes += windowSize * numOps;
+
+                /* Large windows can take a while per element */
+                HAL_IWDG_Refresh(&hiwdg);
+                break;
+            }
+
+            case SCRIPT_DELAY: {
+                uint32_t delayStart = GET_CYCLE_COUNT();
+                HAL_Delay(instruction[1] | (instruction[2] << 8));
+                HAL_IWDG_Refresh(&hiwdg);
+
+                /* Waiting is not test throughput */
+                start += GET_CYCLE_COUNT() - delayStart;
+                break;
+            }
+
+            case SCRIPT_LOOP:
+                loops[depth].body = next;
+                loops[depth].remaining = instruction[1];
+                depth++;
+                break;
+
+            case SCRIPT_ENDLOOP:
+                if (--loops[depth - 1].remaining > 0) {
+                    next = loops[depth - 1].body;
+                }
+                else {
+                    depth--;
+                }
+                break;
+        }
+
+        offset = next;
+    }
+
+    scriptLastCycles = GET_CYCLE_COUNT() - start;
+    RecordKernelRun(KERNEL_SCRIPT, bytes, scriptLastCycles);
+}
+
+/**
+  * @brief  Report the stored script and what its runs found
+  */
+void ReportTestScriptStatus(void)
+{
+    char buffer[192];
+    const ScriptHeader* header = (const ScriptHeader*)FLASH_SCRIPT_ADDR;
+
+    if (!scriptValid && scriptUploads == 0) return;
+
+    snprintf(buffer, sizeof(buffer),
+             "Script: %s %lu bytes checksum=0x%08lX runs=%lu elements=%lu skipped=%lu errors=%lu "
+             "last=%luus uploads=%lu rejected=%lu\r\n",
+             scriptValid ? "stored" : "none", scriptValid ? header->length : 0,
+             scriptValid ? header->checksum : 0, scriptRuns, scriptElements, scriptSkips,
+             scriptErrors, CYCLES_TO_US(scriptLastCycles), scriptUploads, scriptRejects);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}
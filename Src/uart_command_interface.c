@@ -1,567 +1,300 @@
 /**
- * Updated Memory Test Main Integration
+ * UART Command Interface for STM32G473CB Memory Test
  *
- * Incorporates configurable test parameters and improved address testing
+ * Reads commands from USART2 between test cycles. The main loop only
+ * looks at the UART once per cycle, so the USART2 interrupt moves what
+ * arrives in between into a small ring. Characters are collected up to a
+ * carriage return or line feed; the line is then matched against the
+ * command table. Nothing here blocks, except a script upload, which
+ * takes the UART over while the bytes arrive.
+ *
+ *   PROD     - run the production go/no-go pass and halt
+ *   MODE n   - switch the test mode (0 normal, 1 stress, 2 SRAM, 3 flash, 4 cache)
+ *   REPORT   - send the status reports at the end of this cycle
+ *   BURNIN n - start (1) or stop (0) burn-in mode
+ *   SCRIPT LOAD n / RUN / ERASE - upload, run now or remove the test script
+ *   HELP     - list the commands
  */
 
 #include "stm32g4xx_hal.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "memory_test.h"
 
-/* External definitions from configuration */
-extern MemoryTestConfig testConfig;
-extern void InitializeDefaultConfig(void);
-extern void RotateTestParameters(uint32_t cycleCounter);
-extern uint32_t GetFlashTestStart(void);
-extern uint32_t GetSRAM1TestStart(void);
-extern uint32_t GetSRAM2TestStart(void);
-extern uint32_t GetCCMTestStart(void);
-
-/* External functions from improved address testing */
-extern uint32_t RunImprovedAddressTest(uint32_t startAddr, uint32_t size, uint32_t totalSize);
-extern uint32_t RunEnhancedButterflyTest(uint32_t startAddr, uint32_t size, uint32_t totalSize);
-
 /* External references */
 extern UART_HandleTypeDef huart2;
-extern volatile char currentTestOperation[64];
-extern volatile uint32_t testCycleCounter;
-extern volatile uint32_t lastReportTime;
-extern volatile uint32_t currentTestMode;
-extern MemoryTestStatus flashStatus;
-extern MemoryTestStatus sram1Status;
-extern MemoryTestStatus sram2Status;
-extern MemoryTestStatus ccmStatus;
-extern MemoryTestStatus cacheStatus;
-
-/* Updated function prototypes */
-void InitializeTests(void);
-void MainTestCycle(void);
-void TestAllMemoryRegions(void);
-void TestSRAMOnly(void);
-void TestFlashOnly(void);
-void TestCacheOnly(void);
-void ReportConfigStatus(void);
+
+/* Longest command line, including the argument */
+#define COMMAND_LINE_SIZE     24
+
+/* Characters held between cycles */
+#define COMMAND_RX_SIZE       64
+
+/* One command */
+typedef struct {
+    const char* name;
+    void (*handler)(const char* argument);
+} CommandEntry;
+
+/* Function prototypes */
+void InitializeCommandInterface(void);
+void ServiceCommandInterface(void);
+void SuspendCommandInput(void);
+void ResumeCommandInput(void);
+void USART2_IRQHandler(void);
+static void CommandProduction(const char* argument);
+static void CommandMode(const char* argument);
+static void CommandReport(const char* argument);
+static void CommandBurnIn(const char* argument);
+static void CommandScript(const char* argument);
+static void CommandHelp(const char* argument);
+
+static const CommandEntry commandTable[] = {
+    { "PROD",   CommandProduction },
+    { "MODE",   CommandMode },
+    { "REPORT", CommandReport },
+    { "BURNIN", CommandBurnIn },
+    { "SCRIPT", CommandScript },
+    { "HELP",   CommandHelp },
+};
+#define NUM_COMMANDS          (sizeof(commandTable) / sizeof(commandTable[0]))
+
+/* Filled by the USART2 interrupt, drained by ServiceCommandInterface() */
+static volatile uint8_t rxRing[COMMAND_RX_SIZE];
+static volatile uint32_t rxHead = 0;
+static volatile uint32_t rxTail = 0;
+static volatile uint32_t rxOverflow = 0;
+
+/* Line being collected */
+static char commandLine[COMMAND_LINE_SIZE];
+static uint32_t commandLength = 0;
+static uint32_t commandOverflow = 0;
+
+/* Statistics */
+static uint32_t commandsRun = 0;
+static uint32_t commandsRejected = 0;
 
 /**
-  * @brief  Initialize tests and counters with configurable parameters
+  * @brief  Start collecting USART2 input between cycles
   */
-void InitializeTests(void)
+void InitializeCommandInterface(void)
 {
-    /* Reset all status counters */
-    memset(&flashStatus, 0, sizeof(MemoryTestStatus));
-    memset(&sram1Status, 0, sizeof(MemoryTestStatus));
-    memset(&sram2Status, 0, sizeof(MemoryTestStatus));
-    memset(&ccmStatus, 0, sizeof(MemoryTestStatus));
-    memset(&cacheStatus, 0, sizeof(MemoryTestStatus));
+    HAL_UARTEx_SetRxFifoThreshold(&huart2, UART_RXFIFO_THRESHOLD_8_8);
+    HAL_UARTEx_EnableFifoMode(&huart2);
 
-    /* Initialize configuration with default values */
-    InitializeDefaultConfig();
+    commandLength = 0;
+    commandOverflow = 0;
 
-    /* Reset cycle counter */
-    testCycleCounter = 0;
+    HAL_NVIC_SetPriority(USART2_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
+    ResumeCommandInput();
+}
 
-    /* Start in normal testing mode */
-    currentTestMode = NORMAL_TEST_CYCLE;
+/**
+  * @brief  USART2 interrupt handler - move received characters into the ring
+  */
+void USART2_IRQHandler(void)
+{
+    /* Input lost before the interrupt was served leaves a partial line behind */
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_ORE)) {
+        __HAL_UART_CLEAR_FLAG(&huart2, UART_CLEAR_OREF);
+        rxOverflow = 1;
+    }
 
-    /* Initialize reporting timer */
-    lastReportTime = 0;
+    while (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_RXNE)) {
+        uint8_t c = (uint8_t)(huart2.Instance->RDR & 0xFF);
+        uint32_t next = (rxHead + 1) % COMMAND_RX_SIZE;
 
-    /* Report initial configuration */
-    ReportConfigStatus();
+        if (next == rxTail) {
+            rxOverflow = 1;
+            continue;
+        }
+        rxRing[rxHead] = c;
+        rxHead = next;
+    }
 }
 
 /**
-  * @brief  Report current test configuration
+  * @brief  Stop collecting input so the caller can read USART2 directly
+  * @note   Whatever is buffered or still in the FIFO is dropped
   */
-void ReportConfigStatus(void)
+void SuspendCommandInput(void)
 {
-    char buffer[512];
-
-    snprintf(buffer, sizeof(buffer),
-             "===== Memory Test Configuration =====\r\n"
-             "Flash Test: Start=0x%08lX Size=0x%08lX\r\n"
-             "SRAM1 Test: Start=0x%08lX Size=0x%08lX\r\n"
-             "SRAM2 Test: Start=0x%08lX Size=0x%08lX\r\n"
-             "CCM Test:   Start=0x%08lX Size=0x%08lX\r\n"
-             "Address Test Stride: %lu bytes\r\n"
-             "Butterfly Pairs: %lu\r\n"
-             "Rotating Offsets: %s\r\n"
-             "Rotating Sizes: %s\r\n\r\n",
-             GetFlashTestStart(), testConfig.flashTestSize,
-             GetSRAM1TestStart(), testConfig.sram1TestSize,
-             GetSRAM2TestStart(), testConfig.sram2TestSize,
-             GetCCMTestStart(), testConfig.ccmTestSize,
-             testConfig.addressTestStride,
-             testConfig.numButterflyPairs,
-             testConfig.rotateStartingOffsets ? "Enabled" : "Disabled",
-             testConfig.rotateTestSizes ? "Enabled" : "Disabled");
+    __HAL_UART_DISABLE_IT(&huart2, UART_IT_RXNE);
 
-    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    while (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_RXNE)) {
+        (void)huart2.Instance->RDR;
+    }
+    rxTail = rxHead;
 }
 
 /**
-  * @brief  Main test cycle execution with configurable parameters
+  * @brief  Collect input again after SuspendCommandInput()
   */
-void MainTestCycle(void)
+void ResumeCommandInput(void)
 {
-    /* Increment cycle counter */
-    testCycleCounter++;
-
-    /* Rotate test parameters at the beginning of each cycle if enabled */
-    RotateTestParameters(testCycleCounter);
+    __HAL_UART_CLEAR_FLAG(&huart2, UART_CLEAR_OREF);
+    __HAL_UART_ENABLE_IT(&huart2, UART_IT_RXNE);
+}
 
-    /* Every 20 cycles, report the current configuration */
-    if (testCycleCounter % 20 == 0) {
-        ReportConfigStatus();
-    }
+/**
+  * @brief  Run the command in the collected line
+  */
+static void DispatchCommand(void)
+{
+    char buffer[80];
+    char* argument = strchr(commandLine, ' ');
 
-    /* Run tests based on current mode */
-    switch (currentTestMode) {
-        case STRESS_TEST_CYCLE:
-            /* Run all tests with more intensive patterns */
-            TestAllMemoryRegions();
-            break;
-
-        case SRAM_ONLY_CYCLE:
-            /* Test only SRAM regions */
-            TestSRAMOnly();
-            break;
-
-        case FLASH_ONLY_CYCLE:
-            /* Test only Flash memory */
-            TestFlashOnly();
-            break;
-
-        case CACHE_ONLY_CYCLE:
-            /* Test only Cache operations */
-            TestCacheOnly();
-            break;
-
-        case NORMAL_TEST_CYCLE:
-        default:
-            /* Run standard test cycle */
-            TestAllMemoryRegions();
-            break;
+    if (argument != NULL) {
+        *argument++ = '\0';
     }
 
-    /* Report status at configurable intervals */
-    if (HAL_GetTick() - lastReportTime >= testConfig.reportIntervalMs) {
-        ReportTestStatus();
-        lastReportTime = HAL_GetTick();
+    for (uint32_t i = 0; i < NUM_COMMANDS; i++) {
+        if (strcmp(commandLine, commandTable[i].name) == 0) {
+            commandsRun++;
+            commandTable[i].handler(argument);
+            return;
+        }
     }
 
-    /* Feed the watchdog */
-    HAL_IWDG_Refresh(&hiwdg);
+    commandsRejected++;
+    snprintf(buffer, sizeof(buffer), "Command: unknown '%s', try HELP\r\n", commandLine);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
 }
 
 /**
-  * @brief  Test all memory regions with configurable parameters
+  * @brief  Drain received characters and run any complete command
   */
-void TestAllMemoryRegions(void)
+void ServiceCommandInterface(void)
 {
-    /* Get current test start addresses */
-    uint32_t flashTestStart = GetFlashTestStart();
-    uint32_t sram1TestStart = GetSRAM1TestStart();
-    uint32_t sram2TestStart = GetSRAM2TestStart();
-    uint32_t ccmTestStart = GetCCMTestStart();
-
-    /* Test Flash Memory */
-    UpdateTestOperation("Flash Address Test");
-    uint32_t errors = RunImprovedAddressTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        FLASH_SIZE);
-    flashStatus.addressTestTotal++;
-    if (errors == 0) flashStatus.addressTestSuccess++;
-    else flashStatus.totalErrors += errors;
-
-    /* Run enhanced butterfly test on Flash */
-    UpdateTestOperation("Flash Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        FLASH_SIZE);
-    flashStatus.addressTestTotal++;
-    if (errors == 0) flashStatus.addressTestSuccess++;
-    else flashStatus.totalErrors += errors;
-
-    /* Run basic checkerboard tests on Flash */
-    UpdateTestOperation("Flash Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        0xAA55AA55,
-        &flashStatus);
-    if (errors > 0) flashStatus.totalErrors += errors;
-
-    UpdateTestOperation("Flash Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        0x55AA55AA,
-        &flashStatus);
-    if (errors > 0) flashStatus.totalErrors += errors;
-
-    /* Test SRAM1 */
-    UpdateTestOperation("SRAM1 Address Test");
-    errors = RunImprovedAddressTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    /* Run enhanced butterfly test on SRAM1 */
-    UpdateTestOperation("SRAM1 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    /* Run basic checkerboard tests on SRAM1 */
-    UpdateTestOperation("SRAM1 Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0xAA55AA55,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM1 Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0x55AA55AA,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
-
-    /* Test SRAM2 */
-    UpdateTestOperation("SRAM2 Address Test");
-    errors = RunImprovedAddressTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    /* Run enhanced butterfly test on SRAM2 */
-    UpdateTestOperation("SRAM2 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    /* Run basic checkerboard tests on SRAM2 */
-    UpdateTestOperation("SRAM2 Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0xAA55AA55,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM2 Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0x55AA55AA,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
-
-    /* Test CCM SRAM */
-    UpdateTestOperation("CCM SRAM Address Test");
-    errors = RunImprovedAddressTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    /* Run enhanced butterfly test on CCM SRAM */
-    UpdateTestOperation("CCM SRAM Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    /* Run basic checkerboard tests on CCM SRAM */
-    UpdateTestOperation("CCM SRAM Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0xAA55AA55,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
-
-    UpdateTestOperation("CCM SRAM Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0x55AA55AA,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
-
-    /* Test Flash Cache */
-    UpdateTestOperation("Flash Cache Test");
-    RunCacheTest(&cacheStatus);
-
-    /* Check ECC error count and update status */
-    uint32_t eccErrors = GetECCErrorCount();
-    if (eccErrors > flashStatus.eccErrorCount) {
-        flashStatus.eccErrorCount = eccErrors;
+    if (rxOverflow) {
+        rxOverflow = 0;
+        commandOverflow = 1;
     }
 
-    /* Run advanced tests on a schedule */
-    if (testCycleCounter % testConfig.advancedTestInterval == 0) {
-        /* Run March C test on a portion of current SRAM1 test window */
-        UpdateTestOperation("SRAM1 March C Test");
-        uint32_t marchSize = testConfig.sram1TestSize / 8; /* Test 1/8th of the current window */
-        errors = RunMarchCTest(sram1TestStart, marchSize);
-        sram1Status.marchCTestTotal++;
-        if (errors == 0) sram1Status.marchCTestSuccess++;
-        else sram1Status.totalErrors += errors;
-
-        /* Run Walking Ones/Zeros on a portion of current SRAM2 test window */
-        UpdateTestOperation("SRAM2 Walking Test");
-        uint32_t walkingSize = testConfig.sram2TestSize / 8; /* Test 1/8th of the current window */
-        errors = RunWalkingOnesTest(sram2TestStart, walkingSize);
-        errors += RunWalkingZerosTest(sram2TestStart, walkingSize);
-        sram2Status.walkingTestTotal++;
-        if (errors == 0) sram2Status.walkingTestSuccess++;
-        else sram2Status.totalErrors += errors;
+    while (rxTail != rxHead) {
+        char c = (char)rxRing[rxTail];
+        rxTail = (rxTail + 1) % COMMAND_RX_SIZE;
+
+        if (c == '\r' || c == '\n') {
+            if (commandLength > 0 && !commandOverflow) {
+                commandLine[commandLength] = '\0';
+                DispatchCommand();
+            }
+            commandLength = 0;
+            commandOverflow = 0;
+            continue;
+        }
+
+        if (commandLength >= COMMAND_LINE_SIZE - 1) {
+            commandOverflow = 1;
+            continue;
+        }
+
+        /* Commands are matched in upper case */
+        commandLine[commandLength++] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
     }
+}
 
-    /* Refresh watchdog */
-    HAL_IWDG_Refresh(&hiwdg);
+/**
+  * @brief  PROD - run the production go/no-go pass; does not return
+  * @param  argument: Unused
+  */
+static void CommandProduction(const char* argument)
+{
+    (void)argument;
+    RunProductionTest();
 }
 
 /**
-  * @brief  Test only SRAM regions with configurable parameters
+  * @brief  MODE n - select the test mode for the following cycles
+  * @param  argument: Mode number
   */
-void TestSRAMOnly(void)
+static void CommandMode(const char* argument)
 {
-    /* Get current test start addresses */
-    uint32_t sram1TestStart = GetSRAM1TestStart();
-    uint32_t sram2TestStart = GetSRAM2TestStart();
-    uint32_t ccmTestStart = GetCCMTestStart();
-    uint32_t errors;
-
-    /* Test SRAM1 with basic patterns */
-    UpdateTestOperation("SRAM1 Address Test");
-    errors = RunImprovedAddressTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM1 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        SRAM1_SIZE);
-    sram1Status.addressTestTotal++;
-    if (errors == 0) sram1Status.addressTestSuccess++;
-    else sram1Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM1 Checkerboard Test");
-    errors = RunCheckerboardTest(
-        sram1TestStart,
-        testConfig.sram1TestSize,
-        0xAA55AA55,
-        &sram1Status);
-    if (errors > 0) sram1Status.totalErrors += errors;
-
-    /* Test SRAM2 with basic patterns */
-    UpdateTestOperation("SRAM2 Address Test");
-    errors = RunImprovedAddressTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM2 Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        SRAM2_SIZE);
-    sram2Status.addressTestTotal++;
-    if (errors == 0) sram2Status.addressTestSuccess++;
-    else sram2Status.totalErrors += errors;
-
-    UpdateTestOperation("SRAM2 Checkerboard Test");
-    errors = RunCheckerboardTest(
-        sram2TestStart,
-        testConfig.sram2TestSize,
-        0xAA55AA55,
-        &sram2Status);
-    if (errors > 0) sram2Status.totalErrors += errors;
-
-    /* Test CCM SRAM with basic patterns */
-    UpdateTestOperation("CCM SRAM Address Test");
-    errors = RunImprovedAddressTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    UpdateTestOperation("CCM SRAM Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        CCM_SRAM_SIZE);
-    ccmStatus.addressTestTotal++;
-    if (errors == 0) ccmStatus.addressTestSuccess++;
-    else ccmStatus.totalErrors += errors;
-
-    UpdateTestOperation("CCM SRAM Checkerboard Test");
-    errors = RunCheckerboardTest(
-        ccmTestStart,
-        testConfig.ccmTestSize,
-        0xAA55AA55,
-        &ccmStatus);
-    if (errors > 0) ccmStatus.totalErrors += errors;
-
-    /* Run advanced tests on a schedule */
-    if (testCycleCounter % (testConfig.advancedTestInterval / 2) == 0) {
-        /* In SRAM-only mode, run advanced tests more frequently */
-
-        /* Run March C test on a larger portion of SRAM1 */
-        UpdateTestOperation("SRAM1 March C Test");
-        uint32_t marchSize = testConfig.sram1TestSize / 4; /* Test 1/4th of the current window */
-        errors = RunMarchCTest(sram1TestStart, marchSize);
-        sram1Status.marchCTestTotal++;
-        if (errors == 0) sram1Status.marchCTestSuccess++;
-        else sram1Status.totalErrors += errors;
-
-        /* Run Walking Ones/Zeros on a larger portion of SRAM2 */
-        UpdateTestOperation("SRAM2 Walking Test");
-        uint32_t walkingSize = testConfig.sram2TestSize / 4; /* Test 1/4th of the current window */
-        errors = RunWalkingOnesTest(sram2TestStart, walkingSize);
-        errors += RunWalkingZerosTest(sram2TestStart, walkingSize);
-        sram2Status.walkingTestTotal++;
-        if (errors == 0) sram2Status.walkingTestSuccess++;
-        else sram2Status.totalErrors += errors;
-
-        /* Run Modified Checkerboard and Butterfly on CCM SRAM */
-        UpdateTestOperation("CCM SRAM Modified Checkerboard");
-        errors = RunModifiedCheckerboardTest(ccmTestStart, testConfig.ccmTestSize / 4);
-        ccmStatus.dataTestTotal++;
-        if (errors == 0) ccmStatus.dataTestSuccess++;
-        else ccmStatus.totalErrors += errors;
+    char buffer[64];
+
+    if (argument == NULL || *argument < '0' || *argument > '9' || atoi(argument) > CACHE_ONLY_CYCLE) {
+        commandsRejected++;
+        snprintf(buffer, sizeof(buffer), "Command: MODE needs 0-%d\r\n", CACHE_ONLY_CYCLE);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
     }
 
-    /* Refresh watchdog */
-    HAL_IWDG_Refresh(&hiwdg);
+    currentTestMode = (uint32_t)atoi(argument);
+    snprintf(buffer, sizeof(buffer), "Command: test mode %lu\r\n", currentTestMode);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
 }
 
 /**
-  * @brief  Test only Flash memory with configurable parameters
+  * @brief  REPORT - make the reports due at the end of this cycle
+  * @param  argument: Unused
   */
-void TestFlashOnly(void)
+static void CommandReport(const char* argument)
 {
-    /* Get current test start address */
-    uint32_t flashTestStart = GetFlashTestStart();
-    uint32_t errors;
-
-    /* Basic Flash tests */
-    UpdateTestOperation("Flash Address Test");
-    errors = RunImprovedAddressTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        FLASH_SIZE);
-    flashStatus.addressTestTotal++;
-    if (errors == 0) flashStatus.addressTestSuccess++;
-    else flashStatus.totalErrors += errors;
-
-    UpdateTestOperation("Flash Butterfly Test");
-    errors = RunEnhancedButterflyTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        FLASH_SIZE);
-    flashStatus.addressTestTotal++;
-    if (errors == 0) flashStatus.addressTestSuccess++;
-    else flashStatus.totalErrors += errors;
-
-    UpdateTestOperation("Flash Checkerboard Test 0xAA55AA55");
-    errors = RunCheckerboardTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        0xAA55AA55,
-        &flashStatus);
-    if (errors > 0) flashStatus.totalErrors += errors;
-
-    UpdateTestOperation("Flash Checkerboard Test 0x55AA55AA");
-    errors = RunCheckerboardTest(
-        flashTestStart,
-        testConfig.flashTestSize,
-        0x55AA55AA,
-        &flashStatus);
-    if (errors > 0) flashStatus.totalErrors += errors;
-
-    /* Check ECC error count and update status */
-    uint32_t eccErrors = GetECCErrorCount();
-    if (eccErrors > flashStatus.eccErrorCount) {
-        flashStatus.eccErrorCount = eccErrors;
-    }
-
-    /* Refresh watchdog */
-    HAL_IWDG_Refresh(&hiwdg);
+    (void)argument;
+    lastReportTime = HAL_GetTick() - testConfig.reportIntervalMs;
 }
 
 /**
-  * @brief  Test only Cache operations with configurable parameters
+  * @brief  BURNIN n - start or stop burn-in mode
+  * @param  argument: 1 to start, 0 to stop
   */
-void TestCacheOnly(void)
+static void CommandBurnIn(const char* argument)
 {
-    /* Run cache test multiple times */
-    for (int i = 0; i < 5; i++) {
-        UpdateTestOperation("Flash Cache Test");
-        RunCacheTest(&cacheStatus);
-
-        /* Check ECC error count */
-        uint32_t eccErrors = GetECCErrorCount();
-        if (eccErrors > flashStatus.eccErrorCount) {
-            flashStatus.eccErrorCount = eccErrors;
-        }
+    if (argument != NULL && strcmp(argument, "1") == 0) {
+        StartBurnIn();
+    }
+    else if (argument != NULL && strcmp(argument, "0") == 0) {
+        StopBurnIn();
+    }
+    else {
+        char buffer[] = "Command: BURNIN needs 0 or 1\r\n";
+        commandsRejected++;
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+}
 
-        /* Refresh watchdog between iterations */
-        HAL_IWDG_Refresh(&hiwdg);
+/**
+  * @brief  SCRIPT LOAD n, RUN or ERASE - manage the uploaded test script
+  * @param  argument: Sub-command, with the byte count for LOAD
+  */
+static void CommandScript(const char* argument)
+{
+    if (argument != NULL && strncmp(argument, "LOAD ", 5) == 0 && atoi(argument + 5) > 0) {
+        LoadTestScript((uint32_t)atoi(argument + 5));
+    }
+    else if (argument != NULL && strcmp(argument, "RUN") == 0) {
+        OpenTestWindows(GUARD_ALL_WINDOWS);
+        RunTestScript();
+        CloseTestWindows(GUARD_ALL_WINDOWS);
+        ReportTestScriptStatus();
+    }
+    else if (argument != NULL && strcmp(argument, "ERASE") == 0) {
+        EraseTestScript();
+        ReportTestScriptStatus();
+    }
+    else {
+        char buffer[] = "Command: SCRIPT needs LOAD n, RUN or ERASE\r\n";
+        commandsRejected++;
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
     }
 }
 
 /**
-  * @brief  Update the current test operation
-  * @param  operation: String describing the current operation
+  * @brief  HELP - list the commands
+  * @param  argument: Unused
   */
-void UpdateTestOperation(const char* operation)
+static void CommandHelp(const char* argument)
 {
-    strncpy((char*)currentTestOperation, operation, sizeof(currentTestOperation) - 1);
-    currentTestOperation[sizeof(currentTestOperation) - 1] = '\0';
+    char buffer[128];
+    (void)argument;
 
-    /* Store operation code in backup register (will be visible after watchdog reset) */
-    uint32_t operationCode = 0;
-    for (int i = 0; i < 4 && operation[i] != '\0'; i++) {
-        operationCode = (operationCode << 8) | operation[i];
-    }
-    SaveTestState(operationCode, 0);
+    snprintf(buffer, sizeof(buffer),
+             "Commands: PROD, MODE 0-%d, REPORT, BURNIN 0/1, SCRIPT LOAD n/RUN/ERASE, HELP "
+             "(run %lu, rejected %lu)\r\n",
+             CACHE_ONLY_CYCLE, commandsRun, commandsRejected);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
 }
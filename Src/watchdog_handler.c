@@ -39,6 +39,7 @@ void WatchdogISR(void);
 
 /* External references */
 extern UART_HandleTypeDef huart2;
+extern void LogResetEvent(uint32_t resetCause, uint32_t resetCount, uint32_t lastCycle);
 extern volatile char currentTestOperation[64];
 extern volatile uint32_t testCycleCounter;
 
@@ -116,11 +117,13 @@ void CheckForReset(void)
                  resetCount, lastCycle, lastOperation, lastError);
 
         HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        LogResetEvent(resetCause, resetCount, lastCycle);
     }
     else if (resetCause & RCC_CSR_PINRSTF) {
         /* Regular pin reset */
         snprintf(buffer, sizeof(buffer), "\r\n*** System started after PIN reset ***\r\n\r\n");
         HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        LogResetEvent(resetCause, HAL_RTCEx_BKUPRead(&hrtc, RTC_BKP_DR3), HAL_RTCEx_BKUPRead(&hrtc, RTC_BKP_DR1));
 
         /* Reset backup registers */
         HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKP_DR0, 0);
@@ -135,6 +138,7 @@ void CheckForReset(void)
                  "\r\n*** System reset detected: CSR=0x%08lX ***\r\n\r\n",
                  resetCause);
         HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        LogResetEvent(resetCause, HAL_RTCEx_BKUPRead(&hrtc, RTC_BKP_DR3), HAL_RTCEx_BKUPRead(&hrtc, RTC_BKP_DR1));
     }
 }
 
@@ -0,0 +1,625 @@
+/**
+ * Test Window Guard for STM32G473CB Memory Test
+ *
+ * The SRAM test windows share memory with the framework's own globals,
+ * stack and buffers, and a rotated window or a bad address calculation
+ * can land on live data without anything noticing. The MPU is programmed
+ * at the start of every cycle to make the SRAM1, SRAM2 and CCM windows
+ * no-access, with the default map behind them for everything else. The
+ * kernels reach a window through WINDOW_KERNEL(), which opens it just for
+ * the call, so any other access to a window - framework code, an
+ * interrupt, or a window that now covers live data - raises MemManage.
+ * The handler records the address and the running operation, leaves that
+ * one window open for the rest of the cycle so the access completes, and
+ * the main loop reports it. Each window is covered by two MPU regions using
+ * subregions; the MPU's power-of-two alignment can leave a few bytes at
+ * the window edges uncovered, which the coverage figure shows. Opening
+ * and closing a window is two register writes per MPU region, timed
+ * against GUARD_SWITCH_BUDGET_US.
+ *
+ * The same MPU also write-protects the framework state pages at the top
+ * of SRAM2 while a window is open. A kernel that writes into them traps;
+ * the handler steps over the store, so it never lands, and the pages and
+ * windows stay guarded for every later write. Legitimate writers inside a
+ * kernel, interrupt handlers included, use the unlock/commit pair, whose
+ * cost is measured; the parity NMI has its own pair, since it can arrive
+ * in the middle of either. The pages are only locked if the linker put
+ * .fwstate at STATE_START_ADDR and clear of the MSP stack reservation,
+ * which the stock script does not: _estack must be moved below the pages.
+ * The G4's SYSCFG_SWPR cannot do this job: it protects CCM SRAM pages
+ * (not SRAM2), and its bits clear only on reset, so there would be no
+ * unlock.
+ */
+
+#include "stm32g4xx_hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "memory_test.h"
+
+/* External references */
+extern UART_HandleTypeDef huart2;
+extern volatile uint32_t testCycleCounter;
+
+/* Guarded regions, each given GUARD_REGIONS_PER_WINDOW consecutive MPU regions */
+static const uint32_t guardedRegions[] = { REGION_SRAM1, REGION_SRAM2, REGION_CCM_SRAM };
+#define NUM_GUARDED_REGIONS   (sizeof(guardedRegions) / sizeof(guardedRegions[0]))
+#define GUARD_REGIONS_PER_WINDOW  2
+#define NUM_GUARD_SLOTS       (NUM_GUARDED_REGIONS * GUARD_REGIONS_PER_WINDOW)
+
+/* MPU region sizes tried, as log2: 256 bytes (the smallest with
+   subregions) up to 256KB */
+#define GUARD_MIN_SIZE_LOG2   8
+#define GUARD_MAX_SIZE_LOG2   18
+
+/* Normal memory, no access, never executable */
+#define GUARD_RASR_ATTR       (MPU_RASR_XN_Msk | MPU_RASR_S_Msk | MPU_RASR_C_Msk)
+
+/* Framework state pages take the MPU region after the windows */
+#define STATE_MPU_REGION      NUM_GUARD_SLOTS
+#define STATE_SIZE_LOG2       12
+#if (1 << STATE_SIZE_LOG2) != STATE_SIZE
+#error "STATE_SIZE_LOG2 does not match STATE_SIZE"
+#endif
+#define STATE_RASR_ATTR       (MPU_RASR_XN_Msk | MPU_RASR_S_Msk | MPU_RASR_C_Msk | \
+                               ((STATE_SIZE_LOG2 - 1) << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk)
+#define STATE_RASR_LOCKED     (STATE_RASR_ATTR | (MPU_REGION_PRIV_RO << MPU_RASR_AP_Pos))
+#define STATE_RASR_UNLOCKED   (STATE_RASR_ATTR | (MPU_REGION_FULL_ACCESS << MPU_RASR_AP_Pos))
+
+/* Linker symbols for the framework state section and the stack */
+extern uint32_t _sfwstate;
+extern uint32_t _efwstate;
+extern uint8_t _estack;
+extern uint32_t _Min_Stack_Size;
+
+/* Cost allowed for opening or closing the windows */
+#define GUARD_SWITCH_BUDGET_US  2
+
+/* One MPU region, as written to RBAR and RASR */
+typedef struct {
+    uint32_t rbar;                 /* Base | VALID | region number */
+    uint32_t rasr;                 /* Attributes, 0 if the slot is unused */
+} GuardSlot;
+
+/* Function prototypes */
+void InitializeWindowGuard(void);
+void ArmWindowGuard(void);
+void OpenTestWindows(uint32_t windows);
+void CloseTestWindows(uint32_t windows);
+uint32_t CloseTestWindowsAfter(uint32_t windows, uint32_t result);
+void InitializeFrameworkState(void);
+void UnlockFrameworkState(void);
+void CommitFrameworkState(void);
+uint32_t UnlockFrameworkStateNMI(void);
+void CommitFrameworkStateNMI(uint32_t saved);
+uint32_t HandleWindowGuardFault(uint32_t* frame);
+void ServiceWindowGuard(void);
+void ReportWindowGuardStatus(void);
+
+static GuardSlot guardSlots[NUM_GUARD_SLOTS];
+static uint32_t guardReady = 0;
+static volatile uint32_t guardArmed = 0;
+
+/* Windows left open by a trap until the next arm */
+static volatile uint32_t droppedWindows = 0;
+
+/* State pages are locked while a window is open, if the link allows it */
+static uint32_t stateProtected = 0;
+static volatile uint32_t stateLocked = 0;
+static volatile uint32_t stateUnlockDepth = 0;
+static uint32_t stateUnlockStart = 0;
+
+/* Trap captured by MemManage, picked up by ServiceWindowGuard() */
+static volatile uint32_t trapPending = 0;
+static volatile uint32_t trapAddress = 0;
+static volatile uint32_t trapStatus = 0;
+static volatile uint32_t trapTick = 0;
+static char trapOperation[24];
+
+/* Statistics */
+static uint32_t guardArms = 0;
+static uint32_t guardTraps = 0;
+static uint32_t windowCoverage[NUM_TEST_REGIONS];   /* Percent of the window guarded */
+static uint32_t armCycles = 0;
+static uint32_t switchCount = 0;
+static uint64_t switchCyclesTotal = 0;
+static uint32_t switchCyclesMax = 0;
+static uint32_t switchesOverBudget = 0;
+static uint32_t stateWrites = 0;
+static uint64_t stateWriteCycles = 0;
+static volatile uint32_t stateWritesDropped = 0;
+
+/**
+  * @brief  Find the MPU region that guards the most of an address range
+  * @param  start: Range start
+  * @param  end: Address just past the range
+  * @param  slot: Receives the region; its rbar must already hold the region number
+  * @param  coverStart: Receives the start of the part guarded
+  * @param  coverEnd: Receives the end of the part guarded
+  * @note   Only whole subregions inside the range are enabled, so the
+  *         region never reaches memory outside it.
+  */
+static void PlanGuardSlot(uint32_t start, uint32_t end, GuardSlot* slot,
+                          uint32_t* coverStart, uint32_t* coverEnd)
+{
+    uint32_t bestSize = 0;
+    uint32_t number = slot->rbar & MPU_RBAR_REGION_Msk;
+
+    slot->rasr = 0;
+    *coverStart = start;
+    *coverEnd = start;
+
+    for (uint32_t sizeLog2 = GUARD_MIN_SIZE_LOG2; sizeLog2 <= GUARD_MAX_SIZE_LOG2; sizeLog2++) {
+        uint32_t size = 1U << sizeLog2;
+        uint32_t subSize = size / 8;
+        uint32_t first = (start + subSize - 1) & ~(subSize - 1);
+        uint32_t last = end & ~(subSize - 1);
+
+        /* The block holding the start, the one after it, and the one holding the end */
+        uint32_t bases[3];
+        bases[0] = start & ~(size - 1);
+        bases[1] = bases[0] + size;
+        bases[2] = (end - 1) & ~(size - 1);
+
+        for (uint32_t i = 0; i < 3; i++) {
+            uint32_t lo = (first > bases[i]) ? first : bases[i];
+            uint32_t hi = (last < bases[i] + size) ? last : bases[i] + size;
+            if (hi <= lo || hi - lo <= bestSize) continue;
+
+            /* Disable the subregions outside [lo, hi) */
+            uint32_t disabled = 0;
+            for (uint32_t sub = 0; sub < 8; sub++) {
+                uint32_t subStart = bases[i] + sub * subSize;
+                if (subStart < lo || subStart + subSize > hi) disabled |= 1U << sub;
+            }
+
+            bestSize = hi - lo;
+            *coverStart = lo;
+            *coverEnd = hi;
+            slot->rbar = bases[i] | MPU_RBAR_VALID_Msk | number;
+            slot->rasr = GUARD_RASR_ATTR | (disabled << MPU_RASR_SRD_Pos) |
+                         ((sizeLog2 - 1) << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk;
+        }
+    }
+}
+
+/**
+  * @brief  Enable MemManage and the MPU with only the default map
+  */
+void InitializeWindowGuard(void)
+{
+    /* The slots use MPU regions 0 to NUM_GUARD_SLOTS - 1, the state pages the next */
+    if ((MPU->TYPE & MPU_TYPE_DREGION_Msk) >> MPU_TYPE_DREGION_Pos < NUM_GUARD_SLOTS + 1) {
+        char buffer[] = "Window Guard Error: not enough MPU regions\r\n";
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        return;
+    }
+
+    for (uint32_t i = 0; i < NUM_GUARD_SLOTS; i++) {
+        guardSlots[i].rbar = MPU_RBAR_VALID_Msk | i;
+        guardSlots[i].rasr = 0;
+    }
+
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+    guardReady = 1;
+}
+
+/**
+  * @brief  Program the MPU to guard this cycle's SRAM windows
+  * @note   Call after RotateTestParameters(); all windows start closed.
+  */
+void ArmWindowGuard(void)
+{
+    if (!guardReady) return;
+
+    uint32_t start = GET_CYCLE_COUNT();
+
+    __DMB();
+    MPU->CTRL = 0;
+
+    for (uint32_t i = 0; i < NUM_GUARDED_REGIONS; i++) {
+        uint32_t region = guardedRegions[i];
+        GuardSlot* slots = &guardSlots[i * GUARD_REGIONS_PER_WINDOW];
+        uint32_t windowStart, windowSize;
+        GetRegionTestWindow(region, &windowStart, &windowSize);
+        uint32_t windowEnd = windowStart + windowSize;
+
+        /* Largest piece first, then the larger gap left beside it */
+        uint32_t coverStart, coverEnd;
+        PlanGuardSlot(windowStart, windowEnd, &slots[0], &coverStart, &coverEnd);
+        uint32_t covered = coverEnd - coverStart;
+
+        uint32_t gapStart = windowStart, gapEnd = coverStart;
+        if (windowEnd - coverEnd > coverStart - windowStart) {
+            gapStart = coverEnd;
+            gapEnd = windowEnd;
+        }
+        if (gapEnd > gapStart) {
+            PlanGuardSlot(gapStart, gapEnd, &slots[1], &coverStart, &coverEnd);
+            covered += coverEnd - coverStart;
+        }
+        else {
+            slots[1].rasr = 0;
+        }
+
+        windowCoverage[region] = windowSize ? (uint32_t)((uint64_t)covered * 100 / windowSize) : 0;
+
+        for (uint32_t j = 0; j < GUARD_REGIONS_PER_WINDOW; j++) {
+            MPU->RBAR = slots[j].rbar;
+            MPU->RASR = slots[j].rasr;
+        }
+    }
+
+    /* Framework code writes its state freely until a window opens */
+    MPU->RBAR = STATE_START_ADDR | MPU_RBAR_VALID_Msk | STATE_MPU_REGION;
+    MPU->RASR = stateProtected ? STATE_RASR_UNLOCKED : 0;
+    stateLocked = 0;
+    stateUnlockDepth = 0;
+    droppedWindows = 0;
+
+    /* Privileged code keeps the default map everywhere else */
+    MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+    __DSB();
+    __ISB();
+
+    guardArmed = 1;
+    guardArms++;
+    armCycles = GET_CYCLE_COUNT() - start;
+}
+
+/**
+  * @brief  Time one open or close of the windows
+  * @param  cycles: Cycles taken
+  */
+static void RecordSwitch(uint32_t cycles)
+{
+    switchCount++;
+    switchCyclesTotal += cycles;
+    if (cycles > switchCyclesMax) switchCyclesMax = cycles;
+    if (cycles > US_TO_CYCLES(GUARD_SWITCH_BUDGET_US)) switchesOverBudget++;
+}
+
+/**
+  * @brief  Set the state pages' access, keeping the region number selected
+  * @param  rasr: STATE_RASR_LOCKED or STATE_RASR_UNLOCKED
+  * @note   Interrupts may land between another writer's RBAR and RASR
+  *         writes, so RNR is put back as it was found.
+  */
+static void WriteStateRegion(uint32_t rasr)
+{
+    uint32_t rnr = MPU->RNR;
+
+    MPU->RNR = STATE_MPU_REGION;
+    MPU->RASR = rasr;
+    MPU->RNR = rnr;
+    __DSB();
+    __ISB();
+}
+
+/**
+  * @brief  Let a kernel access the given windows
+  * @param  windows: Mask of GUARD_WINDOW(region) bits
+  */
+void OpenTestWindows(uint32_t windows)
+{
+    if (!guardArmed) return;
+
+    uint32_t start = GET_CYCLE_COUNT();
+
+    for (uint32_t i = 0; i < NUM_GUARDED_REGIONS; i++) {
+        if (!(windows & GUARD_WINDOW(guardedRegions[i]))) continue;
+
+        for (uint32_t j = 0; j < GUARD_REGIONS_PER_WINDOW; j++) {
+            MPU->RBAR = guardSlots[i * GUARD_REGIONS_PER_WINDOW + j].rbar;
+            MPU->RASR = 0;
+        }
+    }
+    if (stateProtected) {
+        stateLocked = 1;
+        WriteStateRegion(STATE_RASR_LOCKED);
+    }
+    __DSB();
+    __ISB();
+
+    RecordSwitch(GET_CYCLE_COUNT() - start);
+}
+
+/**
+  * @brief  Guard the given windows again after a kernel
+  * @param  windows: Mask of GUARD_WINDOW(region) bits
+  * @note   A window a trap left open stays open until the next arm
+  */
+void CloseTestWindows(uint32_t windows)
+{
+    if (!guardArmed) return;
+
+    uint32_t start = GET_CYCLE_COUNT();
+
+    windows &= ~droppedWindows;
+    for (uint32_t i = 0; i < NUM_GUARDED_REGIONS; i++) {
+        if (!(windows & GUARD_WINDOW(guardedRegions[i]))) continue;
+
+        for (uint32_t j = 0; j < GUARD_REGIONS_PER_WINDOW; j++) {
+            GuardSlot* slot = &guardSlots[i * GUARD_REGIONS_PER_WINDOW + j];
+            MPU->RBAR = slot->rbar;
+            MPU->RASR = slot->rasr;
+        }
+    }
+    if (stateProtected) {
+        WriteStateRegion(STATE_RASR_UNLOCKED);
+        stateLocked = 0;
+    }
+    __DSB();
+    __ISB();
+
+    RecordSwitch(GET_CYCLE_COUNT() - start);
+}
+
+/**
+  * @brief  Close the windows and pass a kernel's result through, for WINDOW_KERNEL()
+  * @param  windows: Mask of GUARD_WINDOW(region) bits
+  * @param  result: Kernel result
+  * @retval The kernel result
+  */
+uint32_t CloseTestWindowsAfter(uint32_t windows, uint32_t result)
+{
+    CloseTestWindows(windows);
+    return result;
+}
+
+/**
+  * @brief  Check where the linker put the state section, then clear it
+  * @note   Must run before anything in the section is used. The pages are
+  *         only locked later if the section sits at STATE_START_ADDR and
+  *         the locked pages miss the MSP stack reservation; a stack in the
+  *         pages would trap on every push while a window is open.
+  */
+void InitializeFrameworkState(void)
+{
+    char buffer[128];
+    uint32_t sectionStart = (uint32_t)&_sfwstate;
+    uint32_t sectionEnd = (uint32_t)&_efwstate;
+    uint32_t stackTop = (uint32_t)&_estack;
+    uint32_t stackBottom = stackTop - (uint32_t)&_Min_Stack_Size;
+
+    stateProtected = 0;
+
+    if (sectionStart != STATE_START_ADDR || sectionEnd > STATE_START_ADDR + STATE_SIZE) {
+        snprintf(buffer, sizeof(buffer),
+                 "Window Guard Error: .fwstate at 0x%08lX-0x%08lX, not in 0x%08lX-0x%08lX; state pages unguarded\r\n",
+                 sectionStart, sectionEnd, (uint32_t)STATE_START_ADDR, (uint32_t)(STATE_START_ADDR + STATE_SIZE));
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+    else if (stackBottom < STATE_START_ADDR + STATE_SIZE && STATE_START_ADDR < stackTop) {
+        snprintf(buffer, sizeof(buffer),
+                 "Window Guard Error: stack 0x%08lX-0x%08lX overlaps the state pages; state pages unguarded\r\n",
+                 stackBottom, stackTop);
+        HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+    }
+    else {
+        stateProtected = 1;
+    }
+
+    /* Anything at or above the stack pointer is a live frame, whatever
+       the link says */
+    uint32_t* dst = &_sfwstate;
+    uint32_t* end = &_efwstate;
+    uint32_t sp = __get_MSP() & ~0x3U;
+
+    if (sectionEnd > sp && sectionStart < stackTop) end = (sectionStart < sp) ? (uint32_t*)sp : dst;
+
+    while (dst < end) {
+        *dst++ = 0;
+    }
+}
+
+/**
+  * @brief  Make the framework state pages writable for an update inside a kernel
+  * @note   Nests, and may be called from interrupt handlers; the pages lock
+  *         again at the outermost CommitFrameworkState()
+  */
+void UnlockFrameworkState(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (stateLocked && stateUnlockDepth++ == 0) {
+        stateUnlockStart = GET_CYCLE_COUNT();
+        WriteStateRegion(STATE_RASR_UNLOCKED);
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Lock the framework state pages again after an update
+  */
+void CommitFrameworkState(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (stateLocked && stateUnlockDepth > 0 && --stateUnlockDepth == 0) {
+        WriteStateRegion(STATE_RASR_LOCKED);
+        stateWrites++;
+        stateWriteCycles += GET_CYCLE_COUNT() - stateUnlockStart;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Make the framework state pages writable from the NMI handler
+  * @retval Access to put back with CommitFrameworkStateNMI()
+  * @note   PRIMASK doesn't hold off the NMI, so it may arrive inside
+  *         either call above; it saves and restores the region as found.
+  */
+uint32_t UnlockFrameworkStateNMI(void)
+{
+    if (!stateProtected) return 0;
+
+    uint32_t rnr = MPU->RNR;
+    MPU->RNR = STATE_MPU_REGION;
+    uint32_t saved = MPU->RASR;
+    MPU->RNR = rnr;
+
+    WriteStateRegion(STATE_RASR_UNLOCKED);
+    return saved;
+}
+
+/**
+  * @brief  Put back the state pages' access after an NMI update
+  * @param  saved: Value returned by UnlockFrameworkStateNMI()
+  */
+void CommitFrameworkStateNMI(uint32_t saved)
+{
+    if (!stateProtected) return;
+
+    WriteStateRegion(saved);
+}
+
+/**
+  * @brief  Step the stacked PC over the instruction that faulted
+  * @param  frame: Exception frame
+  * @note   Also advances the IT state, in case the store was conditional
+  */
+static void SkipFaultingInstruction(uint32_t* frame)
+{
+    uint16_t first = *(const uint16_t*)frame[6];
+    uint32_t xpsr = frame[7];
+
+    /* 32-bit Thumb-2 encodings start 0b11101, 0b11110 or 0b11111 */
+    frame[6] += ((first & 0xF800U) >= 0xE800U) ? 4 : 2;
+
+    uint32_t it = ((xpsr >> 8) & 0xFCU) | ((xpsr >> 25) & 0x3U);
+    it = (it & 0x7U) ? ((it & 0xE0U) | ((it << 1) & 0x1FU)) : 0;
+    xpsr &= ~((0x3FU << 10) | (0x3U << 25));
+    frame[7] = xpsr | ((it & 0xFCU) << 8) | ((it & 0x3U) << 25);
+}
+
+/**
+  * @brief  Leave windows open until the next arm so a framework access completes
+  * @param  windows: Mask of GUARD_WINDOW(region) bits
+  */
+static void DropGuardWindows(uint32_t windows)
+{
+    uint32_t rnr = MPU->RNR;
+
+    for (uint32_t i = 0; i < NUM_GUARDED_REGIONS; i++) {
+        if (!(windows & GUARD_WINDOW(guardedRegions[i]))) continue;
+
+        for (uint32_t j = 0; j < GUARD_REGIONS_PER_WINDOW; j++) {
+            MPU->RBAR = guardSlots[i * GUARD_REGIONS_PER_WINDOW + j].rbar;
+            MPU->RASR = 0;
+        }
+    }
+    MPU->RNR = rnr;
+    __DSB();
+    __ISB();
+
+    droppedWindows |= windows;
+}
+
+/**
+  * @brief  Capture a guard trap from the MemManage handler
+  * @param  frame: Exception frame stacked for the fault
+  * @retval 1 if the fault was a guard trap and the code can resume
+  * @note   The MPU stays on. A write into the locked state pages is
+  *         stepped over, so it never lands. Any other trap is a framework
+  *         access to a window, which is left open so the access retries.
+  */
+uint32_t HandleWindowGuardFault(uint32_t* frame)
+{
+    uint32_t status = SCB->CFSR & SCB_CFSR_MEMFAULTSR_Msk;
+
+    if (!guardArmed) return 0;
+
+    /* Faults while stacking leave no frame to return through */
+    if (status & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_MUNSTKERR_Msk)) return 0;
+
+    uint32_t address = (status & SCB_CFSR_MMARVALID_Msk) ? SCB->MMFAR : 0;
+
+    if ((status & SCB_CFSR_DACCVIOL_Msk) && address - STATE_START_ADDR < STATE_SIZE && stateLocked) {
+        SkipFaultingInstruction(frame);
+        stateWritesDropped++;
+    }
+    else {
+        uint32_t region = address ? GetRegionForAddress(address) : REGION_NONE;
+        uint32_t windows = (region != REGION_NONE && (GUARD_ALL_WINDOWS & GUARD_WINDOW(region))) ?
+                           GUARD_WINDOW(region) : GUARD_ALL_WINDOWS;
+
+        /* Nothing left to open: not a guard trap */
+        if ((windows & ~droppedWindows) == 0) return 0;
+
+        DropGuardWindows(windows);
+    }
+
+    SCB->CFSR = status;
+
+    if (!trapPending) {
+        trapAddress = address;
+        trapStatus = status;
+        trapTick = HAL_GetTick();
+        for (uint32_t i = 0; i < sizeof(trapOperation) - 1; i++) {
+            trapOperation[i] = currentTestOperation[i];
+            if (trapOperation[i] == '\0') break;
+        }
+        trapOperation[sizeof(trapOperation) - 1] = '\0';
+        __DMB();
+        trapPending = 1;
+    }
+    guardTraps++;
+
+    return 1;
+}
+
+/**
+  * @brief  Report a trap captured since the last call
+  */
+void ServiceWindowGuard(void)
+{
+    char buffer[160];
+
+    if (!trapPending) return;
+
+    if (trapAddress - STATE_START_ADDR < STATE_SIZE) {
+        snprintf(buffer, sizeof(buffer),
+                 "Window Guard: kernel write to framework state 0x%08lX dropped, cycle %lu at %lums during %s\r\n",
+                 trapAddress, testCycleCounter, trapTick, trapOperation);
+        if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+        trapPending = 0;
+        return;
+    }
+
+    uint32_t region = GetRegionForAddress(trapAddress);
+    snprintf(buffer, sizeof(buffer),
+             "Window Guard: %s access to %s 0x%08lX outside a kernel, cycle %lu at %lums during %s\r\n",
+             (trapStatus & SCB_CFSR_IACCVIOL_Msk) ? "instruction" : "data",
+             (region != REGION_NONE) ? GetRegionName(region) : "window",
+             trapAddress, testCycleCounter, trapTick, trapOperation);
+    if (!IsBurnInActive()) HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+
+    trapPending = 0;
+}
+
+/**
+  * @brief  Report traps, window coverage and the cost of switching and state writes
+  */
+void ReportWindowGuardStatus(void)
+{
+    char buffer[256];
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000U;
+
+    if (guardArms == 0) return;
+
+    uint32_t switchAvg = switchCount ? (uint32_t)(switchCyclesTotal / switchCount) : 0;
+    uint32_t stateWriteAvg = stateWrites ? (uint32_t)(stateWriteCycles / stateWrites) : 0;
+    snprintf(buffer, sizeof(buffer),
+             "Window guard: traps=%lu coverage SRAM1=%lu%% SRAM2=%lu%% CCM=%lu%% | arm=%lu cycles, "
+             "switch avg=%luns max=%luns, over %luus=%lu | state %s writes=%lu avg=%luns dropped=%lu\r\n",
+             guardTraps, windowCoverage[REGION_SRAM1], windowCoverage[REGION_SRAM2],
+             windowCoverage[REGION_CCM_SRAM], armCycles,
+             switchAvg * 1000 / cyclesPerUs, switchCyclesMax * 1000 / cyclesPerUs,
+             (uint32_t)GUARD_SWITCH_BUDGET_US, switchesOverBudget,
+             stateProtected ? "guarded" : "UNGUARDED", stateWrites, stateWriteAvg * 1000 / cyclesPerUs,
+             stateWritesDropped);
+    HAL_UART_Transmit(&huart2, (uint8_t*)buffer, strlen(buffer), 1000);
+}